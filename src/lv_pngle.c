@@ -4,12 +4,52 @@
  *  Author: Vincent Paeder
  *  License: MIT
  */
-#include "lvgl.h"
-#include "lv_pngle.h"
-#include "external/src/pngle.h"
+#include "lv_pngle_private.h"
 
-#define PNGLE_BUF_SIZE 1024 ///< Size of buffer used to feed Pngle
 
+#if LV_PNGLE_USE_LVGL_V9
+/** \brief Retrieve PNG image size from given source.
+ *  \param decoder: underlying image decoder.
+ *  \param dsc: image descriptor containing source info.
+ *  \param header: target structure for data.
+ *  \returns LV_RES_OK if successful, LV_RES_INV if failed.
+ */
+static lv_res_t pngle_decoder_info(lv_image_decoder_t * decoder, lv_image_decoder_dsc_t * dsc, lv_image_header_t * header);
+
+/** \brief Decode PNG image.
+ *  \param decoder: underlying image decoder.
+ *  \param dsc: image descriptor containing source info.
+ *  \returns LV_RES_OK if successful, LV_RES_INV if failed.
+ */
+static lv_res_t pngle_decoder_open(lv_image_decoder_t * decoder, lv_image_decoder_dsc_t * dsc);
+
+/** \brief Decode the next row of an area of an image.
+ *  \param decoder: underlying image decoder.
+ *  \param dsc: image descriptor containing source info.
+ *  \param full_area: area of the image to decode.
+ *  \param decoded_area: area decoded so far (y1 set to LV_COORD_MIN at first call).
+ *  \returns LV_RES_OK if successful, LV_RES_INV if failed or done.
+ */
+static lv_res_t pngle_decoder_get_area(lv_image_decoder_t * decoder, lv_image_decoder_dsc_t * dsc,
+                                       const lv_area_t * full_area, lv_area_t * decoded_area);
+
+/** \brief Close and clean up decoding data for given descriptor.
+ *  \param decoder: underlying image decoder.
+ *  \param dsc: image descriptor.
+ */
+static void pngle_decoder_close(lv_image_decoder_t * decoder, lv_image_decoder_dsc_t * dsc);
+
+/** \brief Decode an image to a full buffer.
+ *  \param in: input to read from.
+ *  \param src: pointer to image source (for decoding options).
+ *  \param w: image width.
+ *  \param h: image height.
+ *  \param format: output format.
+ *  \returns decoded image, or NULL if failed.
+ */
+static lv_draw_buf_t * lv_pngle_decode_full(const lv_pngle_input_t * in, const void * src, uint32_t w, uint32_t h,
+                                            lv_pngle_format_t format);
+#else
 /** \brief Retrieve PNG image size from given source.
  *  \param decoder: underlying image decoder.
  *  \param src: pointer to image source (data buffer or file path).
@@ -43,80 +83,163 @@ static lv_res_t pngle_decoder_read_line(lv_img_decoder_t * decoder, lv_img_decod
  */
 static void pngle_decoder_close(lv_img_decoder_t * decoder, lv_img_decoder_dsc_t * dsc);
 
-/** \brief Convert an image buffer to LVGL color format.
- *  \param img: pointer to image buffer.
- *  \param px_cnt: number of pixels.
+/** \brief Decode an image to a full buffer.
+ *  \param in: input to read from.
+ *  \param src: pointer to image source (for decoding options).
+ *  \param w: image width.
+ *  \param h: image height.
+ *  \param format: output format.
+ *  \returns decoded image, or NULL if failed.
  */
-static void convert_color_depth(uint8_t * img, uint32_t px_cnt);
+static uint8_t * lv_pngle_decode_full(const lv_pngle_input_t * in, const void * src, uint32_t w, uint32_t h,
+                                      lv_pngle_format_t format);
+#endif
+
+/** \brief State of an image decoded row by row. */
+typedef struct _lv_pngle_stream_t {
+    /** \brief Pngle instance kept alive between rows. */
+    pngle_t * pngle;
+
+#if LV_PNGLE_USE_QOI
+    /** \brief QOI decoding state kept alive between rows (QOI images only, pngle is then NULL). */
+    lv_pngle_qoi_t * qoi;
+#endif
+
+    /** \brief Data shared with Pngle; its buffer holds the last decoded rows. */
+    lv_pngle_data_t ud;
+
+    /** \brief Image height. */
+    uint32_t height;
+
+    /** \brief Palette followed by pixel indices, for images decoded to indexed format (NULL otherwise). */
+    uint8_t * indexed;
+
+    /** \brief Reader over image data. */
+    lv_pngle_reader_t r;
+
+#if LV_PNGLE_USE_LVGL_V9
+    /** \brief Row buffer handed over to LVGL by get_area. */
+    lv_draw_buf_t * row;
+#endif
+
+#if LV_PNGLE_USE_POLICY
+    /** \brief Image source, to report decoding costs (NULL for images decoded to indexed format). */
+    const void * src;
+
+    /** \brief Number of rows decoded, restarts included. */
+    uint32_t rows;
+#endif
 
-/** \brief A structure to communicate data and useful flags with Pngle. */
-typedef struct _lv_pngle_data_t {
-    /** \brief If true, header parsing is done. */
-    bool hdr_ready;
+#if LV_PNGLE_USE_LAZY
+    /** \brief If true, image was opened lazily and nothing has been decoded yet. */
+    bool lazy;
 
-    /** \brief If true, data parsing is done. */
-    bool data_ready;
+    /** \brief Input to decode from when first drawn (lazily opened images). */
+    lv_pngle_input_t in;
 
-    /** \brief Starting x coordinate (used in read_line mode only). */
-    lv_coord_t start_x;
+    /** \brief Image source, for decoding options (lazily opened images). */
+    const void * img_src;
 
-    /** \brief Starting y coordinate (used in read_line mode only). */
-    lv_coord_t start_y;
+    /** \brief Decoding options read when opened (lazily opened images). */
+    lv_pngle_hints_t hints;
 
-    /** \brief Number of pixels to read (used in read_line mode only). */
-    uint32_t n_pixels;
+#if LV_PNGLE_USE_LVGL_V9
+    /** \brief Image decoded to a full buffer when first drawn, or NULL. */
+    lv_draw_buf_t * full;
 
-    /** \brief Number of pixels still to be read (used in read_line mode only). */
-    uint32_t n_remaining;
+    /** \brief If true, full buffer is owned by LVGL's image cache. */
+    bool full_cached;
+#else
+    /** \brief Image decoded to a full buffer when first drawn, or NULL (owned by image descriptor). */
+    const uint8_t * full;
+#endif
+#endif
+} lv_pngle_stream_t;
 
-    /** \brief Pointer to data buffer. */
-    uint8_t * data;
+#if LV_PNGLE_USE_LAZY
+/** \brief Lazy opening statistics. */
+static lv_pngle_lazy_stats_t lv_pngle_lazy_stats;
+#endif
 
-} lv_pngle_data_t;
+/** \brief Recent average of the memory held by an open image, in bytes (0 until an image is opened). */
+static uint32_t lv_pngle_avg_mem = 0;
 
 
 void lv_pngle_init(void) {
+#if LV_PNGLE_USE_LVGL_V9
+    lv_image_decoder_t * dec = lv_image_decoder_create();
+    lv_image_decoder_set_info_cb(dec, pngle_decoder_info);
+    lv_image_decoder_set_open_cb(dec, pngle_decoder_open);
+    lv_image_decoder_set_get_area_cb(dec, pngle_decoder_get_area);
+    lv_image_decoder_set_close_cb(dec, pngle_decoder_close);
+#else
     lv_img_decoder_t * dec = lv_img_decoder_create();
     lv_img_decoder_set_info_cb(dec, pngle_decoder_info);
     lv_img_decoder_set_open_cb(dec, pngle_decoder_open);
     lv_img_decoder_set_close_cb(dec, pngle_decoder_close);
     lv_img_decoder_set_read_line_cb(dec, pngle_decoder_read_line);
+#endif
+#if LV_PNGLE_USE_MANIFEST
+    if (LV_PNGLE_MANIFEST_PATH[0] != '\0') lv_pngle_manifest_load(LV_PNGLE_MANIFEST_PATH);
+#endif
+#if LV_PNGLE_USE_BUNDLE
+    if (LV_PNGLE_BUNDLE_PATH[0] != '\0') lv_pngle_bundle_open(LV_PNGLE_BUNDLE_PATH);
+#endif
 }
 
-/** \brief Initialize a data structure to interact with Pngle.
- *  \param pngle: pointer to a Pngle instance.
- *  \param ud: pointer to the data structure to initialize.
- */
-static void lv_pngle_data_init(pngle_t* pngle, lv_pngle_data_t * ud) {
-    ud = (lv_pngle_data_t*)malloc(sizeof(lv_pngle_data_t));
-    ud->hdr_ready = false;
-    ud->data_ready = false;
-    ud->start_x = 0;
-    ud->start_y = 0;
-    ud->n_pixels = 0;
-    ud->n_remaining = 0;
-    pngle_set_user_data(pngle, ud);
+void _lv_pngle_data_init(lv_pngle_data_t * ud, uint32_t w, uint32_t h) {
+    memset(ud, 0, sizeof(lv_pngle_data_t));
+    ud->width = w;
+    ud->n_rows = (int32_t)h;
+    ud->last_row = -1;
+    ud->cur_y = -1;
+    ud->col_end = w;
+    ud->opa = LV_OPA_COVER;
+}
+
+void lv_pngle_src_init(lv_pngle_src_t * s, const void * src, lv_pngle_format_t format) {
+    memset(s, 0, sizeof(lv_pngle_src_t));
+#if LV_PNGLE_USE_LVGL_V9
+    s->dsc.header.magic = LV_IMAGE_HEADER_MAGIC;
+    s->dsc.header.cf = LV_COLOR_FORMAT_RAW_ALPHA;
+#else
+    s->dsc.header.cf = LV_IMG_CF_RAW_ALPHA;
+#endif
+    // descriptor pointing to itself marks the wrapper; no image data can start there
+    s->dsc.data = (const uint8_t*)s;
+    s->dsc.data_size = sizeof(lv_pngle_src_t);
+    s->src = src;
+    s->format = format;
+    s->opa = LV_OPA_COVER;
+}
+
+void lv_pngle_src_init_cb(lv_pngle_src_t * s, lv_pngle_read_cb_t read_cb, void * user_data, uint32_t size,
+                          lv_pngle_format_t format) {
+    lv_pngle_src_init(s, NULL, format);
+    s->read_cb = read_cb;
+    s->user_data = user_data;
+    s->size = size;
+}
+
+void lv_pngle_src_set_tint(lv_pngle_src_t * s, lv_color_t color, lv_opa_t mix, lv_opa_t opa) {
+    s->tint = color;
+    s->tint_mix = mix;
+    s->opa = opa;
 }
 
+#if !LV_PNGLE_USE_LVGL_V9
 /** \brief Initialize data buffer.
  *  \param buf: pointer to data buffer.
  *  \param n_px: number of pixels.
+ *  \param px_size: number of bytes per pixel.
  */
-static void lv_pngle_buffer_init(uint8_t ** buf, uint32_t n_px) {
-#if LV_COLOR_DEPTH == 32
-    LV_LOG_INFO("allocating memory for image: %d bytes\n", n_px*4);
-    *buf = (uint8_t*)calloc(n_px*4, sizeof(uint8_t));
-#elif LV_COLOR_DEPTH == 16
-    LV_LOG_INFO("allocating memory for image: %d bytes\n", n_px*3);
-    *buf = (uint8_t*)calloc(n_px*3, sizeof(uint8_t));
-#elif LV_COLOR_DEPTH == 8
-    LV_LOG_INFO("allocating memory for image: %d bytes\n", n_px*2);
-    *buf = (uint8_t*)calloc(n_px*2, sizeof(uint8_t));
-#elif LV_COLOR_DEPTH == 1
-    LV_LOG_INFO("allocating memory for image: %d bytes\n", n_px*2);
-    *buf = (uint8_t*)calloc(n_px*2, sizeof(uint8_t));
-#endif
+static void lv_pngle_buffer_init(uint8_t ** buf, uint32_t n_px, uint32_t px_size) {
+    LV_LOG_INFO("allocating memory for image: %d bytes\n", n_px*px_size);
+    *buf = (uint8_t*)PNGLE_MALLOC(n_px*px_size);
+    if (*buf != NULL)
+        memset(*buf, 0, n_px*px_size);
 }
+#endif
 
 /** \brief Function called when image width and height could be read from header.
  *  \param pngle: pointer to a Pngle instance.
@@ -127,6 +250,108 @@ static void pngle_init_cb(pngle_t* pngle, uint32_t w, uint32_t h) {
     LV_LOG_INFO("PNG image header read succesfully. Size: %d x %d\n", w, h);
     lv_pngle_data_t * ud = (lv_pngle_data_t*)pngle_get_user_data(pngle);
     ud->hdr_ready = true;
+    ud->interlaced = pngle_get_ihdr(pngle)->interlace != 0;
+}
+
+/** \brief Get the palette index of a color, adding it to the palette if needed.
+ *  \param ud: pointer to the data structure shared with Pngle.
+ *  \param rgba: pointer to pixel value.
+ *  \returns palette index (0 if palette is full).
+ */
+static uint8_t lv_pngle_palette_index(lv_pngle_data_t * ud, const uint8_t * rgba) {
+    const uint8_t bgra[4] = {rgba[2], rgba[1], rgba[0], rgba[3]};
+    // neighbouring pixels often share their color
+    if (ud->n_colors > 0 && !memcmp(ud->palette + ud->last_index*4, bgra, 4)) return ud->last_index;
+    for (uint16_t i = 0; i < ud->n_colors; i++) {
+        if (!memcmp(ud->palette + i*4, bgra, 4)) {
+            ud->last_index = (uint8_t)i;
+            return ud->last_index;
+        }
+    }
+    if (ud->n_colors == PNGLE_PALETTE_COLORS) {
+        ud->overflow = true;
+        return 0;
+    }
+    memcpy(ud->palette + ud->n_colors*4, bgra, 4);
+    ud->last_index = (uint8_t)ud->n_colors++;
+    return ud->last_index;
+}
+
+/** \brief Store a pixel in a format other than the default one.
+ *  \param ud: pointer to the data structure shared with Pngle.
+ *  \param x: horizontal coordinate of pixel.
+ *  \param y: vertical coordinate of pixel.
+ *  \param rgba: pointer to pixel value.
+ */
+static void lv_pngle_store_pixel(lv_pngle_data_t * ud, uint32_t x, uint32_t y, const uint8_t * rgba) {
+    uint8_t * px = ud->data + y*ud->stride;
+    switch (ud->format) {
+    case LV_PNGLE_FORMAT_TRUE_COLOR:
+    case LV_PNGLE_FORMAT_CHROMA_KEYED: {
+#if LV_PNGLE_USE_LVGL_V9
+#if LV_COLOR_DEPTH == 16
+        uint16_t col = ((rgba[0] & 0xf8) << 8) | ((rgba[1] & 0xfc) << 3) | ((rgba[2] & 0xf8) >> 3);
+        px += x*2;
+        px[0] = col & 0xff;
+        px[1] = col >> 8;
+#else
+        px += x*3;
+        px[0] = rgba[2];
+        px[1] = rgba[1];
+        px[2] = rgba[0];
+#endif
+#else
+        lv_color_t col = (ud->format == LV_PNGLE_FORMAT_CHROMA_KEYED && rgba[3] < LV_OPA_50) ?
+                         LV_COLOR_CHROMA_KEY : _lv_pngle_make_color(rgba);
+        memcpy(px + x*sizeof(lv_color_t), &col, sizeof(lv_color_t));
+#endif
+        break;
+    }
+    case LV_PNGLE_FORMAT_ALPHA:
+        px[x] = rgba[3];
+        break;
+    case LV_PNGLE_FORMAT_ARGB8888:
+        px += x*4;
+        px[0] = rgba[2];
+        px[1] = rgba[1];
+        px[2] = rgba[0];
+        px[3] = rgba[3];
+        break;
+    case LV_PNGLE_FORMAT_INDEXED:
+        px[x] = lv_pngle_palette_index(ud, rgba);
+        break;
+    default:
+        break;
+    }
+}
+
+/** \brief Apply the tint and opacity requested for an image to a decoded pixel.
+ *  \param ud: pointer to the data structure shared with the decoder.
+ *  \param rgba: pointer to pixel value, modified in place.
+ */
+static inline void lv_pngle_blend_pixel(const lv_pngle_data_t * ud, uint8_t * rgba) {
+    if (ud->tint_mix == 0 && ud->opa == LV_OPA_COVER) return;
+    // same blending as LVGL image recolor, done once here instead of every time the image is drawn
+    uint8_t keep = 255 - ud->tint_mix;
+    for (uint8_t c = 0; c < 3; c++) rgba[c] = (uint8_t)((rgba[c]*keep + ud->tint[c]*ud->tint_mix)/255);
+    rgba[3] = (uint8_t)((rgba[3]*ud->opa)/255);
+}
+
+void _lv_pngle_put_pixel(lv_pngle_data_t * ud, uint32_t x, uint32_t y, uint8_t * rgba) {
+    LV_LOG_TRACE("received pixel (%d,%d) with rgba color (0x%02x,0x%02x,0x%02x,0x%02x)\n",
+                 x, y, rgba[0], rgba[1], rgba[2], rgba[3]);
+    // pixels are addressed by coordinates, which also works for interlaced images
+    if (x >= ud->width || (int32_t)y >= ud->n_rows) return;
+    lv_pngle_blend_pixel(ud, rgba);
+    if (ud->data == NULL) {
+        // pixels are handled by px_cb only
+    } else if (ud->format == LV_PNGLE_FORMAT_AUTO || ud->format == LV_PNGLE_FORMAT_TRUE_COLOR_ALPHA) {
+        _lv_pngle_convert_pixel(ud->data + y*ud->stride + x*PNGLE_COLOR_SIZE,
+                                ud->alpha ? ud->alpha + y*ud->alpha_stride + x : NULL, rgba);
+    } else {
+        lv_pngle_store_pixel(ud, x, y, rgba);
+    }
+    if (ud->px_cb != NULL) ud->px_cb(ud, x, y, rgba);
 }
 
 /** \brief Function called when a pixel is read.
@@ -138,34 +363,52 @@ static void pngle_init_cb(pngle_t* pngle, uint32_t w, uint32_t h) {
  *  \param rgba: pointer to pixel value.
  */
 static void pngle_draw_cb(pngle_t* pngle, uint32_t x, uint32_t y, uint32_t w, uint32_t h, uint8_t *rgba) {
-    lv_pngle_data_t * ud = (lv_pngle_data_t*)pngle_get_user_data(pngle);
+    _lv_pngle_put_pixel((lv_pngle_data_t*)pngle_get_user_data(pngle), x, y, rgba);
+}
+
+/** \brief Point to the place of the current row in the band, or to NULL if the row isn't kept.
+ *  \param ud: pointer to the data structure shared with Pngle.
+ */
+static void lv_pngle_select_row(lv_pngle_data_t * ud) {
+    if (ud->cur_y >= ud->first_row && ud->cur_y < ud->first_row + ud->n_rows) {
+        uint32_t slot = ud->cur_y % ud->n_rows;
+        ud->row = ud->data + slot*ud->stride;
+        ud->row_alpha = ud->alpha ? ud->alpha + slot*ud->alpha_stride : NULL;
+    } else {
+        ud->row = NULL;
+        ud->row_alpha = NULL;
+        if (ud->cur_y >= ud->first_row + ud->n_rows) ud->dropped = true;
+    }
+}
+
+/** \brief Store a decoded pixel if its row belongs to the band selected by first_row
+ *  and n_rows, and its column to the window selected by col_first and col_end.
+ *  Rows are stored in a ring.
+ *  \param ud: pointer to the data structure shared with the decoder.
+ *  \param x: horizontal coordinate of pixel.
+ *  \param y: vertical coordinate of pixel.
+ *  \param rgba: pointer to pixel value.
+ */
+static void lv_pngle_put_band_pixel(lv_pngle_data_t * ud, uint32_t x, uint32_t y, uint8_t * rgba) {
     LV_LOG_TRACE("received pixel (%d,%d) with rgba color (0x%02x,0x%02x,0x%02x,0x%02x)\n",
                  x, y, rgba[0], rgba[1], rgba[2], rgba[3]);
-#if LV_COLOR_DEPTH == 32
-    *ud->data++ = rgba[2];
-    *ud->data++ = rgba[1];
-    *ud->data++ = rgba[0];
-    *ud->data++ = rgba[3];
-#elif LV_COLOR_DEPTH == 16
-    uint16_t col = ((rgba[0] & 0xf8) << 8) | ((rgba[1] & 0xfc) << 3) | ((rgba[2] & 0xf8) >> 3);
-    *ud->data++ = col & 0xff;
-    *ud->data++ = col >> 8;
-    *ud->data++ = rgba[3];
-#elif LV_COLOR_DEPTH == 8
-    uint8_t col = (rgba[0] & 0xe0) | ((rgba[1] & 0xe0) >> 3) | ((rgba[2] & 0xc0) >> 6);
-    *ud->data++ = col;
-    *ud->data++ = rgba[3];
-#elif LV_COLOR_DEPTH == 1
-    uint8_t col = (rgba[0] | rgba[1] | rgba[2]) & 0x80;
-    *ud->data++ = col >> 7;
-    *ud->data++ = rgba[3];
-#endif
+    if ((int32_t)y != ud->cur_y) {
+        ud->cur_y = (int32_t)y;
+        lv_pngle_select_row(ud);
+    }
+    // rows outside band and columns outside window are only decoded, not converted
+    if (ud->row != NULL && x >= ud->col_first && x < ud->col_end) {
+        lv_pngle_blend_pixel(ud, rgba);
+        _lv_pngle_convert_pixel(ud->row + x*PNGLE_COLOR_SIZE, ud->row_alpha ? ud->row_alpha + x : NULL, rgba);
+    }
+    if (x + 1 == ud->width) ud->last_row = (int32_t)y;
 }
 
 /** \brief Function called when a pixel is read.
- * 
- *  This version of draw callback stores only a selected area of the image.
- * 
+ *
+ *  This version of draw callback stores only the rows of the band selected
+ *  by first_row and n_rows.
+ *
  *  \param pngle: pointer to a Pngle instance.
  *  \param x: horizontal coordinate of pixel.
  *  \param y: vertical coordinate of pixel.
@@ -174,37 +417,7 @@ static void pngle_draw_cb(pngle_t* pngle, uint32_t x, uint32_t y, uint32_t w, ui
  *  \param rgba: pointer to pixel value.
  */
 static void pngle_draw_partial_cb(pngle_t* pngle, uint32_t x, uint32_t y, uint32_t w, uint32_t h, uint8_t *rgba) {
-    lv_pngle_data_t * ud = (lv_pngle_data_t*)pngle_get_user_data(pngle);
-    LV_LOG_TRACE("received pixel (%d,%d) with rgba color (0x%02x,0x%02x,0x%02x,0x%02x)\n",
-                 x, y, rgba[0], rgba[1], rgba[2], rgba[3]);
-    // only process pixels within requested window
-    if (y<ud->start_y) return;
-    if (y==ud->start_y && x<ud->start_x) return;
-    if (ud->n_pixels == 0) {
-        ud->data_ready = true;
-        return;
-    }
-    ud->n_pixels--;
-
-#if LV_COLOR_DEPTH == 32
-    *ud->data++ = rgba[2];
-    *ud->data++ = rgba[1];
-    *ud->data++ = rgba[0];
-    *ud->data++ = rgba[3];
-#elif LV_COLOR_DEPTH == 16
-    uint16_t col = ((rgba[0] & 0xf8) << 8) | ((rgba[1] & 0xfc) << 3) | ((rgba[2] & 0xf8) >> 3);
-    *ud->data++ = col & 0xff;
-    *ud->data++ = col >> 8;
-    *ud->data++ = rgba[3];
-#elif LV_COLOR_DEPTH == 8
-    uint8_t col = (rgba[0] & 0xe0) | ((rgba[1] & 0xe0) >> 3) | ((rgba[2] & 0xc0) >> 6);
-    *ud->data++ = col;
-    *ud->data++ = rgba[3];
-#elif LV_COLOR_DEPTH == 1
-    uint8_t col = (rgba[0] | rgba[1] | rgba[2]) & 0x80;
-    *ud->data++ = col >> 7;
-    *ud->data++ = rgba[3];
-#endif
+    lv_pngle_put_band_pixel((lv_pngle_data_t*)pngle_get_user_data(pngle), x, y, rgba);
 }
 
 /** \brief Function called when reading image data is done.
@@ -214,43 +427,40 @@ static void pngle_done_cb(pngle_t* pngle) {
     LV_LOG_INFO("PNG image part read succesfully.");
     lv_pngle_data_t * ud = (lv_pngle_data_t*)pngle_get_user_data(pngle);
     ud->data_ready = true;
-#if LV_COLOR_DEPTH == 32
-    ud->data-=4*ud->n_pixels;
-#elif LV_COLOR_DEPTH == 16
-    ud->data-=3*ud->n_pixels;
-#elif LV_COLOR_DEPTH == 8
-    ud->data-=2*ud->n_pixels;
-#elif LV_COLOR_DEPTH == 1
-    ud->data-=2*ud->n_pixels;
-#endif
 }
 
 /** \brief Read next image chunk.
  *  \param pngle: pointer to a Pngle instance.
- *  \param f: pointer to image file.
+ *  \param r: pointer to reader.
  */
-static lv_res_t read_next_chunk(pngle_t * pngle, lv_fs_file_t * f) {
+static lv_res_t read_next_chunk(pngle_t * pngle, lv_pngle_reader_t * r) {
     // chunk structure: length (4 bytes) | chunk type (4 bytes) | chunk data (length) | CRC (4 bytes)
     // we read 4 bytes to get length and add 8 bytes to account for type and CRC
-    char buf[PNGLE_BUF_SIZE];
-    uint32_t rb;
-    uint32_t btr;
-    lv_fs_read(f, &buf, 8, &rb);
-    int chunk_length = ((buf[0] << 24) | (buf[1] << 16) | (buf[2] << 8) | buf[3]) + 4; // add 4 for CRC
+    const uint8_t * buf;
+    if (_lv_pngle_reader_peek(r, &buf, 8) != 8) {
+        LV_LOG_ERROR("error reading PNG image: unexpected end of file.\n");
+        return LV_RES_INV;
+    }
+    int chunk_length = (int)(((uint32_t)buf[0] << 24) | (buf[1] << 16) | (buf[2] << 8) | buf[3]) + 4; // add 4 for CRC
     if (chunk_length < 0) return LV_RES_INV;
     if (pngle_feed(pngle, buf, 8) < 0) {
         LV_LOG_ERROR("error reading PNG image: couldn't parse chunk header.\n");
         return LV_RES_INV;
     }
+    _lv_pngle_reader_seek(r, _lv_pngle_reader_tell(r) + 8);
     LV_LOG_INFO("PNG header chunk size: %d", chunk_length);
     while (chunk_length > 0) {
-        btr = (chunk_length < PNGLE_BUF_SIZE) ? chunk_length : PNGLE_BUF_SIZE;
-        lv_fs_read(f, &buf, btr, &rb);
-        chunk_length -= btr;
-        if (pngle_feed(pngle, buf, btr) < 0) {
+        uint32_t n = _lv_pngle_reader_peek(r, &buf, (uint32_t)chunk_length);
+        if (n == 0) {
+            LV_LOG_ERROR("error reading PNG image: unexpected end of file.\n");
+            return LV_RES_INV;
+        }
+        if (pngle_feed(pngle, buf, n) < 0) {
             LV_LOG_ERROR("error reading PNG image: couldn't parse chunk data.\n");
             return LV_RES_INV;
         }
+        _lv_pngle_reader_seek(r, _lv_pngle_reader_tell(r) + n);
+        chunk_length -= n;
     }
     return LV_RES_OK;
 }
@@ -258,267 +468,1294 @@ static lv_res_t read_next_chunk(pngle_t * pngle, lv_fs_file_t * f) {
 
 /** \brief Read PNG image header.
  *  \param pngle: pointer to a Pngle instance.
- *  \param f: pointer to image file.
+ *  \param r: pointer to reader.
  */
-static lv_res_t get_pngle_header(pngle_t * pngle, lv_fs_file_t * f) {
+static lv_res_t get_pngle_header(pngle_t * pngle, lv_pngle_reader_t * r) {
     LV_LOG_INFO("reading PNG image header...\n");
-    char buf[8];
-    uint32_t rb;
+    const uint8_t * buf;
     LV_LOG_INFO("reading file signature...\n");
-    lv_fs_read(f, &buf, 8, &rb);
-    if (pngle_feed(pngle, buf, 8) < 0) {
+    if (_lv_pngle_reader_peek(r, &buf, 8) != 8 || pngle_feed(pngle, buf, 8) < 0) {
         LV_LOG_ERROR("error reading PNG header: couldn't parse file signature.\n");
         return LV_RES_INV;
     }
+    _lv_pngle_reader_seek(r, 8);
     while (!(((lv_pngle_data_t*)pngle_get_user_data(pngle))->hdr_ready)) {
         LV_LOG_INFO("reading PNG header: read next chunk.\n");
-        if (read_next_chunk(pngle, f) != LV_RES_OK) return LV_RES_INV;
+        if (read_next_chunk(pngle, r) != LV_RES_OK) return LV_RES_INV;
     }
     return LV_RES_OK;
 }
 
 
+#if LV_PNGLE_USE_MANIFEST
+/** \brief Skip chunks that aren't needed to decode image data, using offsets from the asset manifest.
+ *  Does nothing if the file isn't in the manifest or changed since it was written.
+ *  \param pngle: pointer to a Pngle instance.
+ *  \param r: pointer to reader, positioned after the image header.
+ *  \param fn: file path.
+ *  \returns LV_RES_OK if successful, LV_RES_INV if reading file failed.
+ */
+static lv_res_t skip_pngle_chunks(pngle_t * pngle, lv_pngle_reader_t * r, const char * fn) {
+    uint32_t size, hdr_end, idat_offset;
+    if (_lv_pngle_reader_get_size(r, &size) != LV_RES_OK) return LV_RES_INV;
+    if (_lv_pngle_manifest_get_offsets(fn, size, &hdr_end, &idat_offset) != LV_RES_OK) return LV_RES_OK;
+    // palette and transparency chunks still go through Pngle; metadata up to image data is skipped
+    while (_lv_pngle_reader_tell(r) < hdr_end) {
+        if (read_next_chunk(pngle, r) != LV_RES_OK) return LV_RES_INV;
+    }
+    _lv_pngle_reader_seek(r, idat_offset);
+    return LV_RES_OK;
+}
+#endif
+
 /** \brief Read PNG image data.
  *  \param pngle: pointer to a Pngle instance.
- *  \param f: pointer to image file.
+ *  \param r: pointer to reader.
  */
-static lv_res_t get_pngle_data(pngle_t * pngle, lv_fs_file_t * f) {
+static lv_res_t get_pngle_data(pngle_t * pngle, lv_pngle_reader_t * r) {
     LV_LOG_INFO("reading PNG image data...\n");
-    do {
-        if (read_next_chunk(pngle, f) != LV_RES_OK) return LV_RES_INV;
-    } while (!(((lv_pngle_data_t*)pngle_get_user_data(pngle))->data_ready));
+    // past the header, chunk boundaries don't matter: feed whole buffers
+    while (!(((lv_pngle_data_t*)pngle_get_user_data(pngle))->data_ready)) {
+        if (_lv_pngle_reader_feed(r, pngle, PNGLE_BUF_SIZE) != LV_RES_OK) return LV_RES_INV;
+    }
     return LV_RES_OK;
 }
 
 
-static lv_res_t pngle_decoder_info(struct _lv_img_decoder_t * decoder, const void * src, lv_img_header_t * header) {
-    LV_UNUSED(decoder);
-    lv_img_src_t src_type = lv_img_src_get_type(src);
+/** \brief Check if a file name has PNG extension (or QOI extension, if QOI images are decoded).
+ *  \param fn: file name.
+ *  \returns true if file name ends with png (or qoi).
+ */
+static bool is_png_file(const char * fn) {
+    size_t len = strlen(fn);
+#if LV_PNGLE_USE_QOI
+    if (len >= 3 && !strcmp(&fn[len - 3], "qoi")) return true;
+#endif
+    return len >= 3 && !strcmp(&fn[len - 3], "png");
+}
 
-    if(src_type == LV_IMG_SRC_FILE) {
-        const char * fn = src;
-        if(!strcmp(&fn[strlen(fn) - 3], "png")) {
-            LV_LOG_INFO("reading PNG image info from file: %s\n", fn);
-            pngle_t * pngle = pngle_new();
-            if (pngle == NULL) {
-                LV_LOG_ERROR("couldn't create Pngle instance.\n");
-                return LV_RES_INV;
-            }
 
-            lv_pngle_data_t ud;
-            lv_pngle_data_init(pngle, &ud);
-
-            pngle_set_init_callback(pngle, pngle_init_cb);
-
-            lv_fs_file_t f;
-            bool failed = false;
-            if(lv_fs_open(&f, fn, LV_FS_MODE_RD) == LV_FS_RES_OK)  {
-                if (get_pngle_header(pngle, &f) == LV_RES_OK) {
-                    header->always_zero = 0;
-                    header->cf = LV_IMG_CF_RAW_ALPHA;
-                    header->w = (lv_coord_t)pngle_get_width(pngle);
-                    header->h = (lv_coord_t)pngle_get_height(pngle);
-                } else {
-                    LV_LOG_ERROR("couldn't access header from: %s\n", fn);
-                    failed = true;
-                }
-                lv_fs_close(&f);
-            } else {
-                LV_LOG_ERROR("couldn't access PNG file: %s\n", fn);
-                failed = true;
-            }
-            pngle_destroy(pngle);
+/** \brief Read a big-endian 32-bit integer.
+ *  \param buf: pointer to data.
+ *  \returns integer value.
+ */
+static uint32_t read_be32(const uint8_t * buf) {
+    return ((uint32_t)buf[0] << 24) | ((uint32_t)buf[1] << 16) | ((uint32_t)buf[2] << 8) | buf[3];
+}
 
-            return failed ? LV_RES_INV : LV_RES_OK;
-        }
-    } else if(src_type == LV_IMG_SRC_VARIABLE) {
-        LV_LOG_INFO("reading PNG image info from buffer...\n");
-        const lv_img_dsc_t * img_dsc = src;
-        const uint8_t magic[] = {0x89, 0x50, 0x4e, 0x47, 0x0d, 0x0a, 0x1a, 0x0a};
-        if(memcmp(magic, img_dsc->data, sizeof(magic))) return LV_RES_INV;
-        header->always_zero = 0;
-        header->cf = img_dsc->header.cf;
-        header->w = img_dsc->header.w;
-        header->h = img_dsc->header.h;
-        return LV_RES_OK;
+
+#if LV_PNGLE_USE_HINTS
+/** \brief Read the decoding hints of a PNG image from its lvGL chunk, if it has one before image data.
+ *  Only chunk headers are read on the way: nothing is fed to Pngle.
+ *  \param r: pointer to reader, at start of image.
+ *  \param hints: target hints (left unchanged if image has none).
+ */
+static void get_pngle_hints(lv_pngle_reader_t * r, lv_pngle_hints_t * hints) {
+    const uint8_t magic[] = {0x89, 0x50, 0x4e, 0x47, 0x0d, 0x0a, 0x1a, 0x0a};
+    const uint8_t * buf;
+    if (_lv_pngle_reader_peek(r, &buf, 8) != 8 || memcmp(buf, magic, 8)) return;
+
+    // chunk structure: length (4 bytes) | chunk type (4 bytes) | chunk data (length) | CRC (4 bytes)
+    uint32_t pos = 8;
+    uint32_t len;
+    for (;;) {
+        _lv_pngle_reader_seek(r, pos);
+        if (_lv_pngle_reader_peek(r, &buf, 8) != 8 || !memcmp(buf + 4, "IDAT", 4)) return;
+        len = read_be32(buf);
+        if (!memcmp(buf + 4, "lvGL", 4)) break;
+        if (len > UINT32_MAX - 12 - pos) return;
+        pos += len + 12;
+    }
+    // version (1) | format | mode | cache priority
+    _lv_pngle_reader_seek(r, pos + 8);
+    if (len < 4 || _lv_pngle_reader_peek(r, &buf, 4) != 4 || buf[0] != 1) {
+        LV_LOG_WARN("ignoring lvGL chunk of unknown version.\n");
+        return;
     }
+    hints->format = buf[1] <= LV_PNGLE_FORMAT_ARGB8888 ? (lv_pngle_format_t)buf[1] : LV_PNGLE_FORMAT_AUTO;
+    hints->mode = buf[2] <= LV_PNGLE_HINT_MODE_STREAM ? buf[2] : LV_PNGLE_HINT_MODE_AUTO;
+    hints->priority = buf[3];
+    LV_LOG_INFO("lvGL chunk: format %d, mode %d, cache priority %d.\n", hints->format, hints->mode, hints->priority);
+}
+#endif
 
-    return LV_RES_INV;
+
+/** \brief Get the options wrapper of an image source.
+ *  \param src: pointer to image source.
+ *  \returns pointer to wrapper, or NULL if source isn't wrapped with lv_pngle_src_init.
+ */
+static const lv_pngle_src_t * lv_pngle_get_wrapper(const void * src) {
+#if LV_PNGLE_USE_LVGL_V9
+    if (lv_image_src_get_type(src) != LV_IMAGE_SRC_VARIABLE) return NULL;
+#else
+    if (lv_img_src_get_type(src) != LV_IMG_SRC_VARIABLE) return NULL;
+#endif
+    const lv_pngle_src_t * s = (const lv_pngle_src_t*)src;
+    return (s->dsc.data == (const uint8_t*)s) ? s : NULL;
 }
 
 
-static lv_res_t pngle_decoder_open(lv_img_decoder_t * decoder, lv_img_decoder_dsc_t * dsc) {
-    LV_UNUSED(decoder);
-    if (dsc->src_type != LV_IMG_SRC_FILE && dsc->src_type != LV_IMG_SRC_VARIABLE)
-        return LV_RES_INV;
-    
-    pngle_t * pngle = pngle_new();
-    if (pngle == NULL) {
-        LV_LOG_ERROR("couldn't create Pngle instance.\n");
-        return LV_RES_INV;
+lv_pngle_format_t _lv_pngle_get_format(const void * src) {
+    const lv_pngle_src_t * s = lv_pngle_get_wrapper(src);
+    return s != NULL ? s->format : LV_PNGLE_FORMAT_AUTO;
+}
+
+
+void _lv_pngle_get_tint(const void * src, lv_pngle_data_t * ud) {
+    const lv_pngle_src_t * s = lv_pngle_get_wrapper(src);
+    if (s == NULL) return;
+#if LV_PNGLE_USE_LVGL_V9
+    ud->tint[0] = s->tint.red;
+    ud->tint[1] = s->tint.green;
+    ud->tint[2] = s->tint.blue;
+#else
+    uint32_t c = lv_color_to32(s->tint);
+    ud->tint[0] = (c >> 16) & 0xff;
+    ud->tint[1] = (c >> 8) & 0xff;
+    ud->tint[2] = c & 0xff;
+#endif
+    ud->tint_mix = s->tint_mix;
+    ud->opa = s->opa;
+}
+
+
+/** \brief Get the decoding options of an image: those of its lvGL chunk, overridden by
+ *  the format requested through its wrapper, if any.
+ *  \param src: pointer to image source.
+ *  \param in: input of image.
+ *  \param hints: target options.
+ */
+static void lv_pngle_get_hints(const void * src, const lv_pngle_input_t * in, lv_pngle_hints_t * hints) {
+    memset(hints, 0, sizeof(lv_pngle_hints_t));
+#if LV_PNGLE_USE_HINTS
+    lv_pngle_reader_t r;
+    if (_lv_pngle_reader_open(&r, in) == LV_RES_OK) {
+        get_pngle_hints(&r, hints);
+        _lv_pngle_reader_close(&r);
     }
+#else
+    LV_UNUSED(in);
+#endif
+    lv_pngle_format_t format = _lv_pngle_get_format(src);
+    if (format != LV_PNGLE_FORMAT_AUTO) hints->format = format;
+}
 
-    lv_pngle_data_t ud;
-    lv_pngle_data_init(pngle, &ud);
+
+lv_res_t _lv_pngle_get_src(const void * src, lv_pngle_input_t * in) {
+    const lv_pngle_src_t * wrapper = lv_pngle_get_wrapper(src);
+    memset(in, 0, sizeof(lv_pngle_input_t));
+    if (wrapper != NULL) {
+        if (wrapper->src != NULL) return _lv_pngle_get_src(wrapper->src, in);
+        if (wrapper->read_cb == NULL) return LV_RES_INV;
+        in->read_cb = wrapper->read_cb;
+        in->user_data = wrapper->user_data;
+        in->size = wrapper->size;
+        return LV_RES_OK;
+    }
+#if LV_PNGLE_USE_LVGL_V9
+    lv_image_src_t src_type = lv_image_src_get_type(src);
+    if (src_type == LV_IMAGE_SRC_VARIABLE) {
+        const lv_image_dsc_t * img_dsc = src;
+        in->data = img_dsc->data;
+        in->size = img_dsc->data_size;
+        return in->data != NULL ? LV_RES_OK : LV_RES_INV;
+    }
+    if (src_type != LV_IMAGE_SRC_FILE) return LV_RES_INV;
+#else
+    lv_img_src_t src_type = lv_img_src_get_type(src);
+    if (src_type == LV_IMG_SRC_VARIABLE) {
+        const lv_img_dsc_t * img_dsc = src;
+        in->data = img_dsc->data;
+        in->size = img_dsc->data_size;
+        return in->data != NULL ? LV_RES_OK : LV_RES_INV;
+    }
+    if (src_type != LV_IMG_SRC_FILE) return LV_RES_INV;
+#endif
+#if LV_PNGLE_USE_BUNDLE
+    // bundled images are read from the open bundle file
+    if (_lv_pngle_bundle_get_src((const char*)src, in) == LV_RES_OK) return LV_RES_OK;
+#endif
+    in->fn = src;
+    if (!is_png_file(in->fn)) return LV_RES_INV;
+#if LV_PNGLE_USE_WATCH
+    // anything decoded from this file must be dropped when it changes
+    _lv_pngle_watch_add(in->fn);
+#endif
+    return LV_RES_OK;
+}
+
+
+lv_res_t _lv_pngle_read_header(const lv_pngle_input_t * in, uint32_t * w, uint32_t * h) {
+    if (in->w != 0) {
+        *w = in->w;
+        *h = in->h;
+        return LV_RES_OK;
+    }
+#if LV_PNGLE_USE_MANIFEST
+    if (in->fn != NULL && _lv_pngle_manifest_get_size(in->fn, w, h) == LV_RES_OK) return LV_RES_OK;
+#endif
+    LV_LOG_INFO("reading PNG image info...\n");
+    lv_pngle_reader_t r;
+    if (_lv_pngle_reader_open(&r, in) != LV_RES_OK) return LV_RES_INV;
+    // signature (8 bytes) | IHDR length (4 bytes) | "IHDR" | width (4 bytes) | height (4 bytes)
+    const uint8_t magic[] = {0x89, 0x50, 0x4e, 0x47, 0x0d, 0x0a, 0x1a, 0x0a};
+    const uint8_t * data;
+    uint32_t n = _lv_pngle_reader_peek(&r, &data, 24);
+    bool is_png = n >= sizeof(magic) && !memcmp(magic, data, sizeof(magic));
+    lv_res_t res = LV_RES_INV;
+    if (is_png && n == 24 && !memcmp(data + 12, "IHDR", 4)) {
+        *w = read_be32(data + 16);
+        *h = read_be32(data + 20);
+        res = LV_RES_OK;
+    } else if (is_png) {
+        LV_LOG_ERROR("couldn't read PNG header.\n");
+#if LV_PNGLE_USE_QOI
+    } else if (_lv_pngle_qoi_read_size(&r, w, h) == LV_RES_OK) {
+        res = LV_RES_OK;
+#endif
+    }
+    // other images are left to other decoders: LVGL asks every decoder in turn
+    _lv_pngle_reader_close(&r);
+    return res;
+}
+
+
+void _lv_pngle_setup(pngle_t * pngle, lv_pngle_data_t * ud) {
     pngle_set_draw_callback(pngle, pngle_draw_cb);
     pngle_set_init_callback(pngle, pngle_init_cb);
     pngle_set_done_callback(pngle, pngle_done_cb);
+    pngle_set_user_data(pngle, ud);
+}
 
-    uint32_t png_width = 0;
-    uint32_t png_height = 0;
-    bool failed = false;
 
-    if(dsc->src_type == LV_IMG_SRC_FILE) {
-        const char * fn = dsc->src;
-        if(!strcmp(&fn[strlen(fn) - 3], "png")) {
-            LV_LOG_INFO("reading PNG image data from file: %s\n", fn);
-            lv_fs_file_t f;
-            if(lv_fs_open(&f, fn, LV_FS_MODE_RD) == LV_FS_RES_OK) {
-                if(get_pngle_header(pngle, &f) == LV_RES_OK) {
-                    png_width = pngle_get_width(pngle);
-                    png_height = pngle_get_height(pngle);
-                    ud.n_pixels = png_width*png_height;
-                    lv_pngle_buffer_init(&ud.data, ud.n_pixels);
-                    // this has to be done here otherwise buffer address isn't stored
-                    pngle_set_user_data(pngle, &ud);
-                    if (get_pngle_data(pngle, &f) != LV_RES_OK) {
-                        LV_LOG_ERROR("reading PNG data failed.\n");
-                        failed = true;
-                    }
-                } else {
-                    LV_LOG_ERROR("reading PNG header failed.\n");
-                    failed = true;
-                }
-            } else {
-                LV_LOG_ERROR("couldn't open file.\n");
-                failed = true;
-            }
-            lv_fs_close(&f);
-        }
-    } else if(dsc->src_type == LV_IMG_SRC_VARIABLE) {
-        LV_LOG_INFO("reading PNG image data from buffer...\n");
-        const lv_img_dsc_t * img_src = dsc->src;
-        png_width = dsc->header.w;
-        png_height = dsc->header.h;
-        ud.n_pixels = png_width*png_height;
-        lv_pngle_buffer_init(&ud.data, ud.n_pixels);
-        // this has to be done here otherwise buffer address isn't stored
-        pngle_set_user_data(pngle, &ud);
-        // feed Pngle with data until image is complete
-        uint32_t pos = 0, sz = img_src->data_size, btr;
-        while (!ud.data_ready) {
-            btr = (sz < PNGLE_BUF_SIZE) ? sz : PNGLE_BUF_SIZE;
-            if (pngle_feed(pngle, img_src->data+pos, btr) < 0) {
-                failed = true;
-                LV_LOG_ERROR("Pngle returned an error.\n");
-                break;
-            }
-            pos += btr;
-        }
+lv_res_t _lv_pngle_decode(const lv_pngle_input_t * in, lv_pngle_data_t * ud) {
+    lv_pngle_reader_t r;
+    if (_lv_pngle_reader_open(&r, in) != LV_RES_OK) return LV_RES_INV;
+#if LV_PNGLE_USE_QOI
+    if (_lv_pngle_qoi_detect(&r)) {
+        LV_LOG_INFO("reading QOI image data...\n");
+        lv_res_t res = _lv_pngle_qoi_decode(&r, ud);
+        _lv_pngle_reader_close(&r);
+        return res;
     }
-    
-    if (failed) {
-        LV_LOG_ERROR("PNG decoding failed.\n");
-        if (ud.data != NULL)
-            free(ud.data);
-    } else {
-        LV_LOG_INFO("PNG decoding succeeded. Converting.\n");
-        dsc->img_data = ud.data;
-    }
-    pngle_destroy(pngle);
-    return failed ? LV_RES_INV : LV_RES_OK;
-}
+#endif
 
-static lv_res_t pngle_decoder_read_line(lv_img_decoder_t * decoder, lv_img_decoder_dsc_t * dsc,
-                                        lv_coord_t x, lv_coord_t y, lv_coord_t len, uint8_t * buf) {
-    LV_UNUSED(decoder);
-    
-    if (dsc->src_type != LV_IMG_SRC_FILE && dsc->src_type != LV_IMG_SRC_VARIABLE)
-        return LV_RES_INV;
-    
     pngle_t * pngle = pngle_new();
     if (pngle == NULL) {
         LV_LOG_ERROR("couldn't create Pngle instance.\n");
+        _lv_pngle_reader_close(&r);
         return LV_RES_INV;
     }
 
-    lv_pngle_data_t ud;
-    lv_pngle_data_init(pngle, &ud);
-    ud.start_x = x;
-    ud.start_y = y;
-    ud.n_pixels = len;
-    ud.n_remaining = len;
-    ud.data = buf;
-    pngle_set_draw_callback(pngle, pngle_draw_partial_cb);
-    pngle_set_init_callback(pngle, pngle_init_cb);
-    pngle_set_done_callback(pngle, pngle_done_cb);
-    pngle_set_user_data(pngle, &ud);
+    _lv_pngle_setup(pngle, ud);
     bool failed = false;
+#if LV_PNGLE_USE_COST
+    uint32_t t0 = lv_tick_get();
+#endif
 
-    if(dsc->src_type == LV_IMG_SRC_FILE) {
-        const char * fn = dsc->src;
-        if(!strcmp(&fn[strlen(fn) - 3], "png")) {
-            LV_LOG_INFO("reading PNG image data from file: %s\n", fn);
-            lv_fs_file_t f;
-            if(lv_fs_open(&f, fn, LV_FS_MODE_RD) == LV_FS_RES_OK) {
-                if(get_pngle_header(pngle, &f) == LV_RES_OK) {
-                    // check that image is large enough to read requested length starting from provided coordinates
-                    png_width = pngle_get_width(pngle);
-                    png_height = pngle_get_height(pngle);
-                    if (png_width*png_height <= x*y+len) {
-                        if (get_pngle_data(pngle, &f) != LV_RES_OK) {
-                            LV_LOG_ERROR("reading PNG data failed.\n");
-                            failed = true;
-                        }
-                    } else {
-                        LV_LOG_ERROR("Requested pixels outside PNG boundaries.\n");
-                        failed = true;
-                    }
-                } else {
-                    LV_LOG_ERROR("reading PNG header failed.\n");
-                    failed = true;
-                }
-            } else {
-                LV_LOG_ERROR("couldn't open file.\n");
-                failed = true;
-            }
-            lv_fs_close(&f);
-        }
-    } else if(dsc->src_type == LV_IMG_SRC_VARIABLE) {
-        LV_LOG_INFO("reading PNG image data from buffer...\n");
-        const lv_img_dsc_t * img_src = dsc->src;
-        if (dsc->header.w*dsc->header.h <= x*y+len) {
-            // feed Pngle with data until image is complete
-            uint32_t pos = 0, sz = img_src->data_size, btr;
-            while (!ud.data_ready) {
-                btr = (sz < PNGLE_BUF_SIZE) ? sz : PNGLE_BUF_SIZE;
-                if (pngle_feed(pngle, img_src->data+pos, btr) < 0) {
-                    failed = true;
-                    LV_LOG_ERROR("Pngle returned an error.\n");
-                    break;
-                }
-                pos += btr;
-            }
-        } else {
-            LV_LOG_ERROR("Requested pixels outside PNG boundaries.\n");
-            failed = true;
-        }
+    LV_LOG_INFO("reading PNG image data...\n");
+    if (get_pngle_header(pngle, &r) != LV_RES_OK) {
+        LV_LOG_ERROR("reading PNG header failed.\n");
+        failed = true;
+#if LV_PNGLE_USE_MANIFEST
+    } else if (in->fn != NULL && skip_pngle_chunks(pngle, &r, in->fn) != LV_RES_OK) {
+        LV_LOG_ERROR("reading PNG header failed.\n");
+        failed = true;
+#endif
+    } else if (get_pngle_data(pngle, &r) != LV_RES_OK) {
+        LV_LOG_ERROR("reading PNG data failed.\n");
+        failed = true;
     }
+    uint32_t read_size = _lv_pngle_reader_tell(&r);
+    _lv_pngle_reader_close(&r);
 
-    if (failed) {
-        LV_LOG_ERROR("PNG decoding failed.\n");
-        buf -= ud.n_pixels - ud.n_remaining;
-    } else {
-        LV_LOG_INFO("PNG decoding succeeded. Converting.\n");
-    }
+#if LV_PNGLE_USE_COST
+    if (!failed) _lv_pngle_cost_record(pngle_get_ihdr(pngle), read_size, lv_tick_elaps(t0));
+#else
+    LV_UNUSED(read_size);
+#endif
     pngle_destroy(pngle);
     return failed ? LV_RES_INV : LV_RES_OK;
 }
 
-static void pngle_decoder_close(lv_img_decoder_t * decoder, lv_img_decoder_dsc_t * dsc) {
-    LV_UNUSED(decoder);
-    if(dsc->img_data) {
-        lv_mem_free((uint8_t *)dsc->img_data);
-        dsc->img_data = NULL;
+
+/** \brief (Re)start decoding from the beginning of the image.
+ *  \param s: pointer to decoding state.
+ *  \param first_row: first row to keep in memory.
+ *  \returns LV_RES_OK if header could be read, LV_RES_INV otherwise.
+ */
+static lv_res_t lv_pngle_stream_start(lv_pngle_stream_t * s, int32_t first_row) {
+    lv_pngle_data_t * ud = &s->ud;
+    ud->hdr_ready = false;
+    ud->data_ready = false;
+    ud->first_row = first_row;
+    ud->last_row = -1;
+    ud->cur_y = -1;
+    ud->dropped = false;
+    _lv_pngle_reader_seek(&s->r, 0);
+#if LV_PNGLE_USE_QOI
+    if (s->qoi != NULL) return _lv_pngle_qoi_start(s->qoi, &s->r, ud);
+#endif
+    pngle_reset(s->pngle);
+    pngle_set_draw_callback(s->pngle, pngle_draw_partial_cb);
+    pngle_set_init_callback(s->pngle, pngle_init_cb);
+    pngle_set_done_callback(s->pngle, pngle_done_cb);
+    pngle_set_user_data(s->pngle, ud);
+    while (!ud->hdr_ready) {
+        if (_lv_pngle_reader_feed(&s->r, s->pngle, PNGLE_FEED_SIZE) != LV_RES_OK) return LV_RES_INV;
     }
+    return LV_RES_OK;
+}
+
+
+/** \brief Decode next slice of image data.
+ *  \param s: pointer to decoding state.
+ *  \returns LV_RES_OK if successful, LV_RES_INV if decoding failed or if data ended.
+ */
+static lv_res_t lv_pngle_stream_feed(lv_pngle_stream_t * s) {
+#if LV_PNGLE_USE_QOI
+    if (s->qoi != NULL) return _lv_pngle_qoi_feed(s->qoi, &s->r, &s->ud, lv_pngle_put_band_pixel, PNGLE_FEED_SIZE);
+#endif
+    return _lv_pngle_reader_feed(&s->r, s->pngle, PNGLE_FEED_SIZE);
+}
+
+
+/** \brief Check whether a row by row decoding state can decode rows.
+ *  \param s: pointer to decoding state.
+ *  \returns true if a decoder is set up.
+ */
+static bool lv_pngle_stream_is_set(const lv_pngle_stream_t * s) {
+#if LV_PNGLE_USE_QOI
+    if (s->qoi != NULL) return true;
+#endif
+    return s->pngle != NULL;
+}
+
+
+/** \brief Release what a row by row decoding state holds, leaving it empty.
+ *  \param s: pointer to decoding state.
+ */
+static void lv_pngle_stream_release(lv_pngle_stream_t * s) {
+#if LV_PNGLE_USE_POLICY
+    if (s->src != NULL) _lv_pngle_policy_record_stream(s->src, s->rows);
+    s->src = NULL;
+    s->rows = 0;
+#endif
+    _lv_pngle_reader_close(&s->r);
+    if (s->pngle != NULL) pngle_destroy(s->pngle);
+#if LV_PNGLE_USE_QOI
+    if (s->qoi != NULL) PNGLE_FREE(s->qoi);
+    s->qoi = NULL;
+#endif
+    if (s->ud.data != NULL) PNGLE_FREE(s->ud.data);
+    if (s->indexed != NULL) PNGLE_FREE(s->indexed);
+    s->pngle = NULL;
+    s->ud.data = NULL;
+    s->indexed = NULL;
 }
+
+
+/** \brief Destroy a row by row decoding state.
+ *  \param s: pointer to decoding state.
+ */
+static void lv_pngle_stream_destroy(lv_pngle_stream_t * s) {
+    lv_pngle_stream_release(s);
+#if LV_PNGLE_USE_LAZY
+    if (s->lazy) lv_pngle_lazy_stats.avoided++;
+#if LV_PNGLE_USE_LVGL_V9
+    if (s->full != NULL && !s->full_cached) lv_draw_buf_destroy(s->full);
+#endif
+#endif
+#if LV_PNGLE_USE_LVGL_V9
+    if (s->row != NULL) lv_draw_buf_destroy(s->row);
+#endif
+    PNGLE_FREE(s);
+}
+
+
+/** \brief Set up row by row decoding in an allocated state.
+ *
+ *  Interlaced images can't be decoded row by row, in which case set up fails
+ *  and the state is left empty.
+ *
+ *  \param s: pointer to decoding state.
+ *  \param in: input to read from.
+ *  \param w: image width.
+ *  \param h: image height.
+ *  \param src: pointer to image source (for decoding options).
+ *  \returns LV_RES_OK if successful, LV_RES_INV if failed.
+ */
+static lv_res_t lv_pngle_stream_init(lv_pngle_stream_t * s, const lv_pngle_input_t * in, uint32_t w, uint32_t h, const void * src) {
+#if LV_PNGLE_USE_POLICY
+    s->src = src;
+#endif
+
+    _lv_pngle_data_init(&s->ud, w, h);
+    _lv_pngle_get_tint(src, &s->ud);
+    s->height = h;
+    s->ud.n_rows = h < LV_PNGLE_STREAM_BAND_ROWS ? (int32_t)h : LV_PNGLE_STREAM_BAND_ROWS;
+    s->ud.stride = w*PNGLE_PX_SIZE;
+    LV_LOG_INFO("allocating memory for %d rows: %d bytes\n", s->ud.n_rows, s->ud.n_rows*s->ud.stride);
+    s->ud.data = (uint8_t*)PNGLE_MALLOC(s->ud.n_rows*s->ud.stride);
+#if PNGLE_PLANAR_ALPHA
+    // each row holds color data followed by alpha values
+    if (s->ud.data != NULL) s->ud.alpha = s->ud.data + w*PNGLE_COLOR_SIZE;
+    s->ud.alpha_stride = s->ud.stride;
+#endif
+    if (_lv_pngle_reader_open(&s->r, in) != LV_RES_OK) {
+        lv_pngle_stream_release(s);
+        return LV_RES_INV;
+    }
+#if LV_PNGLE_USE_QOI
+    if (_lv_pngle_qoi_detect(&s->r)) s->qoi = (lv_pngle_qoi_t*)PNGLE_MALLOC(sizeof(lv_pngle_qoi_t));
+    else s->pngle = pngle_new();
+#else
+    s->pngle = pngle_new();
+#endif
+    if (s->ud.data == NULL || !lv_pngle_stream_is_set(s)) {
+        LV_LOG_ERROR("couldn't allocate decoding state.\n");
+        lv_pngle_stream_release(s);
+        return LV_RES_INV;
+    }
+    if (lv_pngle_stream_start(s, 0) != LV_RES_OK) {
+        LV_LOG_ERROR("reading image header failed.\n");
+        lv_pngle_stream_release(s);
+        return LV_RES_INV;
+    }
+    if (s->pngle != NULL && pngle_get_ihdr(s->pngle)->interlace) {
+        LV_LOG_INFO("interlaced PNG image can't be decoded row by row.\n");
+        lv_pngle_stream_release(s);
+        return LV_RES_INV;
+    }
+    return LV_RES_OK;
+}
+
+
+/** \brief Create a row by row decoding state.
+ *
+ *  Interlaced images can't be decoded row by row, in which case creation fails.
+ *
+ *  \param in: input to read from.
+ *  \param w: image width.
+ *  \param h: image height.
+ *  \param src: pointer to image source (for decoding options).
+ *  \returns pointer to decoding state, or NULL if failed.
+ */
+static lv_pngle_stream_t * lv_pngle_stream_create(const lv_pngle_input_t * in, uint32_t w, uint32_t h, const void * src) {
+#if LV_PNGLE_USE_ARENA
+    uint32_t band_size = (h < LV_PNGLE_STREAM_BAND_ROWS ? h : LV_PNGLE_STREAM_BAND_ROWS)*w*PNGLE_PX_SIZE;
+    if (!_lv_pngle_arena_fits(lv_pngle_arena_need(w, h, true), band_size > PNGLE_ARENA_STATE_SIZE ? band_size : PNGLE_ARENA_STATE_SIZE)) return NULL;
+#endif
+    lv_pngle_stream_t * s = (lv_pngle_stream_t*)PNGLE_MALLOC(sizeof(lv_pngle_stream_t));
+    if (s == NULL) return NULL;
+    memset(s, 0, sizeof(lv_pngle_stream_t));
+    if (lv_pngle_stream_init(s, in, w, h, src) != LV_RES_OK) {
+        lv_pngle_stream_destroy(s);
+        return NULL;
+    }
+    return s;
+}
+
+
+/** \brief Decode an image to indexed format.
+ *
+ *  The returned state holds the palette and pixel indices; rows are expanded
+ *  to the default format when requested. Creation fails if the image has more
+ *  colors than the palette can hold.
+ *
+ *  \param in: input to read from.
+ *  \param w: image width.
+ *  \param h: image height.
+ *  \param src: pointer to image source (for decoding options).
+ *  \returns pointer to decoding state, or NULL if failed.
+ */
+static lv_pngle_stream_t * lv_pngle_indexed_create(const lv_pngle_input_t * in, uint32_t w, uint32_t h, const void * src) {
+    lv_pngle_stream_t * s = (lv_pngle_stream_t*)PNGLE_MALLOC(sizeof(lv_pngle_stream_t));
+    if (s == NULL) return NULL;
+    memset(s, 0, sizeof(lv_pngle_stream_t));
+    s->height = h;
+    LV_LOG_INFO("allocating memory for indexed image: %d bytes\n", PNGLE_PALETTE_COLORS*4 + w*h);
+    s->indexed = (uint8_t*)PNGLE_MALLOC(PNGLE_PALETTE_COLORS*4 + w*h);
+    s->ud.data = (uint8_t*)PNGLE_MALLOC(w*PNGLE_PX_SIZE);
+    if (s->indexed == NULL || s->ud.data == NULL) {
+        LV_LOG_ERROR("couldn't allocate memory for image.\n");
+        lv_pngle_stream_destroy(s);
+        return NULL;
+    }
+    memset(s->indexed, 0, PNGLE_PALETTE_COLORS*4 + w*h);
+
+    lv_pngle_data_t ud;
+    _lv_pngle_data_init(&ud, w, h);
+    _lv_pngle_get_tint(src, &ud);
+    ud.format = LV_PNGLE_FORMAT_INDEXED;
+    ud.palette = s->indexed;
+    ud.data = s->indexed + PNGLE_PALETTE_COLORS*4;
+    ud.stride = w;
+    if (_lv_pngle_decode(in, &ud) != LV_RES_OK || ud.overflow) {
+        if (ud.overflow) LV_LOG_WARN("PNG image has more than %d colors.\n", PNGLE_PALETTE_COLORS);
+        lv_pngle_stream_destroy(s);
+        return NULL;
+    }
+    LV_LOG_INFO("PNG image decoded with %d colors.\n", ud.n_colors);
+    s->ud.width = w;
+    return s;
+}
+
+
+/** \brief Expand a span of a row of an indexed image to the default format.
+ *  \param s: pointer to decoding state.
+ *  \param y: row index.
+ *  \param x0: first column of span.
+ *  \param len: number of pixels in span.
+ *  \returns pointer to row data (color data followed by alpha values for planar formats), valid in span only.
+ */
+static uint8_t * lv_pngle_indexed_get_row(lv_pngle_stream_t * s, int32_t y, uint32_t x0, uint32_t len) {
+    uint32_t w = s->ud.width;
+    const uint8_t * idx = s->indexed + PNGLE_PALETTE_COLORS*4 + y*w;
+    uint8_t * row = s->ud.data;
+    for (uint32_t x = x0; x < x0 + len; x++) {
+        const uint8_t * c = s->indexed + idx[x]*4;
+        const uint8_t rgba[4] = {c[2], c[1], c[0], c[3]};
+        _lv_pngle_convert_pixel(row + x*PNGLE_COLOR_SIZE, PNGLE_PLANAR_ALPHA ? row + w*PNGLE_COLOR_SIZE + x : NULL, rgba);
+    }
+    return row;
+}
+
+
+/** \brief Get a span of a decoded row, decoding further if needed.
+ *
+ *  Rows are expected to be requested in increasing order. Requesting a row
+ *  that has been decoded and discarded restarts decoding from the beginning.
+ *  Only the columns of the span are converted; requesting columns outside
+ *  the span of rows already decoded restarts decoding as well.
+ *
+ *  \param s: pointer to decoding state.
+ *  \param y: row index.
+ *  \param x: first column of span.
+ *  \param len: number of pixels in span.
+ *  \returns pointer to row data (color data followed by alpha values for planar formats),
+ *  valid in span only, or NULL if failed.
+ */
+static uint8_t * lv_pngle_stream_get_row(lv_pngle_stream_t * s, int32_t y, uint32_t x, uint32_t len) {
+    lv_pngle_data_t * ud = &s->ud;
+    if (y < 0 || (uint32_t)y >= s->height) return NULL;
+    if (s->indexed != NULL) return lv_pngle_indexed_get_row(s, y, x, len);
+    // nothing to decode from, e.g. after a failed lazy decoding
+    if (!lv_pngle_stream_is_set(s)) return NULL;
+
+    bool in_band = y >= ud->first_row && y < ud->first_row + ud->n_rows;
+    bool in_window = x >= ud->col_first && x + len <= ud->col_end;
+    if (!in_window) {
+        // rows decoded from now on hold the requested columns only
+        ud->col_first = x;
+        ud->col_end = x + len;
+    }
+    if (y > ud->cur_y) {
+        // row not reached yet: start band there
+        ud->first_row = y;
+        ud->dropped = false;
+        lv_pngle_select_row(ud);
+    } else if (in_band && in_window) {
+        // row is kept: slide band down unless rows past its end have been discarded already
+        if (!ud->dropped) {
+            ud->first_row = y;
+            lv_pngle_select_row(ud);
+        }
+    } else {
+        // row has been decoded and discarded already, or lacks requested columns: start over
+        LV_LOG_INFO("restarting PNG decoding to reach row %d\n", y);
+        if (lv_pngle_stream_start(s, y) != LV_RES_OK) return NULL;
+    }
+
+#if LV_PNGLE_USE_POLICY
+    int32_t last_row = ud->last_row;
+#endif
+    while (ud->last_row < y) {
+        if (ud->data_ready || lv_pngle_stream_feed(s) != LV_RES_OK) return NULL;
+    }
+#if LV_PNGLE_USE_POLICY
+    s->rows += ud->last_row - last_row;
+#endif
+    return ud->data + (y % ud->n_rows)*ud->stride;
+}
+
+
+/** \brief Memory held by an image decoded row by row.
+ *  \param s: pointer to decoding state.
+ *  \returns number of bytes.
+ */
+static uint32_t lv_pngle_stream_mem(const lv_pngle_stream_t * s) {
+    if (s->indexed != NULL) return sizeof(lv_pngle_stream_t) + PNGLE_PALETTE_COLORS*4 + s->ud.width*s->height + s->ud.width*PNGLE_PX_SIZE;
+    return sizeof(lv_pngle_stream_t) + s->ud.n_rows*s->ud.stride;
+}
+
+
+#if LV_PNGLE_USE_ARENA
+uint32_t lv_pngle_arena_need(uint32_t w, uint32_t h, bool stream) {
+    // Pngle state, two scanlines of 16-bit RGBA pixels, palette and transparency
+    uint32_t need = PNGLE_ARENA_STATE_SIZE + 2*(w*8 + 1) + PNGLE_PALETTE_COLORS*4;
+    uint32_t n_alloc = 4;
+    if (stream) {
+        uint32_t n_rows = h < LV_PNGLE_STREAM_BAND_ROWS ? h : LV_PNGLE_STREAM_BAND_ROWS;
+        need += sizeof(lv_pngle_stream_t) + n_rows*w*PNGLE_PX_SIZE;
+        n_alloc += 2;
+    } else {
+#if !LV_PNGLE_USE_LVGL_V9
+        need += w*h*PNGLE_PX_SIZE;
+        n_alloc++;
+#endif
+    }
+    return need + n_alloc*PNGLE_ARENA_OVERHEAD;
+}
+#endif
+
+
+/** \brief Finish opening an image: report its decoding time to LVGL's image cache, which
+ *  weights entries with it, and account for the memory it holds.
+ *  \param time_to_open: target for opening time (image descriptor field).
+ *  \param hints: decoding options of image (cache priority).
+ *  \param elapsed: decoding time, in milliseconds.
+ *  \param mem: memory held by the open image, in bytes.
+ */
+static void lv_pngle_opened(uint32_t * time_to_open, const lv_pngle_hints_t * hints, uint32_t elapsed, uint32_t mem) {
+    // the cache measures opening time itself when left at 0, and takes at least 1 ms
+    *time_to_open = (elapsed > 0 ? elapsed : 1)*(hints->priority + 1);
+    lv_pngle_avg_mem = lv_pngle_avg_mem == 0 ? mem : lv_pngle_avg_mem - lv_pngle_avg_mem/8 + mem/8;
+}
+
+
+uint32_t lv_pngle_cache_fit(uint32_t budget) {
+#if LV_PNGLE_USE_LVGL_V9
+    lv_image_cache_resize(budget, true);
+    return budget;
+#else
+    // the cache holds a number of entries: size it for images of average footprint
+    uint32_t avg = lv_pngle_avg_mem > 0 ? lv_pngle_avg_mem : 1;
+    uint32_t n = budget/avg;
+    if (n < 1) n = 1;
+    if (n > UINT16_MAX) n = UINT16_MAX;
+    LV_LOG_INFO("image cache sized to %d entries of %d bytes on average\n", n, avg);
+    lv_img_cache_set_size((uint16_t)n);
+    return n;
+#endif
+}
+
+
+/** \brief Decide whether an image is decoded row by row instead of to a full buffer.
+ *  \param src: pointer to image source.
+ *  \param w: image width.
+ *  \param h: image height.
+ *  \param hints: decoding options of image (decoding mode; cache priority, raised by the decoding policy).
+ *  \returns true if image is to be decoded row by row.
+ */
+static bool lv_pngle_use_stream(const void * src, uint32_t w, uint32_t h, lv_pngle_hints_t * hints) {
+#if LV_PNGLE_USE_HINTS
+    // the asset knows best
+    if (hints->mode == LV_PNGLE_HINT_MODE_FULL) return false;
+    if (hints->mode == LV_PNGLE_HINT_MODE_STREAM) return true;
+#else
+    LV_UNUSED(hints);
+#endif
+#if LV_PNGLE_USE_POLICY
+    bool stream = _lv_pngle_policy_use_stream(src, w, h);
+    // frequently used images stay longer in LVGL's image cache
+    uint32_t priority = hints->priority + _lv_pngle_policy_get_priority(src);
+    hints->priority = priority > UINT8_MAX ? UINT8_MAX : (uint8_t)priority;
+    return stream;
+#elif LV_PNGLE_STREAM_MIN_PX > 0
+    LV_UNUSED(src);
+    return w*h >= LV_PNGLE_STREAM_MIN_PX;
+#else
+    LV_UNUSED(src);
+    LV_UNUSED(w);
+    LV_UNUSED(h);
+    return false;
+#endif
+}
+
+
+#if LV_PNGLE_USE_LAZY
+/** \brief Create the state of a lazily opened image, without decoding anything.
+ *
+ *  The header has been validated already by the info callback.
+ *
+ *  \param in: input to decode from when first drawn.
+ *  \param w: image width.
+ *  \param h: image height.
+ *  \param src: pointer to image source (for decoding options).
+ *  \param hints: decoding options of image.
+ *  \returns pointer to decoding state, or NULL if failed.
+ */
+static lv_pngle_stream_t * lv_pngle_lazy_create(const lv_pngle_input_t * in, uint32_t w, uint32_t h, const void * src,
+                                                const lv_pngle_hints_t * hints) {
+    lv_pngle_stream_t * s = (lv_pngle_stream_t*)PNGLE_MALLOC(sizeof(lv_pngle_stream_t));
+    if (s == NULL) return NULL;
+    memset(s, 0, sizeof(lv_pngle_stream_t));
+    s->lazy = true;
+    s->in = *in;
+    s->img_src = src;
+    s->hints = *hints;
+    s->ud.width = w;
+    s->height = h;
+    lv_pngle_lazy_stats.opened++;
+    return s;
+}
+
+
+/** \brief Decode a lazily opened image on first draw, row by row or to a full buffer
+ *  depending on how it would have been decoded when opened.
+ *  \param s: pointer to decoding state.
+ *  \param time_to_open: target for decoding time (image descriptor field).
+ *  \returns LV_RES_OK if successful, LV_RES_INV if failed.
+ */
+static lv_res_t lv_pngle_lazy_resolve(lv_pngle_stream_t * s, uint32_t * time_to_open) {
+    uint32_t t0 = lv_tick_get();
+    uint32_t w = s->ud.width;
+    uint32_t h = s->height;
+    s->lazy = false;
+    if (lv_pngle_use_stream(s->img_src, w, h, &s->hints) && lv_pngle_stream_init(s, &s->in, w, h, s->img_src) == LV_RES_OK) {
+        lv_pngle_lazy_stats.streamed++;
+        lv_pngle_opened(time_to_open, &s->hints, lv_tick_elaps(t0), lv_pngle_stream_mem(s));
+        return LV_RES_OK;
+    }
+    // rows are then served from the full buffer
+    s->ud.width = w;
+    s->full = lv_pngle_decode_full(&s->in, s->img_src, w, h, LV_PNGLE_FORMAT_TRUE_COLOR_ALPHA);
+    if (s->full == NULL) return LV_RES_INV;
+    lv_pngle_lazy_stats.decoded++;
+    lv_pngle_opened(time_to_open, &s->hints, lv_tick_elaps(t0), w*h*PNGLE_PX_SIZE);
+    return LV_RES_OK;
+}
+
+
+void lv_pngle_lazy_get_stats(lv_pngle_lazy_stats_t * stats) {
+    *stats = lv_pngle_lazy_stats;
+}
+#endif
+
+
+/** \brief Get the format an image is decoded to.
+ *  \param format: requested format.
+ *  \returns requested format if it can be produced, LV_PNGLE_FORMAT_TRUE_COLOR_ALPHA otherwise.
+ */
+static lv_pngle_format_t lv_pngle_resolve_format(lv_pngle_format_t format) {
+    switch (format) {
+    case LV_PNGLE_FORMAT_TRUE_COLOR:
+    case LV_PNGLE_FORMAT_INDEXED:
+    case LV_PNGLE_FORMAT_ALPHA:
+        return format;
+#if LV_PNGLE_USE_LVGL_V9
+    case LV_PNGLE_FORMAT_ARGB8888:
+        return format;
+    case LV_PNGLE_FORMAT_CHROMA_KEYED:
+        LV_LOG_WARN("LVGL v9 has no chroma-keyed format, decoding PNG image with alpha.\n");
+        return LV_PNGLE_FORMAT_TRUE_COLOR_ALPHA;
+#else
+    case LV_PNGLE_FORMAT_CHROMA_KEYED:
+        return format;
+    case LV_PNGLE_FORMAT_ARGB8888:
+        // same layout as native color with alpha at 32-bit color depth
+        if (LV_COLOR_DEPTH != 32) LV_LOG_WARN("ARGB8888 requires 32-bit colors, decoding PNG image with native colors.\n");
+        return LV_PNGLE_FORMAT_TRUE_COLOR_ALPHA;
+#endif
+    default:
+        return LV_PNGLE_FORMAT_TRUE_COLOR_ALPHA;
+    }
+}
+
+
+#if LV_PNGLE_USE_LVGL_V9
+/** \brief Get the LVGL color format of decoded images.
+ *  \param format: output format.
+ *  \returns color format.
+ */
+static lv_color_format_t lv_pngle_format_cf(lv_pngle_format_t format) {
+    switch (format) {
+#if LV_COLOR_DEPTH == 16
+    case LV_PNGLE_FORMAT_TRUE_COLOR: return LV_COLOR_FORMAT_RGB565;
+#else
+    case LV_PNGLE_FORMAT_TRUE_COLOR: return LV_COLOR_FORMAT_RGB888;
+#endif
+    case LV_PNGLE_FORMAT_ALPHA: return LV_COLOR_FORMAT_A8;
+    case LV_PNGLE_FORMAT_ARGB8888: return LV_COLOR_FORMAT_ARGB8888;
+    // indexed images are expanded to the default format row by row
+    default: return PNGLE_CF;
+    }
+}
+
+
+static lv_res_t pngle_decoder_info(lv_image_decoder_t * decoder, lv_image_decoder_dsc_t * dsc, lv_image_header_t * header) {
+    LV_UNUSED(decoder);
+    lv_pngle_input_t in;
+    if (_lv_pngle_get_src(dsc->src, &in) != LV_RES_OK) return LV_RES_INV;
+
+    uint32_t w, h;
+    if (_lv_pngle_read_header(&in, &w, &h) != LV_RES_OK) return LV_RES_INV;
+    // hints aren't read here, so that info needs no access to image data when size is known
+    header->cf = lv_pngle_format_cf(lv_pngle_resolve_format(_lv_pngle_get_format(dsc->src)));
+    header->w = w;
+    header->h = h;
+    header->stride = lv_draw_buf_width_to_stride(w, header->cf);
+    return LV_RES_OK;
+}
+
+
+/** \brief Apply the processing requested by LVGL (premultiplication, stride alignment) to a decoded image.
+ *  \param dsc: image descriptor containing decoding arguments.
+ *  \param decoded: decoded image (ownership is taken).
+ *  \returns processed image, or NULL if failed.
+ */
+static lv_draw_buf_t * lv_pngle_post_process(lv_image_decoder_dsc_t * dsc, lv_draw_buf_t * decoded) {
+    lv_draw_buf_t * adjusted = lv_image_decoder_post_process(dsc, decoded);
+    if (adjusted != decoded) lv_draw_buf_destroy(decoded);
+    return adjusted;
+}
+
+
+/** \brief Hand a decoded image over to LVGL's image cache, which then owns it.
+ *  \param decoder: underlying image decoder.
+ *  \param dsc: image descriptor containing source info.
+ *  \param decoded: decoded image.
+ *  \returns cache entry, or NULL if failed (image is then still owned by caller).
+ */
+static lv_cache_entry_t * lv_pngle_add_to_cache(lv_image_decoder_t * decoder, lv_image_decoder_dsc_t * dsc,
+                                                lv_draw_buf_t * decoded) {
+    lv_image_cache_data_t search_key;
+    memset(&search_key, 0, sizeof(search_key));
+    search_key.src_type = dsc->src_type;
+    search_key.src = dsc->src;
+    search_key.slot.size = decoded->data_size;
+    return lv_image_decoder_add_to_cache(decoder, &search_key, decoded, NULL);
+}
+
+
+/** \brief Hand a decoded image over to LVGL.
+ *  \param decoder: underlying image decoder.
+ *  \param dsc: image descriptor containing source info.
+ *  \param decoded: decoded image (ownership is taken).
+ *  \returns LV_RES_OK if successful, LV_RES_INV if failed.
+ */
+static lv_res_t lv_pngle_open_decoded(lv_image_decoder_t * decoder, lv_image_decoder_dsc_t * dsc, lv_draw_buf_t * decoded) {
+    decoded = lv_pngle_post_process(dsc, decoded);
+    if (decoded == NULL) return LV_RES_INV;
+    dsc->decoded = decoded;
+
+    if (dsc->args.no_cache || !lv_image_cache_is_enabled()) return LV_RES_OK;
+
+    lv_cache_entry_t * entry = lv_pngle_add_to_cache(decoder, dsc, decoded);
+    if (entry == NULL) {
+        lv_draw_buf_destroy(decoded);
+        dsc->decoded = NULL;
+        return LV_RES_INV;
+    }
+    dsc->cache_entry = entry;
+    return LV_RES_OK;
+}
+
+
+static lv_draw_buf_t * lv_pngle_decode_full(const lv_pngle_input_t * in, const void * src, uint32_t w, uint32_t h,
+                                            lv_pngle_format_t format) {
+#if LV_PNGLE_USE_ARENA
+    // decoded image is taken from LVGL's memory
+    if (!_lv_pngle_arena_fits(lv_pngle_arena_need(w, h, false), PNGLE_ARENA_STATE_SIZE)) return NULL;
+#endif
+    lv_draw_buf_t * decoded = lv_draw_buf_create(w, h, lv_pngle_format_cf(format), LV_STRIDE_AUTO);
+    if (decoded == NULL) {
+        LV_LOG_ERROR("couldn't allocate memory for image.\n");
+        return NULL;
+    }
+
+    lv_pngle_data_t ud;
+    _lv_pngle_data_init(&ud, w, h);
+    _lv_pngle_get_tint(src, &ud);
+    ud.format = format;
+    ud.data = decoded->data;
+    ud.stride = decoded->header.stride;
+#if PNGLE_PLANAR_ALPHA
+    if (format == LV_PNGLE_FORMAT_TRUE_COLOR_ALPHA) {
+        // alpha plane follows color plane, with half its stride
+        ud.alpha = decoded->data + ud.stride*h;
+        ud.alpha_stride = ud.stride/2;
+    }
+#endif
+#if LV_PNGLE_USE_POLICY
+    uint32_t t0 = lv_tick_get();
+#endif
+    if (_lv_pngle_decode(in, &ud) != LV_RES_OK) {
+        LV_LOG_ERROR("PNG decoding failed.\n");
+        lv_draw_buf_destroy(decoded);
+        return NULL;
+    }
+    LV_LOG_INFO("PNG decoding succeeded.\n");
+#if LV_PNGLE_USE_POLICY
+    _lv_pngle_policy_record_decode(src, lv_tick_elaps(t0));
+#endif
+#if LV_PNGLE_USE_ROW_HASH
+    _lv_pngle_rowhash_record(src, &ud, (w*lv_color_format_get_bpp(decoded->header.cf) + 7)/8);
+#endif
+    return decoded;
+}
+
+
+static lv_res_t pngle_decoder_open(lv_image_decoder_t * decoder, lv_image_decoder_dsc_t * dsc) {
+    uint32_t t0 = lv_tick_get();
+    lv_pngle_input_t in;
+    if (_lv_pngle_get_src(dsc->src, &in) != LV_RES_OK) return LV_RES_INV;
+
+    uint32_t png_width = dsc->header.w;
+    uint32_t png_height = dsc->header.h;
+    lv_pngle_hints_t hints;
+    lv_pngle_get_hints(dsc->src, &in, &hints);
+    lv_pngle_format_t format = lv_pngle_resolve_format(hints.format);
+#if LV_PNGLE_USE_HINTS
+    // info reported the format requested through the wrapper only
+    dsc->header.cf = lv_pngle_format_cf(format);
+    dsc->header.stride = lv_draw_buf_width_to_stride(png_width, dsc->header.cf);
+#endif
+    if (format == LV_PNGLE_FORMAT_INDEXED) {
+        // rows are expanded through get_area
+        lv_pngle_stream_t * s = lv_pngle_indexed_create(&in, png_width, png_height, dsc->src);
+        if (s != NULL) {
+            dsc->user_data = s;
+            dsc->decoded = NULL;
+            lv_pngle_opened(&dsc->time_to_open, &hints, lv_tick_elaps(t0), lv_pngle_stream_mem(s));
+            return LV_RES_OK;
+        }
+        format = LV_PNGLE_FORMAT_TRUE_COLOR_ALPHA;
+    }
+#if LV_PNGLE_USE_QUEUE
+    if (format == LV_PNGLE_FORMAT_TRUE_COLOR_ALPHA) {
+        // image may have been decoded in advance by the decode queue
+        uint32_t elapsed;
+        lv_draw_buf_t * ready = (lv_draw_buf_t*)_lv_pngle_queue_take(dsc->src, &elapsed);
+        if (ready != NULL) {
+            // weighted with the time it took the queue to decode it
+            lv_pngle_opened(&dsc->time_to_open, &hints, elapsed + lv_tick_elaps(t0), ready->data_size);
+            return lv_pngle_open_decoded(decoder, dsc, ready);
+        }
+    }
+#endif
+#if LV_PNGLE_USE_LAZY
+    if (format == LV_PNGLE_FORMAT_TRUE_COLOR_ALPHA) {
+        // decoded when get_area is first called
+        lv_pngle_stream_t * s = lv_pngle_lazy_create(&in, png_width, png_height, dsc->src, &hints);
+        if (s != NULL) {
+            dsc->user_data = s;
+            dsc->decoded = NULL;
+            return LV_RES_OK;
+        }
+    }
+#endif
+    if (format == LV_PNGLE_FORMAT_TRUE_COLOR_ALPHA && lv_pngle_use_stream(dsc->src, png_width, png_height, &hints)) {
+        // leave decoded empty so that LVGL fetches rows through get_area
+        lv_pngle_stream_t * s = lv_pngle_stream_create(&in, png_width, png_height, dsc->src);
+        if (s != NULL) {
+            dsc->user_data = s;
+            dsc->decoded = NULL;
+            lv_pngle_opened(&dsc->time_to_open, &hints, lv_tick_elaps(t0), lv_pngle_stream_mem(s));
+            return LV_RES_OK;
+        }
+    }
+
+    lv_draw_buf_t * decoded = lv_pngle_decode_full(&in, dsc->src, png_width, png_height, format);
+    if (decoded == NULL) return LV_RES_INV;
+    lv_pngle_opened(&dsc->time_to_open, &hints, lv_tick_elaps(t0), decoded->data_size);
+    return lv_pngle_open_decoded(decoder, dsc, decoded);
+}
+
+
+#if LV_PNGLE_USE_LAZY
+/** \brief Decode a lazily opened image on first draw. A full buffer is handed over to LVGL's
+ *  image cache, so that the image isn't decoded again when reopened.
+ *  \param decoder: underlying image decoder.
+ *  \param dsc: image descriptor containing source info.
+ *  \param s: pointer to decoding state.
+ *  \returns LV_RES_OK if successful, LV_RES_INV if failed.
+ */
+static lv_res_t lv_pngle_lazy_get_area(lv_image_decoder_t * decoder, lv_image_decoder_dsc_t * dsc, lv_pngle_stream_t * s) {
+    if (lv_pngle_lazy_resolve(s, &dsc->time_to_open) != LV_RES_OK) return LV_RES_INV;
+    if (s->full == NULL) return LV_RES_OK;
+    s->full = lv_pngle_post_process(dsc, s->full);
+    if (s->full == NULL) return LV_RES_INV;
+    if (dsc->args.no_cache || !lv_image_cache_is_enabled() || dsc->cache_entry != NULL) return LV_RES_OK;
+
+    // released by LVGL when the descriptor is closed
+    lv_cache_entry_t * entry = lv_pngle_add_to_cache(decoder, dsc, s->full);
+    if (entry != NULL) {
+        dsc->cache_entry = entry;
+        s->full_cached = true;
+    }
+    return LV_RES_OK;
+}
+#endif
+
+
+static lv_res_t pngle_decoder_get_area(lv_image_decoder_t * decoder, lv_image_decoder_dsc_t * dsc,
+                                       const lv_area_t * full_area, lv_area_t * decoded_area) {
+    LV_UNUSED(decoder);
+    lv_pngle_stream_t * s = (lv_pngle_stream_t*)dsc->user_data;
+    if (s == NULL) return LV_RES_INV;
+#if LV_PNGLE_USE_LAZY
+    if (s->lazy && lv_pngle_lazy_get_area(decoder, dsc, s) != LV_RES_OK) return LV_RES_INV;
+#endif
+
+    int32_t w = lv_area_get_width(full_area);
+    if (decoded_area->y1 == LV_COORD_MIN) {
+        if (full_area->x1 < 0 || w <= 0 || (uint32_t)full_area->x2 >= s->ud.width) {
+            LV_LOG_ERROR("Requested pixels outside PNG boundaries.\n");
+            return LV_RES_INV;
+        }
+        if (s->row == NULL || s->row->header.w != (uint32_t)w) {
+            if (s->row != NULL) lv_draw_buf_destroy(s->row);
+            s->row = lv_draw_buf_create(w, 1, PNGLE_CF, LV_STRIDE_AUTO);
+            if (s->row == NULL) {
+                LV_LOG_ERROR("couldn't allocate memory for row.\n");
+                return LV_RES_INV;
+            }
+        }
+        *decoded_area = *full_area;
+        decoded_area->y2 = decoded_area->y1;
+    } else {
+        decoded_area->y1++;
+        decoded_area->y2++;
+    }
+    if (decoded_area->y1 > full_area->y2) return LV_RES_INV;
+
+    const uint8_t * row;
+    const uint8_t * alpha;
+#if LV_PNGLE_USE_LAZY
+    if (s->full != NULL) {
+        // alpha plane follows color plane, with half its stride
+        uint32_t stride = s->full->header.stride;
+        row = s->full->data + decoded_area->y1*stride;
+        alpha = s->full->data + stride*s->height + decoded_area->y1*(stride/2);
+    } else
+#endif
+    {
+        row = lv_pngle_stream_get_row(s, decoded_area->y1, full_area->x1, w);
+        if (row == NULL) {
+            LV_LOG_ERROR("PNG decoding failed.\n");
+            return LV_RES_INV;
+        }
+        // each row holds color data followed by alpha values
+        alpha = row + s->ud.width*PNGLE_COLOR_SIZE;
+    }
+    memcpy(s->row->data, row + full_area->x1*PNGLE_COLOR_SIZE, w*PNGLE_COLOR_SIZE);
+#if PNGLE_PLANAR_ALPHA
+    memcpy(s->row->data + s->row->header.stride, alpha + full_area->x1, w);
+#else
+    LV_UNUSED(alpha);
+#endif
+    dsc->decoded = s->row;
+    return LV_RES_OK;
+}
+
+
+static void pngle_decoder_close(lv_image_decoder_t * decoder, lv_image_decoder_dsc_t * dsc) {
+    LV_UNUSED(decoder);
+    lv_pngle_stream_t * s = (lv_pngle_stream_t*)dsc->user_data;
+    if (s != NULL) {
+        lv_pngle_stream_destroy(s);
+        dsc->user_data = NULL;
+        dsc->decoded = NULL;
+    } else if (dsc->args.no_cache || !lv_image_cache_is_enabled()) {
+        lv_draw_buf_destroy((lv_draw_buf_t *)dsc->decoded);
+        dsc->decoded = NULL;
+    }
+}
+
+#else
+
+/** \brief Get the LVGL color format of decoded images.
+ *  \param format: output format.
+ *  \returns color format.
+ */
+static lv_img_cf_t lv_pngle_format_cf(lv_pngle_format_t format) {
+    switch (format) {
+    case LV_PNGLE_FORMAT_TRUE_COLOR: return LV_IMG_CF_RAW;
+    case LV_PNGLE_FORMAT_CHROMA_KEYED: return LV_IMG_CF_RAW_CHROMA_KEYED;
+    case LV_PNGLE_FORMAT_ALPHA: return LV_IMG_CF_ALPHA_8BIT;
+    // indexed images are expanded to native color with alpha by read_line
+    default: return LV_IMG_CF_RAW_ALPHA;
+    }
+}
+
+
+/** \brief Get the number of bytes per pixel of decoded images.
+ *  \param format: output format.
+ *  \returns number of bytes per pixel.
+ */
+static uint32_t lv_pngle_format_px_size(lv_pngle_format_t format) {
+    switch (format) {
+    case LV_PNGLE_FORMAT_TRUE_COLOR:
+    case LV_PNGLE_FORMAT_CHROMA_KEYED: return sizeof(lv_color_t);
+    case LV_PNGLE_FORMAT_ALPHA: return 1;
+    default: return PNGLE_PX_SIZE;
+    }
+}
+
+
+static lv_res_t pngle_decoder_info(struct _lv_img_decoder_t * decoder, const void * src, lv_img_header_t * header) {
+    LV_UNUSED(decoder);
+    lv_pngle_input_t in;
+    if (_lv_pngle_get_src(src, &in) != LV_RES_OK) return LV_RES_INV;
+
+    uint32_t w, h;
+    if (_lv_pngle_read_header(&in, &w, &h) != LV_RES_OK) return LV_RES_INV;
+    // hints aren't read here, so that info needs no access to image data when size is known
+    header->always_zero = 0;
+    header->cf = lv_pngle_format_cf(lv_pngle_resolve_format(_lv_pngle_get_format(src)));
+    header->w = (lv_coord_t)w;
+    header->h = (lv_coord_t)h;
+    return LV_RES_OK;
+}
+
+
+static lv_res_t pngle_decoder_open(lv_img_decoder_t * decoder, lv_img_decoder_dsc_t * dsc) {
+    LV_UNUSED(decoder);
+    uint32_t t0 = lv_tick_get();
+    lv_pngle_input_t in;
+    if (_lv_pngle_get_src(dsc->src, &in) != LV_RES_OK) return LV_RES_INV;
+
+    uint32_t png_width = dsc->header.w;
+    uint32_t png_height = dsc->header.h;
+    lv_pngle_hints_t hints;
+    lv_pngle_get_hints(dsc->src, &in, &hints);
+    lv_pngle_format_t format = lv_pngle_resolve_format(hints.format);
+#if LV_PNGLE_USE_HINTS
+    // info reported the format requested through the wrapper only
+    dsc->header.cf = lv_pngle_format_cf(format);
+#endif
+    if (format == LV_PNGLE_FORMAT_INDEXED) {
+        // rows are expanded through read_line
+        lv_pngle_stream_t * s = lv_pngle_indexed_create(&in, png_width, png_height, dsc->src);
+        if (s != NULL) {
+            dsc->user_data = s;
+            dsc->img_data = NULL;
+            lv_pngle_opened(&dsc->time_to_open, &hints, lv_tick_elaps(t0), lv_pngle_stream_mem(s));
+            return LV_RES_OK;
+        }
+        format = LV_PNGLE_FORMAT_TRUE_COLOR_ALPHA;
+    }
+#if LV_PNGLE_USE_QUEUE
+    if (format == LV_PNGLE_FORMAT_TRUE_COLOR_ALPHA) {
+        // image may have been decoded in advance by the decode queue
+        uint32_t elapsed;
+        uint8_t * ready = (uint8_t*)_lv_pngle_queue_take(dsc->src, &elapsed);
+        if (ready != NULL) {
+            // weighted with the time it took the queue to decode it
+            lv_pngle_opened(&dsc->time_to_open, &hints, elapsed + lv_tick_elaps(t0), png_width*png_height*PNGLE_PX_SIZE);
+            dsc->img_data = ready;
+            return LV_RES_OK;
+        }
+    }
+#endif
+#if LV_PNGLE_USE_LAZY
+    if (format == LV_PNGLE_FORMAT_TRUE_COLOR_ALPHA) {
+        // decoded when read_line is first called
+        lv_pngle_stream_t * s = lv_pngle_lazy_create(&in, png_width, png_height, dsc->src, &hints);
+        if (s != NULL) {
+            dsc->user_data = s;
+            dsc->img_data = NULL;
+            return LV_RES_OK;
+        }
+    }
+#endif
+    if (format == LV_PNGLE_FORMAT_TRUE_COLOR_ALPHA && lv_pngle_use_stream(dsc->src, png_width, png_height, &hints)) {
+        // leave img_data empty so that LVGL fetches rows through read_line
+        lv_pngle_stream_t * s = lv_pngle_stream_create(&in, png_width, png_height, dsc->src);
+        if (s != NULL) {
+            dsc->user_data = s;
+            dsc->img_data = NULL;
+            lv_pngle_opened(&dsc->time_to_open, &hints, lv_tick_elaps(t0), lv_pngle_stream_mem(s));
+            return LV_RES_OK;
+        }
+    }
+
+    uint8_t * decoded = lv_pngle_decode_full(&in, dsc->src, png_width, png_height, format);
+    if (decoded == NULL) return LV_RES_INV;
+    lv_pngle_opened(&dsc->time_to_open, &hints, lv_tick_elaps(t0), png_width*png_height*lv_pngle_format_px_size(format));
+    dsc->img_data = decoded;
+    return LV_RES_OK;
+}
+
+
+static uint8_t * lv_pngle_decode_full(const lv_pngle_input_t * in, const void * src, uint32_t w, uint32_t h,
+                                      lv_pngle_format_t format) {
+    lv_pngle_data_t ud;
+    _lv_pngle_data_init(&ud, w, h);
+    _lv_pngle_get_tint(src, &ud);
+    ud.format = format;
+    ud.stride = w*lv_pngle_format_px_size(format);
+#if LV_PNGLE_USE_ARENA
+    uint32_t size = w*h*lv_pngle_format_px_size(format);
+    if (!_lv_pngle_arena_fits(lv_pngle_arena_need(w, h, false), size > PNGLE_ARENA_STATE_SIZE ? size : PNGLE_ARENA_STATE_SIZE)) return NULL;
+#endif
+    lv_pngle_buffer_init(&ud.data, w*h, lv_pngle_format_px_size(format));
+    if (ud.data == NULL) {
+        LV_LOG_ERROR("couldn't allocate memory for image.\n");
+        return NULL;
+    }
+
+#if LV_PNGLE_USE_POLICY
+    uint32_t t0 = lv_tick_get();
+#endif
+    if (_lv_pngle_decode(in, &ud) != LV_RES_OK) {
+        LV_LOG_ERROR("PNG decoding failed.\n");
+        PNGLE_FREE(ud.data);
+        return NULL;
+    }
+    LV_LOG_INFO("PNG decoding succeeded.\n");
+#if LV_PNGLE_USE_POLICY
+    _lv_pngle_policy_record_decode(src, lv_tick_elaps(t0));
+#endif
+#if LV_PNGLE_USE_ROW_HASH
+    _lv_pngle_rowhash_record(src, &ud, w*lv_pngle_format_px_size(format));
+#endif
+    return ud.data;
+}
+
+static lv_res_t pngle_decoder_read_line(lv_img_decoder_t * decoder, lv_img_decoder_dsc_t * dsc,
+                                        lv_coord_t x, lv_coord_t y, lv_coord_t len, uint8_t * buf) {
+    LV_UNUSED(decoder);
+    lv_pngle_stream_t * s = (lv_pngle_stream_t*)dsc->user_data;
+    if (s == NULL) return LV_RES_INV;
+
+    // check that image is large enough to read requested length starting from provided coordinates
+    if (x < 0 || len <= 0 || (uint32_t)(x + len) > s->ud.width) {
+        LV_LOG_ERROR("Requested pixels outside PNG boundaries.\n");
+        return LV_RES_INV;
+    }
+#if LV_PNGLE_USE_LAZY
+    if (s->lazy) {
+        if (lv_pngle_lazy_resolve(s, &dsc->time_to_open) != LV_RES_OK) return LV_RES_INV;
+        // later draws use the full buffer directly; it's freed on close with img_data
+        if (s->full != NULL) dsc->img_data = s->full;
+    }
+    if (s->full != NULL) {
+        if (y < 0 || (uint32_t)y >= s->height) return LV_RES_INV;
+        memcpy(buf, s->full + (y*s->ud.width + x)*PNGLE_PX_SIZE, len*PNGLE_PX_SIZE);
+        return LV_RES_OK;
+    }
+#endif
+    const uint8_t * row = lv_pngle_stream_get_row(s, y, x, len);
+    if (row == NULL) {
+        LV_LOG_ERROR("PNG decoding failed.\n");
+        return LV_RES_INV;
+    }
+    memcpy(buf, row + x*PNGLE_PX_SIZE, len*PNGLE_PX_SIZE);
+    return LV_RES_OK;
+}
+
+static void pngle_decoder_close(lv_img_decoder_t * decoder, lv_img_decoder_dsc_t * dsc) {
+    LV_UNUSED(decoder);
+    if (dsc->user_data) {
+        lv_pngle_stream_destroy((lv_pngle_stream_t*)dsc->user_data);
+        dsc->user_data = NULL;
+    }
+    if(dsc->img_data) {
+        PNGLE_FREE((uint8_t *)dsc->img_data);
+        dsc->img_data = NULL;
+    }
+}
+#endif
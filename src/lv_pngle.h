@@ -10,13 +10,1088 @@
 extern "C" {
 #endif
 
-#include "lv_conf_internal.h"
+#include "lvgl.h"
+
+/** \brief If 1, the decoder is built against LVGL v9 decoder API (lv_draw_buf_t, get_area, image cache).
+ *  Defaults to the version of LVGL found in lvgl.h.
+ */
+#ifndef LV_PNGLE_USE_LVGL_V9
+#define LV_PNGLE_USE_LVGL_V9 (LVGL_VERSION_MAJOR >= 9)
+#endif
+
+/** \brief Images with at least this number of pixels are decoded row by row when drawn
+ *  instead of being decoded to a full buffer when opened. 0 disables streaming.
+ */
+#ifndef LV_PNGLE_STREAM_MIN_PX
+#define LV_PNGLE_STREAM_MIN_PX 0
+#endif
+
+/** \brief Number of decoded rows kept in memory when streaming. */
+#ifndef LV_PNGLE_STREAM_BAND_ROWS
+#define LV_PNGLE_STREAM_BAND_ROWS 8
+#endif
+
+/** \brief If 1, mip chains (image downscaled by 2, 4, ...) can be generated for images displayed with zoom. */
+#ifndef LV_PNGLE_USE_MIPMAP
+#define LV_PNGLE_USE_MIPMAP 0
+#endif
+
+/** \brief Maximum number of downscaled levels in a mip chain. */
+#ifndef LV_PNGLE_MIPMAP_MAX_LEVELS
+#define LV_PNGLE_MIPMAP_MAX_LEVELS 4
+#endif
+
+/** \brief If 1, nine-patch images (stretchable images with fixed corners) can be decoded and drawn. */
+#ifndef LV_PNGLE_USE_NINEPATCH
+#define LV_PNGLE_USE_NINEPATCH 0
+#endif
+
+/** \brief Maximum number of fixed and stretchable segments along each axis of a nine-patch image. */
+#ifndef LV_PNGLE_NINEPATCH_MAX_SEGS
+#define LV_PNGLE_NINEPATCH_MAX_SEGS 5
+#endif
+
+/** \brief If 1, PNG files are watched with inotify (Linux only) and cached copies
+ *  of them are dropped as soon as they change.
+ */
+#ifndef LV_PNGLE_USE_WATCH
+#define LV_PNGLE_USE_WATCH 0
+#endif
+
+/** \brief Path prepended to file paths (drive letter removed) to get paths on the host
+ *  filesystem. Should match the path of the LVGL filesystem driver (e.g. LV_FS_POSIX_PATH).
+ */
+#ifndef LV_PNGLE_WATCH_ROOT
+#define LV_PNGLE_WATCH_ROOT ""
+#endif
+
+/** \brief Maximum number of watched files. */
+#ifndef LV_PNGLE_WATCH_MAX_FILES
+#define LV_PNGLE_WATCH_MAX_FILES 64
+#endif
+
+/** \brief Maximum number of watched directories. */
+#ifndef LV_PNGLE_WATCH_MAX_DIRS
+#define LV_PNGLE_WATCH_MAX_DIRS 8
+#endif
+
+/** \brief Period at which file change events are processed, in milliseconds. */
+#ifndef LV_PNGLE_WATCH_PERIOD
+#define LV_PNGLE_WATCH_PERIOD 500
+#endif
+
+/** \brief If 1, decoding cost of PNG images can be estimated from their header. */
+#ifndef LV_PNGLE_USE_COST
+#define LV_PNGLE_USE_COST 0
+#endif
+
+/** \brief Initial estimate of decoding time per pixel, in nanoseconds (refined by measurements). */
+#ifndef LV_PNGLE_COST_NS_PER_PX
+#define LV_PNGLE_COST_NS_PER_PX 150
+#endif
+
+/** \brief Initial estimate of decoding time per byte of unfiltered image data, in nanoseconds. */
+#ifndef LV_PNGLE_COST_NS_PER_RAW_BYTE
+#define LV_PNGLE_COST_NS_PER_RAW_BYTE 40
+#endif
+
+/** \brief Initial estimate of decoding time per byte of compressed image data, in nanoseconds. */
+#ifndef LV_PNGLE_COST_NS_PER_BYTE
+#define LV_PNGLE_COST_NS_PER_BYTE 80
+#endif
+
+/** \brief If 1, images can be decoded in advance by a prioritized decode queue run from an LVGL timer. */
+#ifndef LV_PNGLE_USE_QUEUE
+#define LV_PNGLE_USE_QUEUE 0
+#endif
+
+/** \brief Period of the timer running the decode queue, in milliseconds. */
+#ifndef LV_PNGLE_QUEUE_PERIOD
+#define LV_PNGLE_QUEUE_PERIOD 10
+#endif
+
+/** \brief Time spent decoding at each run of the decode queue, in milliseconds. */
+#ifndef LV_PNGLE_QUEUE_SLICE_MS
+#define LV_PNGLE_QUEUE_SLICE_MS 5
+#endif
+
+/** \brief Maximum number of decoded images waiting to be opened; older ones are dropped. */
+#ifndef LV_PNGLE_QUEUE_MAX_READY
+#define LV_PNGLE_QUEUE_MAX_READY 4
+#endif
+
+/** \brief If 1, PNG images too large to be decoded in memory can be displayed by tiles. */
+#ifndef LV_PNGLE_USE_HUGE
+#define LV_PNGLE_USE_HUGE 0
+#endif
+
+/** \brief Width and height of tiles of huge images, in pixels. */
+#ifndef LV_PNGLE_HUGE_TILE_SIZE
+#define LV_PNGLE_HUGE_TILE_SIZE 64
+#endif
+
+/** \brief Number of decoded tiles kept in memory per huge image (must cover the displayed area). */
+#ifndef LV_PNGLE_HUGE_CACHE_TILES
+#define LV_PNGLE_HUGE_CACHE_TILES 32
+#endif
+
+/** \brief Number of rows between recorded decoding states of huge images (about 44 kB each). */
+#ifndef LV_PNGLE_HUGE_BAND_ROWS
+#define LV_PNGLE_HUGE_BAND_ROWS 128
+#endif
+
+/** \brief If 1, decoded pixels are mapped to a global palette set with lv_pngle_palette_set
+ *  (LVGL v8 with 8-bit colors, for displays with a fixed 256-color palette).
+ */
+#ifndef LV_PNGLE_USE_PALETTE
+#define LV_PNGLE_USE_PALETTE 0
+#endif
+
+/** \brief Bits kept per color channel to index the palette lookup table (table size: 2^(3*bits) bytes). */
+#ifndef LV_PNGLE_PALETTE_LUT_BITS
+#define LV_PNGLE_PALETTE_LUT_BITS 5
+#endif
+
+/** \brief If 1, tinted variants of images are shared through a variant table (see lv_pngle_variant_get). */
+#ifndef LV_PNGLE_USE_VARIANTS
+#define LV_PNGLE_USE_VARIANTS 0
+#endif
+
+/** \brief If 1, header fields of PNG files can be read from an asset manifest instead of the files. */
+#ifndef LV_PNGLE_USE_MANIFEST
+#define LV_PNGLE_USE_MANIFEST 0
+#endif
+
+/** \brief Manifest file loaded by lv_pngle_init, with LVGL drive letter ("" for none). */
+#ifndef LV_PNGLE_MANIFEST_PATH
+#define LV_PNGLE_MANIFEST_PATH ""
+#endif
+
+/** \brief Number of subdirectory levels scanned by lv_pngle_manifest_build. */
+#ifndef LV_PNGLE_MANIFEST_MAX_DEPTH
+#define LV_PNGLE_MANIFEST_MAX_DEPTH 4
+#endif
+
+/** \brief If 1, PNG images can be decoded band by band straight to a display flush function (boot splash). */
+#ifndef LV_PNGLE_USE_SPLASH
+#define LV_PNGLE_USE_SPLASH 0
+#endif
+
+/** \brief Number of rows per band when decoding to a display flush function (two bands are allocated). */
+#ifndef LV_PNGLE_SPLASH_BAND_ROWS
+#define LV_PNGLE_SPLASH_BAND_ROWS 16
+#endif
+
+/** \brief If 1, images are decoded fully or row by row depending on their size, on how often
+ *  they're opened and redrawn, and on free memory (see lv_pngle_policy_get_stats), and frequently
+ *  used images get a higher priority in LVGL's image cache. LV_PNGLE_STREAM_MIN_PX is then ignored.
+ *  Downscaling isn't chosen by the policy, as the decoder doesn't know how images are shown:
+ *  see mip chains (LV_PNGLE_USE_MIPMAP) for images shown zoomed out.
+ */
+#ifndef LV_PNGLE_USE_POLICY
+#define LV_PNGLE_USE_POLICY 0
+#endif
+
+/** \brief Number of images whose decoding costs are remembered by the decoding policy. */
+#ifndef LV_PNGLE_POLICY_SLOTS
+#define LV_PNGLE_POLICY_SLOTS 32
+#endif
+
+/** \brief Images with fewer pixels are always decoded to a full buffer. */
+#ifndef LV_PNGLE_POLICY_SMALL_PX
+#define LV_PNGLE_POLICY_SMALL_PX 4096
+#endif
+
+/** \brief Large images opened at least this number of times are decoded to a full buffer,
+ *  as long as they're reopened within LV_PNGLE_POLICY_HOT_MS.
+ */
+#ifndef LV_PNGLE_POLICY_HOT_OPENS
+#define LV_PNGLE_POLICY_HOT_OPENS 3
+#endif
+
+/** \brief Maximum time between two openings of a frequently used image, in milliseconds. */
+#ifndef LV_PNGLE_POLICY_HOT_MS
+#define LV_PNGLE_POLICY_HOT_MS 10000
+#endif
+
+/** \brief Images decoded more than this number of times while streamed are decoded to a full buffer from then on. */
+#ifndef LV_PNGLE_POLICY_MAX_PASSES
+#define LV_PNGLE_POLICY_MAX_PASSES 4
+#endif
+
+/** \brief Cache priority of images decoded fully because they're used often: their decoding
+ *  time reported to LVGL's image cache is multiplied by this plus 1.
+ */
+#ifndef LV_PNGLE_POLICY_HOT_PRIORITY
+#define LV_PNGLE_POLICY_HOT_PRIORITY 3
+#endif
+
+/** \brief Free memory left after allocating a full buffer, in bytes; images are streamed otherwise. */
+#ifndef LV_PNGLE_POLICY_MEM_RESERVE
+#define LV_PNGLE_POLICY_MEM_RESERVE 16384
+#endif
+
+/** \brief If 1, opening an image only sets up its decoding state, and pixels are decoded when
+ *  the image is first drawn (see lv_pngle_lazy_get_stats). Applies to images in native color with alpha.
+ */
+#ifndef LV_PNGLE_USE_LAZY
+#define LV_PNGLE_USE_LAZY 0
+#endif
+
+/** \brief If 1, images can be decoded with the opacity of their rows, and drawn without blending
+ *  fully transparent and fully opaque spans (see lv_pngle_opamap_create).
+ */
+#ifndef LV_PNGLE_USE_OPAMAP
+#define LV_PNGLE_USE_OPAMAP 0
+#endif
+
+/** \brief Shortest run of fully opaque pixels drawn without blending; shorter runs are blended with their row. */
+#ifndef LV_PNGLE_OPAMAP_MIN_RUN
+#define LV_PNGLE_OPAMAP_MIN_RUN 8
+#endif
+
+/** \brief If 1, PNG images can be read from a bundle file holding many images with an index
+ *  (see lv_pngle_bundle_open), so that only the bundle file is opened.
+ */
+#ifndef LV_PNGLE_USE_BUNDLE
+#define LV_PNGLE_USE_BUNDLE 0
+#endif
+
+/** \brief Bundle file opened by lv_pngle_init ("" for none). */
+#ifndef LV_PNGLE_BUNDLE_PATH
+#define LV_PNGLE_BUNDLE_PATH ""
+#endif
+
+/** \brief Drive letter of bundled images: image "name.png" of the bundle is given to LVGL as "B:name.png". */
+#ifndef LV_PNGLE_BUNDLE_LETTER
+#define LV_PNGLE_BUNDLE_LETTER 'B'
+#endif
+
+/** \brief If 1, the bundle file is memory-mapped and its path is a native path instead of an LVGL one (Linux only). */
+#ifndef LV_PNGLE_BUNDLE_MMAP
+#define LV_PNGLE_BUNDLE_MMAP 0
+#endif
+
+/** \brief If 1, QOI images (file name ending with qoi, or data starting with "qoif") are
+ *  decoded as well, to the same output formats as PNG images, fully or row by row.
+ */
+#ifndef LV_PNGLE_USE_QOI
+#define LV_PNGLE_USE_QOI 0
+#endif
+
+/** \brief If 1, decoding memory is taken from a static arena given to lv_pngle_init_arena
+ *  instead of the heap (decoded images as well with LVGL v8).
+ */
+#ifndef LV_PNGLE_USE_ARENA
+#define LV_PNGLE_USE_ARENA 0
+#endif
+
+/** \brief If 1, carousels of images can share a few fixed buffers, with pages decoded ahead (see lv_pngle_carousel_create). */
+#ifndef LV_PNGLE_USE_CAROUSEL
+#define LV_PNGLE_USE_CAROUSEL 0
+#endif
+
+/** \brief Number of fixed buffers of a carousel: 2 to decode the next page ahead, 3 to keep the previous one as well. */
+#ifndef LV_PNGLE_CAROUSEL_BUFFERS
+#define LV_PNGLE_CAROUSEL_BUFFERS 3
+#endif
+
+/** \brief Period of the timer decoding carousel pages ahead, in milliseconds. */
+#ifndef LV_PNGLE_CAROUSEL_PERIOD
+#define LV_PNGLE_CAROUSEL_PERIOD 10
+#endif
+
+/** \brief Time spent decoding carousel pages ahead at each run of the timer, in milliseconds. */
+#ifndef LV_PNGLE_CAROUSEL_SLICE_MS
+#define LV_PNGLE_CAROUSEL_SLICE_MS 5
+#endif
+
+/** \brief If 1, decoded images keep row hashes, so that lv_pngle_reload
+ *  (and file watching) only redraws the rows that changed.
+ */
+#ifndef LV_PNGLE_USE_ROW_HASH
+#define LV_PNGLE_USE_ROW_HASH 0
+#endif
+
+/** \brief Number of images whose row hashes are kept; the least recently decoded ones are forgotten. */
+#ifndef LV_PNGLE_ROW_HASH_MAX_IMAGES
+#define LV_PNGLE_ROW_HASH_MAX_IMAGES 8
+#endif
+
+/** \brief If 1, images can carry decoding hints in a private lvGL chunk placed before image
+ *  data (output format, decoding mode, cache priority), read when they're opened.
+ *  Chunk data: version (1) | format (lv_pngle_format_t) | mode (lv_pngle_hint_mode_t) |
+ *  cache priority (0: normal, n: weighted n+1 times), 1 byte each; bytes after these are ignored.
+ */
+#ifndef LV_PNGLE_USE_HINTS
+#define LV_PNGLE_USE_HINTS 0
+#endif
+
+#if LV_PNGLE_USE_LVGL_V9
+typedef lv_layer_t lv_pngle_draw_ctx_t; ///< Drawing target of draw helpers
+#else
+typedef lv_draw_ctx_t lv_pngle_draw_ctx_t; ///< Drawing target of draw helpers
+#endif
 
 /** \fn void lv_pngle_init(void)
  *  \brief Initializes the decoder for PNG images using Pngle.
  */
 void lv_pngle_init(void);
 
+/** \brief Output pixel formats that can be requested for an image. */
+typedef enum {
+    LV_PNGLE_FORMAT_AUTO = 0, ///< Default format (native color with alpha)
+    LV_PNGLE_FORMAT_TRUE_COLOR, ///< Native color, alpha dropped (opaque images)
+    LV_PNGLE_FORMAT_TRUE_COLOR_ALPHA, ///< Native color with alpha
+    LV_PNGLE_FORMAT_CHROMA_KEYED, ///< Native color, mostly transparent pixels set to LV_COLOR_CHROMA_KEY (LVGL v8 only)
+    LV_PNGLE_FORMAT_INDEXED, ///< 8-bit palette indices, expanded row by row when drawn (at most 256 colors)
+    LV_PNGLE_FORMAT_ALPHA, ///< Alpha channel only, drawn with image recolor
+    LV_PNGLE_FORMAT_ARGB8888, ///< 32-bit ARGB whatever the color depth (LVGL v9, or LVGL v8 with 32-bit colors)
+} lv_pngle_format_t;
+
+#if LV_PNGLE_USE_HINTS
+/** \brief Decoding modes that can be hinted by the lvGL chunk of an image. */
+typedef enum {
+    LV_PNGLE_HINT_MODE_AUTO = 0, ///< Decided by lv_pngle (decoding policy or LV_PNGLE_STREAM_MIN_PX)
+    LV_PNGLE_HINT_MODE_FULL, ///< Decoded to a full buffer
+    LV_PNGLE_HINT_MODE_STREAM, ///< Decoded row by row (images decoded to native color with alpha only)
+} lv_pngle_hint_mode_t;
+#endif
+
+/** \brief Function reading PNG data from a user source (e.g. external flash, a network stream or a pipe).
+ *  \param user_data: user data given to lv_pngle_src_init_cb.
+ *  \param pos: position of the first byte to read.
+ *  \param buf: target buffer.
+ *  \param len: number of bytes to read.
+ *  \returns number of bytes read, fewer than len only at end of data or on error.
+ */
+typedef uint32_t (*lv_pngle_read_cb_t)(void * user_data, uint32_t pos, uint8_t * buf, uint32_t len);
+
+/** \brief A PNG image source with decoding options. Pass it as image source
+ *  instead of the wrapped file path or image descriptor.
+ */
+typedef struct _lv_pngle_src_t {
+#if LV_PNGLE_USE_LVGL_V9
+    lv_image_dsc_t dsc; ///< Image descriptor seen by LVGL (points to this structure)
+#else
+    lv_img_dsc_t dsc; ///< Image descriptor seen by LVGL (points to this structure)
+#endif
+    const void * src; ///< Wrapped image source (file path or PNG image descriptor)
+    lv_pngle_format_t format; ///< Requested output format
+    lv_color_t tint; ///< Tint color baked into decoded pixels
+    lv_opa_t tint_mix; ///< Tint intensity (0: no tint, 255: pixels take the tint color)
+    lv_opa_t opa; ///< Opacity baked into decoded pixels
+    lv_pngle_read_cb_t read_cb; ///< Read function (callback sources only, src is then NULL)
+    void * user_data; ///< User data passed to read function
+    uint32_t size; ///< Size of PNG data read through read function (0 if unknown)
+} lv_pngle_src_t;
+
+/** \fn void lv_pngle_src_init(lv_pngle_src_t * s, const void * src, lv_pngle_format_t format)
+ *  \brief Wrap a PNG image source to request a specific output format.
+ *
+ *  Formats that can't be produced for the image or with the LVGL version in use
+ *  fall back to LV_PNGLE_FORMAT_TRUE_COLOR_ALPHA.
+ *
+ *  \param s: pointer to wrapper (must outlive the images using it).
+ *  \param src: pointer to image source (image descriptor or file path).
+ *  \param format: requested output format.
+ */
+void lv_pngle_src_init(lv_pngle_src_t * s, const void * src, lv_pngle_format_t format);
+
+/** \fn void lv_pngle_src_init_cb(lv_pngle_src_t * s, lv_pngle_read_cb_t read_cb, void * user_data, uint32_t size, lv_pngle_format_t format)
+ *  \brief Make an image source reading PNG data through a function.
+ *
+ *  Data is read in slices of a few hundred bytes, through a buffer. Images
+ *  decoded once from start to end only need sequential reads; row by row
+ *  decoding restarts from position 0 when rows are drawn again, and tiled
+ *  decoding of huge images reads at any position.
+ *
+ *  \param s: pointer to source (must outlive the images using it).
+ *  \param read_cb: read function.
+ *  \param user_data: user data passed to read function.
+ *  \param size: size of PNG data, or 0 if unknown.
+ *  \param format: requested output format.
+ */
+void lv_pngle_src_init_cb(lv_pngle_src_t * s, lv_pngle_read_cb_t read_cb, void * user_data, uint32_t size,
+                          lv_pngle_format_t format);
+
+/** \fn void lv_pngle_src_set_tint(lv_pngle_src_t * s, lv_color_t color, lv_opa_t mix, lv_opa_t opa)
+ *  \brief Bake a tint and an opacity into decoded pixels, with the same result as
+ *  image recolor and opacity styles but without their cost when drawing.
+ *  Opacity is dropped by formats without alpha channel.
+ *  \param s: pointer to wrapper (set before the image is first opened).
+ *  \param color: tint color.
+ *  \param mix: tint intensity (0: no tint, 255: pixels take the tint color).
+ *  \param opa: opacity.
+ */
+void lv_pngle_src_set_tint(lv_pngle_src_t * s, lv_color_t color, lv_opa_t mix, lv_opa_t opa);
+
+/** \fn uint32_t lv_pngle_cache_fit(uint32_t budget)
+ *  \brief Size LVGL's image cache so that the images it keeps open fit in a memory budget.
+ *
+ *  With LVGL v8, the cache holds a number of entries, computed from the average
+ *  memory held by images opened so far (full buffers, row buffers of streamed
+ *  images, indexed images). Call it once typical screens have been shown.
+ *  With LVGL v9, the cache size is the budget itself.
+ *
+ *  \param budget: memory for cached images, in bytes.
+ *  \returns number of cache entries (LVGL v8) or cache size in bytes (LVGL v9).
+ */
+uint32_t lv_pngle_cache_fit(uint32_t budget);
+
+#if LV_PNGLE_USE_COST
+/** \brief Estimated cost of decoding a PNG image. */
+typedef struct _lv_pngle_cost_t {
+    uint32_t width; ///< Image width
+    uint32_t height; ///< Image height
+    uint8_t bit_depth; ///< Bits per sample
+    uint8_t color_type; ///< PNG color type
+    bool interlaced; ///< If true, image is interlaced (Adam7) and can't be decoded row by row
+    uint32_t idat_size; ///< Total size of compressed image data, in bytes
+    uint16_t idat_count; ///< Number of IDAT chunks
+    uint32_t time_us; ///< Estimated decoding time, in microseconds
+    uint32_t mem_full; ///< Estimated peak memory when decoding to a full buffer, in bytes
+    uint32_t mem_stream; ///< Estimated peak memory when decoding row by row, in bytes (0 if not possible)
+} lv_pngle_cost_t;
+
+/** \fn bool lv_pngle_estimate_cost(const void * src, lv_pngle_cost_t * cost)
+ *  \brief Estimate decoding time and peak memory of a PNG image without decoding it.
+ *
+ *  Only chunk headers are read. Time estimates are calibrated with the decoding
+ *  times measured so far. Memory estimates assume the default output format.
+ *
+ *  \param src: pointer to image source (image descriptor or file path).
+ *  \param cost: target for estimates.
+ *  \returns true if successful, false if source isn't a readable PNG image.
+ */
+bool lv_pngle_estimate_cost(const void * src, lv_pngle_cost_t * cost);
+#endif
+
+#if LV_PNGLE_USE_QUEUE
+/** \brief Priorities of decode requests. */
+typedef enum {
+    LV_PNGLE_PRIO_BACKGROUND = 0, ///< Images that may be needed at some point
+    LV_PNGLE_PRIO_PREFETCH, ///< Images of the next screen
+    LV_PNGLE_PRIO_VISIBLE, ///< Images being displayed
+} lv_pngle_prio_t;
+
+/** \brief A decode request. */
+typedef struct _lv_pngle_request_t lv_pngle_request_t;
+
+/** \brief Function called when a requested image is decoded.
+ *  \param src: pointer to image source, as given to lv_pngle_queue_add.
+ *  \param ok: true if image was decoded, false if decoding failed.
+ *  \param user_data: data given to lv_pngle_queue_add.
+ */
+typedef void (*lv_pngle_ready_cb_t)(const void * src, bool ok, void * user_data);
+
+/** \brief Decode queue counters. */
+typedef struct _lv_pngle_queue_stats_t {
+    uint32_t requested; ///< Number of requests
+    uint32_t coalesced; ///< Number of requests served by the decoding of an earlier request for the same source
+    uint32_t completed; ///< Number of images decoded
+    uint32_t failed; ///< Number of images that couldn't be decoded
+    uint32_t dropped; ///< Number of decoded images dropped before being opened
+    uint32_t cancelled_queued; ///< Number of decodings cancelled before starting
+    uint32_t cancelled_running; ///< Number of decodings cancelled while running
+    uint32_t bytes_avoided; ///< Bytes of PNG data not read thanks to cancellations of running decodings
+    uint32_t px_avoided; ///< Pixels not decoded thanks to cancellations of running decodings
+    uint32_t px_wasted; ///< Pixels decoded by cancelled decodings
+} lv_pngle_queue_stats_t;
+
+/** \fn lv_pngle_request_t * lv_pngle_queue_add(const void * src, lv_pngle_prio_t prio, lv_pngle_ready_cb_t cb, void * user_data)
+ *  \brief Request an image to be decoded in advance.
+ *
+ *  Images are decoded by slices of LV_PNGLE_QUEUE_SLICE_MS milliseconds, highest
+ *  priority first. Requests for a source already queued share its decoding. Once
+ *  decoded, the image waits until LVGL opens it, which then costs no decoding.
+ *
+ *  \param src: pointer to image source (image descriptor or file path). Images wrapped
+ *  with lv_pngle_src_init must use the default output format.
+ *  \param prio: request priority.
+ *  \param cb: function called when image is decoded (optional).
+ *  \param user_data: data for cb.
+ *  \returns request handle, valid until cb is called or request is cancelled, or NULL if failed.
+ */
+lv_pngle_request_t * lv_pngle_queue_add(const void * src, lv_pngle_prio_t prio, lv_pngle_ready_cb_t cb, void * user_data);
+
+/** \fn void lv_pngle_queue_set_prio(lv_pngle_request_t * req, lv_pngle_prio_t prio)
+ *  \brief Change the priority of a request.
+ *  \param req: request handle.
+ *  \param prio: new priority.
+ */
+void lv_pngle_queue_set_prio(lv_pngle_request_t * req, lv_pngle_prio_t prio);
+
+/** \fn void lv_pngle_queue_cancel(lv_pngle_request_t * req)
+ *  \brief Cancel a request. The decoding stops and its buffers are freed once no request needs it.
+ *  \param req: request handle.
+ */
+void lv_pngle_queue_cancel(lv_pngle_request_t * req);
+
+/** \fn void lv_pngle_queue_cancel_all(void)
+ *  \brief Cancel all requests and drop decoded images waiting to be opened.
+ */
+void lv_pngle_queue_cancel_all(void);
+
+/** \fn void lv_pngle_queue_get_stats(lv_pngle_queue_stats_t * stats)
+ *  \brief Get decode queue counters.
+ *  \param stats: target for counters.
+ */
+void lv_pngle_queue_get_stats(lv_pngle_queue_stats_t * stats);
+#endif
+
+#if LV_PNGLE_USE_MIPMAP
+/** \brief A PNG image decoded together with versions of it downscaled by 2, 4, ... */
+typedef struct _lv_pngle_mipmap_t lv_pngle_mipmap_t;
+
+/** \fn lv_pngle_mipmap_t * lv_pngle_mipmap_create(const void * src, uint8_t levels)
+ *  \brief Decode a PNG image and generate its mip chain in the same pass.
+ *  \param src: pointer to image source (image descriptor or file path).
+ *  \param levels: number of downscaled levels to generate (capped to LV_PNGLE_MIPMAP_MAX_LEVELS).
+ *  \returns pointer to mip chain, or NULL if failed.
+ */
+lv_pngle_mipmap_t * lv_pngle_mipmap_create(const void * src, uint8_t levels);
+
+/** \fn void lv_pngle_mipmap_delete(lv_pngle_mipmap_t * mm)
+ *  \brief Free a mip chain. Images using it must have been deleted or changed source.
+ *  \param mm: pointer to mip chain.
+ */
+void lv_pngle_mipmap_delete(lv_pngle_mipmap_t * mm);
+
+/** \fn uint8_t lv_pngle_mipmap_get_level_count(const lv_pngle_mipmap_t * mm)
+ *  \brief Get number of levels in a mip chain, full size image included.
+ *  \param mm: pointer to mip chain.
+ *  \returns number of levels.
+ */
+uint8_t lv_pngle_mipmap_get_level_count(const lv_pngle_mipmap_t * mm);
+
+/** \fn uint8_t lv_pngle_mipmap_select_level(const lv_pngle_mipmap_t * mm, uint32_t zoom)
+ *  \brief Get the smallest level that is still at least as large as the image displayed with given zoom.
+ *  \param mm: pointer to mip chain.
+ *  \param zoom: zoom factor (256 for 100%).
+ *  \returns level index (0 for full size image).
+ */
+uint8_t lv_pngle_mipmap_select_level(const lv_pngle_mipmap_t * mm, uint32_t zoom);
+
+/** \fn const void * lv_pngle_mipmap_get_src(const lv_pngle_mipmap_t * mm, uint8_t level)
+ *  \brief Get an image source for a level, usable with image widgets.
+ *  \param mm: pointer to mip chain.
+ *  \param level: level index (0 for full size image).
+ *  \returns pointer to image source, or NULL if level doesn't exist.
+ */
+const void * lv_pngle_mipmap_get_src(const lv_pngle_mipmap_t * mm, uint8_t level);
+
+/** \fn void lv_pngle_mipmap_set_zoom(lv_obj_t * img, const lv_pngle_mipmap_t * mm, uint32_t zoom)
+ *  \brief Display an image with given zoom using the best fitting level of a mip chain.
+ *
+ *  The image source is set to the selected level and the zoom is compensated
+ *  for the level scale, so that the image is drawn with the same size. The widget
+ *  takes the size of the selected level: align it by its center to keep it in place.
+ *
+ *  \param img: pointer to image widget.
+ *  \param mm: pointer to mip chain.
+ *  \param zoom: zoom factor (256 for 100%).
+ */
+void lv_pngle_mipmap_set_zoom(lv_obj_t * img, const lv_pngle_mipmap_t * mm, uint32_t zoom);
+#endif
+
+#if LV_PNGLE_USE_NINEPATCH
+/** \brief A stretchable image stored as its fixed tiles plus one row or column per stretchable area. */
+typedef struct _lv_pngle_ninepatch_t lv_pngle_ninepatch_t;
+
+/** \brief Sizes of the fixed borders of a nine-patch image without border markers. */
+typedef struct _lv_pngle_ninepatch_insets_t {
+    uint16_t left; ///< Width of fixed left border
+    uint16_t top; ///< Height of fixed top border
+    uint16_t right; ///< Width of fixed right border
+    uint16_t bottom; ///< Height of fixed bottom border
+} lv_pngle_ninepatch_insets_t;
+
+/** \fn lv_pngle_ninepatch_t * lv_pngle_ninepatch_create(const void * src, const lv_pngle_ninepatch_insets_t * insets)
+ *  \brief Decode a nine-patch image.
+ *
+ *  Without insets, the image is expected to carry Android-style 1-pixel border
+ *  markers: black pixels on the top and left borders mark stretchable columns
+ *  and rows, black pixels on the bottom and right borders mark the content area.
+ *  With insets, the whole image is used and its center is stretchable.
+ *
+ *  Stretchable areas are expected to be uniform along the stretched direction:
+ *  only their first row or column is kept.
+ *
+ *  \param src: pointer to image source (image descriptor or file path).
+ *  \param insets: fixed border sizes, or NULL to read border markers.
+ *  \returns pointer to nine-patch image, or NULL if failed.
+ */
+lv_pngle_ninepatch_t * lv_pngle_ninepatch_create(const void * src, const lv_pngle_ninepatch_insets_t * insets);
+
+/** \fn void lv_pngle_ninepatch_delete(lv_pngle_ninepatch_t * np)
+ *  \brief Free a nine-patch image. Objects it is attached to must have been deleted.
+ *  \param np: pointer to nine-patch image.
+ */
+void lv_pngle_ninepatch_delete(lv_pngle_ninepatch_t * np);
+
+/** \fn void lv_pngle_ninepatch_get_padding(const lv_pngle_ninepatch_t * np, lv_area_t * pad)
+ *  \brief Get content padding given by bottom and right border markers (0 if none).
+ *  \param np: pointer to nine-patch image.
+ *  \param pad: target for left (x1), top (y1), right (x2) and bottom (y2) padding.
+ */
+void lv_pngle_ninepatch_get_padding(const lv_pngle_ninepatch_t * np, lv_area_t * pad);
+
+/** \fn void lv_pngle_ninepatch_draw(lv_pngle_draw_ctx_t * ctx, const lv_pngle_ninepatch_t * np, const lv_area_t * coords, lv_opa_t opa)
+ *  \brief Draw a nine-patch image stretched to an area.
+ *  \param ctx: drawing target (draw context with LVGL v8, layer with LVGL v9).
+ *  \param np: pointer to nine-patch image.
+ *  \param coords: area to fill.
+ *  \param opa: opacity.
+ */
+void lv_pngle_ninepatch_draw(lv_pngle_draw_ctx_t * ctx, const lv_pngle_ninepatch_t * np,
+                             const lv_area_t * coords, lv_opa_t opa);
+
+/** \fn void lv_pngle_ninepatch_attach(lv_obj_t * obj, const lv_pngle_ninepatch_t * np)
+ *  \brief Draw a nine-patch image as background of an object, stretched to its size.
+ *  \param obj: pointer to object.
+ *  \param np: pointer to nine-patch image.
+ */
+void lv_pngle_ninepatch_attach(lv_obj_t * obj, const lv_pngle_ninepatch_t * np);
+#endif
+
+#if LV_PNGLE_USE_WATCH
+/** \brief Function called when a watched PNG file changed, after its cached copies were dropped.
+ *  Use it to rebuild objects decoded from the file (mip chains, nine-patch images, ...).
+ */
+typedef void (*lv_pngle_watch_cb_t)(const char * fn);
+
+/** \fn bool lv_pngle_watch_start(lv_pngle_watch_cb_t cb)
+ *  \brief Start watching PNG files. Every PNG file decoded from then on is watched,
+ *  and cached copies of it (decoded image, header) are dropped when it's written,
+ *  replaced or deleted. Cache hits then don't need any filesystem call to stay valid.
+ *  \param cb: function called when a file changed, or NULL.
+ *  \returns true if successful, false if failed.
+ */
+bool lv_pngle_watch_start(lv_pngle_watch_cb_t cb);
+
+/** \fn void lv_pngle_watch_stop(void)
+ *  \brief Stop watching PNG files.
+ */
+void lv_pngle_watch_stop(void);
+#endif
+
+#if LV_PNGLE_USE_HUGE
+/** \brief A PNG image displayed by tiles, decoded on demand. */
+typedef struct _lv_pngle_huge_t lv_pngle_huge_t;
+
+/** \fn lv_pngle_huge_t * lv_pngle_huge_open(const void * src)
+ *  \brief Open a PNG image too large to be decoded in memory.
+ *
+ *  The image is inflated once (without pixel conversion) to record a decoding
+ *  state every LV_PNGLE_HUGE_BAND_ROWS rows. Drawing then decodes only the tiles
+ *  under the drawn area that aren't cached, resuming from the closest state.
+ *  Interlaced images aren't supported.
+ *
+ *  \param src: pointer to image source (image descriptor or file path, which stays open).
+ *  \returns pointer to image, or NULL if failed.
+ */
+lv_pngle_huge_t * lv_pngle_huge_open(const void * src);
+
+/** \fn void lv_pngle_huge_close(lv_pngle_huge_t * hg)
+ *  \brief Free a huge image. Objects it is attached to must have been deleted.
+ *  \param hg: pointer to image.
+ */
+void lv_pngle_huge_close(lv_pngle_huge_t * hg);
+
+/** \fn void lv_pngle_huge_get_size(const lv_pngle_huge_t * hg, uint32_t * w, uint32_t * h)
+ *  \brief Get the size of a huge image.
+ *  \param hg: pointer to image.
+ *  \param w: target for image width.
+ *  \param h: target for image height.
+ */
+void lv_pngle_huge_get_size(const lv_pngle_huge_t * hg, uint32_t * w, uint32_t * h);
+
+/** \fn void lv_pngle_huge_draw(lv_pngle_draw_ctx_t * ctx, lv_pngle_huge_t * hg, const lv_area_t * coords, int32_t x, int32_t y, lv_opa_t opa)
+ *  \brief Draw part of a huge image.
+ *  \param ctx: drawing target (draw context with LVGL v8, layer with LVGL v9).
+ *  \param hg: pointer to image.
+ *  \param coords: area to fill.
+ *  \param x: horizontal position in image of the left edge of area.
+ *  \param y: vertical position in image of the top edge of area.
+ *  \param opa: opacity.
+ */
+void lv_pngle_huge_draw(lv_pngle_draw_ctx_t * ctx, lv_pngle_huge_t * hg, const lv_area_t * coords,
+                        int32_t x, int32_t y, lv_opa_t opa);
+
+/** \fn void lv_pngle_huge_attach(lv_obj_t * obj, lv_pngle_huge_t * hg)
+ *  \brief Draw a huge image as background of an object, from the position set with lv_pngle_huge_set_view.
+ *  \param obj: pointer to object.
+ *  \param hg: pointer to image.
+ */
+void lv_pngle_huge_attach(lv_obj_t * obj, lv_pngle_huge_t * hg);
+
+/** \fn void lv_pngle_huge_set_view(lv_pngle_huge_t * hg, int32_t x, int32_t y)
+ *  \brief Set the position in image shown at the top left corner of the attached object.
+ *  \param hg: pointer to image.
+ *  \param x: horizontal position in image.
+ *  \param y: vertical position in image.
+ */
+void lv_pngle_huge_set_view(lv_pngle_huge_t * hg, int32_t x, int32_t y);
+#endif
+
+#if LV_PNGLE_USE_PALETTE
+/** \fn bool lv_pngle_palette_set(const uint8_t * rgb, uint16_t n, const uint8_t * lut)
+ *  \brief Set the global palette decoded pixels are mapped to. Color values written
+ *  to images are then palette indices. Cached images are dropped.
+ *
+ *  Without a precomputed lookup table, the nearest palette color of each table
+ *  entry is searched once here, so that pixels are mapped at table lookup speed.
+ *
+ *  \param rgb: palette colors, as RGB values, or NULL to go back to RGB332 colors.
+ *  \param n: number of palette colors (at most 256).
+ *  \param lut: precomputed lookup table from quantized RGB values (LV_PNGLE_PALETTE_LUT_BITS
+ *  bits per channel, red first) to palette indices, or NULL to compute it. Must outlive its use.
+ *  \returns true if successful, false if failed.
+ */
+bool lv_pngle_palette_set(const uint8_t * rgb, uint16_t n, const uint8_t * lut);
+#endif
+
+#if LV_PNGLE_USE_VARIANTS
+/** \fn const void * lv_pngle_variant_get(const void * src, lv_color_t color, lv_opa_t mix, lv_opa_t opa)
+ *  \brief Get an image source for a tinted variant of an image (e.g. theme or disabled state).
+ *
+ *  Variants are keyed by (source, tint, intensity, opacity): asking twice for the
+ *  same variant returns the same source, so LVGL decodes and caches it once.
+ *
+ *  \param src: pointer to image source (image descriptor or file path).
+ *  \param color: tint color.
+ *  \param mix: tint intensity (0: no tint, 255: pixels take the tint color).
+ *  \param opa: opacity.
+ *  \returns image source of variant, valid until lv_pngle_variant_clear is called, or NULL if failed.
+ */
+const void * lv_pngle_variant_get(const void * src, lv_color_t color, lv_opa_t mix, lv_opa_t opa);
+
+/** \fn void lv_pngle_variant_clear(void)
+ *  \brief Free all variants and drop their cached images. Objects using them must have been deleted.
+ */
+void lv_pngle_variant_clear(void);
+#endif
+
+#if LV_PNGLE_USE_MANIFEST
+/** \fn bool lv_pngle_manifest_build(const char * dir, const char * fn)
+ *  \brief Scan a directory for PNG files and write their header fields (size, color type,
+ *  chunk offsets) to a manifest file. The manifest is then in use.
+ *
+ *  Files are looked up by path: they must be referred to with the path used
+ *  here (e.g. "S:/assets/icon.png" for directory "S:/assets"). Paths are
+ *  limited to 255 characters.
+ *
+ *  \param dir: directory path, with LVGL drive letter.
+ *  \param fn: manifest file path, with LVGL drive letter.
+ *  \returns true if successful, false if failed.
+ */
+bool lv_pngle_manifest_build(const char * dir, const char * fn);
+
+/** \fn bool lv_pngle_manifest_load(const char * fn)
+ *  \brief Load a manifest file. Image size queries for files it lists don't read them, and
+ *  decoding jumps to image data. The size of each file is checked once, when its entry is
+ *  first used: files whose size changed, or that the watch module reports as changed, are
+ *  parsed instead.
+ *  \param fn: manifest file path, with LVGL drive letter.
+ *  \returns true if successful, false if failed.
+ */
+bool lv_pngle_manifest_load(const char * fn);
+
+/** \fn void lv_pngle_manifest_unload(void)
+ *  \brief Free the loaded manifest.
+ */
+void lv_pngle_manifest_unload(void);
+#endif
+
+#if LV_PNGLE_USE_SPLASH
+/** \brief Function pushing a band of pixels to the display. It may return before the transfer
+ *  is over, as long as a wait function is given.
+ *  Pixels are in the color format of decoded images, without alpha (RGB565 or XRGB8888 with LVGL v9,
+ *  lv_color_t with LVGL v8).
+ */
+typedef void (*lv_pngle_flush_cb_t)(const lv_area_t * area, const uint8_t * px, void * user_data);
+
+/** \brief Function waiting until the last band pushed to the display is transferred. */
+typedef void (*lv_pngle_wait_cb_t)(void * user_data);
+
+/** \fn bool lv_pngle_splash(const void * src, int32_t x, int32_t y, lv_color_t bg, lv_pngle_flush_cb_t flush_cb, lv_pngle_wait_cb_t wait_cb, void * user_data)
+ *  \brief Decode an image band by band and push each band to the display, without LVGL draw buffers.
+ *
+ *  Two bands of LV_PNGLE_SPLASH_BAND_ROWS rows are allocated: one is decoded
+ *  while the other one is transferred. The image must fit on the display.
+ *  Interlaced images aren't supported.
+ *
+ *  \param src: pointer to image source (image descriptor or file path).
+ *  \param x: horizontal screen position of the image.
+ *  \param y: vertical screen position of the image.
+ *  \param bg: background color, transparent pixels are blended over it.
+ *  \param flush_cb: function pushing a band to the display.
+ *  \param wait_cb: function waiting for the last transfer to be over, or NULL if flush_cb is synchronous.
+ *  \param user_data: user data passed to callbacks.
+ *  \returns true if successful, false if failed.
+ */
+bool lv_pngle_splash(const void * src, int32_t x, int32_t y, lv_color_t bg,
+                     lv_pngle_flush_cb_t flush_cb, lv_pngle_wait_cb_t wait_cb, void * user_data);
+
+#if !LV_PNGLE_USE_LVGL_V9
+/** \fn bool lv_pngle_splash_drv(const void * src, lv_disp_drv_t * drv, lv_color_t bg)
+ *  \brief Decode an image band by band, centered on screen, through the flush_cb of a display
+ *  driver (which needn't be registered yet). Bands are transferred while the next ones are decoded.
+ *  Images larger than the display resolution are refused.
+ *  \param src: pointer to image source (image descriptor or file path).
+ *  \param drv: pointer to display driver, with resolution and flush_cb set.
+ *  \param bg: background color, transparent pixels are blended over it.
+ *  \returns true if successful, false if failed.
+ */
+bool lv_pngle_splash_drv(const void * src, lv_disp_drv_t * drv, lv_color_t bg);
+#endif
+#endif
+
+#if LV_PNGLE_USE_POLICY
+/** \brief Decisions of the decoding policy. */
+typedef enum {
+    LV_PNGLE_POLICY_NONE = 0, ///< No decision made yet
+    LV_PNGLE_POLICY_FULL_SMALL, ///< Decoded to a full buffer, as the image is small
+    LV_PNGLE_POLICY_FULL_HOT, ///< Decoded to a full buffer, as the image is opened often
+    LV_PNGLE_POLICY_FULL_REDRAWN, ///< Decoded to a full buffer, as streaming decoded the image too many times
+    LV_PNGLE_POLICY_STREAM_COLD, ///< Decoded row by row, as the image is large and rarely opened
+    LV_PNGLE_POLICY_STREAM_MEMORY, ///< Decoded row by row, as no free block is large enough for a full buffer
+    LV_PNGLE_POLICY_REASON_COUNT, ///< Number of decisions
+} lv_pngle_policy_reason_t;
+
+/** \brief Decoding policy statistics. */
+typedef struct _lv_pngle_policy_stats_t {
+    uint32_t decisions[LV_PNGLE_POLICY_REASON_COUNT]; ///< Number of openings per decision
+    uint32_t full_ms; ///< Total time spent decoding to full buffers, in milliseconds
+    uint32_t stream_rows; ///< Number of rows decoded while streaming, redraws included (for closed images)
+    uint32_t bytes_saved; ///< Memory not allocated for full buffers of images currently streamed, in bytes
+    uint32_t prioritized; ///< Number of openings given a higher cache priority
+} lv_pngle_policy_stats_t;
+
+/** \brief What the decoding policy knows of an image. */
+typedef struct _lv_pngle_policy_info_t {
+    lv_pngle_policy_reason_t reason; ///< Last decision
+    uint32_t opens; ///< Number of times the image was opened
+    uint32_t decode_ms; ///< Last full decoding time, in milliseconds (0 if never decoded fully)
+    uint32_t stream_passes; ///< Number of decoding passes made while streamed (for closed images)
+    uint32_t size; ///< Size of a full buffer, in bytes
+    uint8_t priority; ///< Cache priority given by last decision
+} lv_pngle_policy_info_t;
+
+/** \fn void lv_pngle_policy_get_stats(lv_pngle_policy_stats_t * stats)
+ *  \brief Get decision counters and measured costs of the decoding policy.
+ *  \param stats: target for statistics.
+ */
+void lv_pngle_policy_get_stats(lv_pngle_policy_stats_t * stats);
+
+/** \fn bool lv_pngle_policy_get_info(const void * src, lv_pngle_policy_info_t * info)
+ *  \brief Get what the decoding policy knows of an image.
+ *  \param src: pointer to image source (as given to LVGL).
+ *  \param info: target for image information.
+ *  \returns true if successful, false if the image wasn't opened or was forgotten.
+ */
+bool lv_pngle_policy_get_info(const void * src, lv_pngle_policy_info_t * info);
+
+/** \fn void lv_pngle_policy_reset(void)
+ *  \brief Forget all images and clear statistics.
+ */
+void lv_pngle_policy_reset(void);
+#endif
+
+#if LV_PNGLE_USE_LAZY
+/** \brief Lazy opening statistics. */
+typedef struct _lv_pngle_lazy_stats_t {
+    uint32_t opened; ///< Number of images opened without decoding
+    uint32_t decoded; ///< Number of images decoded to a full buffer when first drawn
+    uint32_t streamed; ///< Number of images decoded row by row when first drawn
+    uint32_t avoided; ///< Number of images closed before being drawn, whose decoding was avoided
+} lv_pngle_lazy_stats_t;
+
+/** \fn void lv_pngle_lazy_get_stats(lv_pngle_lazy_stats_t * stats)
+ *  \brief Get lazy opening statistics.
+ *  \param stats: target for statistics.
+ */
+void lv_pngle_lazy_get_stats(lv_pngle_lazy_stats_t * stats);
+#endif
+
+#if LV_PNGLE_USE_OPAMAP
+/** \brief An image decoded with the opacity of its rows. */
+typedef struct _lv_pngle_opamap_t lv_pngle_opamap_t;
+
+/** \brief Opacity classes of image rows. */
+typedef enum {
+    LV_PNGLE_ROW_TRANSP = 0, ///< All pixels fully transparent
+    LV_PNGLE_ROW_COVER, ///< All pixels fully opaque
+    LV_PNGLE_ROW_MIXED, ///< Some pixels not fully opaque
+} lv_pngle_row_class_t;
+
+/** \brief Opacity of an image row. Empty spans have their end before their start. */
+typedef struct _lv_pngle_row_opa_t {
+    uint16_t x1; ///< First pixel that isn't fully transparent
+    uint16_t x2; ///< Last pixel that isn't fully transparent
+    uint16_t ox1; ///< First pixel of longest run of fully opaque pixels
+    uint16_t ox2; ///< Last pixel of longest run of fully opaque pixels (empty if shorter than LV_PNGLE_OPAMAP_MIN_RUN)
+    uint8_t cls; ///< Opacity class (lv_pngle_row_class_t)
+} lv_pngle_row_opa_t;
+
+/** \fn lv_pngle_opamap_t * lv_pngle_opamap_create(const void * src)
+ *  \brief Decode an image in native color with alpha, classifying its rows as they're converted.
+ *  \param src: pointer to image source (image descriptor or file path).
+ *  \returns pointer to image, or NULL if failed.
+ */
+lv_pngle_opamap_t * lv_pngle_opamap_create(const void * src);
+
+/** \fn void lv_pngle_opamap_delete(lv_pngle_opamap_t * m)
+ *  \brief Free an image. Objects it is attached to must have been deleted.
+ *  \param m: pointer to image.
+ */
+void lv_pngle_opamap_delete(lv_pngle_opamap_t * m);
+
+/** \fn void lv_pngle_opamap_get_size(const lv_pngle_opamap_t * m, uint32_t * w, uint32_t * h)
+ *  \brief Get the size of an image.
+ *  \param m: pointer to image.
+ *  \param w: target for image width.
+ *  \param h: target for image height.
+ */
+void lv_pngle_opamap_get_size(const lv_pngle_opamap_t * m, uint32_t * w, uint32_t * h);
+
+/** \fn const lv_pngle_row_opa_t * lv_pngle_opamap_get_rows(const lv_pngle_opamap_t * m)
+ *  \brief Get the opacity of the rows of an image.
+ *  \param m: pointer to image.
+ *  \returns pointer to opacity of first row, followed by the other ones.
+ */
+const lv_pngle_row_opa_t * lv_pngle_opamap_get_rows(const lv_pngle_opamap_t * m);
+
+/** \fn void lv_pngle_opamap_draw(lv_pngle_draw_ctx_t * ctx, lv_pngle_opamap_t * m, const lv_area_t * coords, lv_opa_t opa)
+ *  \brief Draw an image, skipping fully transparent spans and copying fully opaque ones without blending.
+ *  \param ctx: drawing target (draw context with LVGL v8, layer with LVGL v9).
+ *  \param m: pointer to image.
+ *  \param coords: area to draw to; the image is drawn from its top left corner, clipped to the area.
+ *  \param opa: opacity.
+ */
+void lv_pngle_opamap_draw(lv_pngle_draw_ctx_t * ctx, lv_pngle_opamap_t * m, const lv_area_t * coords, lv_opa_t opa);
+
+/** \fn void lv_pngle_opamap_attach(lv_obj_t * obj, lv_pngle_opamap_t * m)
+ *  \brief Draw an image as background of an object.
+ *  \param obj: pointer to object.
+ *  \param m: pointer to image.
+ */
+void lv_pngle_opamap_attach(lv_obj_t * obj, lv_pngle_opamap_t * m);
+#endif
+
+#if LV_PNGLE_USE_BUNDLE
+/** \fn bool lv_pngle_bundle_open(const char * path)
+ *  \brief Open a bundle of PNG images, replacing the open one. The bundle file stays
+ *  open, and its index is kept in memory; images in it are then given to LVGL with
+ *  drive letter LV_PNGLE_BUNDLE_LETTER.
+ *  \param path: bundle file path, with LVGL drive letter (native path if LV_PNGLE_BUNDLE_MMAP is set).
+ *  \returns true if successful, false if failed.
+ */
+bool lv_pngle_bundle_open(const char * path);
+
+/** \fn void lv_pngle_bundle_close(void)
+ *  \brief Close the open bundle. Images read from it must have been closed.
+ */
+void lv_pngle_bundle_close(void);
+
+/** \fn uint32_t lv_pngle_bundle_get_count(void)
+ *  \brief Get the number of images in the open bundle.
+ *  \returns number of images (0 if no bundle is open).
+ */
+uint32_t lv_pngle_bundle_get_count(void);
+#endif
+
+#if LV_PNGLE_USE_ARENA
+/** \brief Arena usage. */
+typedef struct _lv_pngle_arena_stats_t {
+    uint32_t size; ///< Arena size, in bytes
+    uint32_t used; ///< Bytes in use
+    uint32_t peak; ///< Highest number of bytes in use
+    uint32_t failed; ///< Number of allocations or decodings refused for lack of memory
+} lv_pngle_arena_stats_t;
+
+/** \fn bool lv_pngle_init_arena(void * buf, uint32_t size)
+ *  \brief Initializes the decoder like lv_pngle_init, with all decoding memory taken
+ *  from a static arena. Decodings that the arena can't hold fail before they start.
+ *  \param buf: arena, left to lv_pngle for good.
+ *  \param size: arena size, in bytes (see lv_pngle_arena_need).
+ *  \returns true if successful, false if arena is too small.
+ */
+bool lv_pngle_init_arena(void * buf, uint32_t size);
+
+/** \fn uint32_t lv_pngle_arena_need(uint32_t w, uint32_t h, bool stream)
+ *  \brief Get the worst-case arena memory taken to open an image in default format:
+ *  decoder state, scanlines and palette, plus decoded image with LVGL v8, or rows kept
+ *  when decoded row by row. Once open, a fully decoded image keeps its decoded image
+ *  only, whereas an image decoded row by row keeps it all.
+ *  \param w: image width.
+ *  \param h: image height.
+ *  \param stream: if true, image is decoded row by row.
+ *  \returns number of bytes.
+ */
+uint32_t lv_pngle_arena_need(uint32_t w, uint32_t h, bool stream);
+
+/** \fn void lv_pngle_arena_get_stats(lv_pngle_arena_stats_t * stats)
+ *  \brief Get arena usage.
+ *  \param stats: target for usage.
+ */
+void lv_pngle_arena_get_stats(lv_pngle_arena_stats_t * stats);
+#endif
+
+#if LV_PNGLE_USE_CAROUSEL
+/** \brief A carousel of images. */
+typedef struct _lv_pngle_carousel_t lv_pngle_carousel_t;
+
+/** \fn lv_pngle_carousel_t * lv_pngle_carousel_create(const void * const * srcs, uint32_t n, bool loop)
+ *  \brief Create a carousel of images. LV_PNGLE_CAROUSEL_BUFFERS buffers sized for the
+ *  largest image are allocated once; pages are decoded into them in default format.
+ *  \param srcs: image sources of pages (image descriptors or file paths), kept by the
+ *  carousel and which must outlive it.
+ *  \param n: number of pages.
+ *  \param loop: if true, first page follows last one.
+ *  \returns pointer to carousel, or NULL if failed.
+ */
+lv_pngle_carousel_t * lv_pngle_carousel_create(const void * const * srcs, uint32_t n, bool loop);
+
+/** \fn void lv_pngle_carousel_delete(lv_pngle_carousel_t * c)
+ *  \brief Delete a carousel. Its pages must not be displayed anymore.
+ *  \param c: pointer to carousel.
+ */
+void lv_pngle_carousel_delete(lv_pngle_carousel_t * c);
+
+/** \fn const void * lv_pngle_carousel_show(lv_pngle_carousel_t * c, uint32_t page)
+ *  \brief Get a page to show, decoding it now unless it was decoded ahead, then
+ *  start decoding its neighbours ahead from an LVGL timer: the next page in
+ *  direction of the last change and, with 3 buffers, the previous one. With
+ *  2 buffers, the page left is reused for the next one, so that it must not be
+ *  displayed anymore once the returned page is.
+ *  \param c: pointer to carousel.
+ *  \param page: page index.
+ *  \returns image descriptor to give to an image object, valid until the page is
+ *  replaced, or NULL if decoding failed.
+ */
+const void * lv_pngle_carousel_show(lv_pngle_carousel_t * c, uint32_t page);
+#endif
+
+#if LV_PNGLE_USE_ROW_HASH
+/** \fn bool lv_pngle_reload(const void * src)
+ *  \brief Reload an image whose source changed: drop cached copies, decode it again
+ *  into LVGL's image cache, then invalidate the rows whose output changed on image
+ *  objects of the active screen showing it. Objects whose image is scaled, rotated
+ *  or doesn't fill them are invalidated whole, as are all of them when the image
+ *  had no row hashes.
+ *
+ *  Images decoded row by row (or not decoded when opened) are hashed by an extra
+ *  decoding pass through a single row buffer. Interlaced images can't be hashed
+ *  this way, and are invalidated whole.
+ *
+ *  \param src: pointer to image source (image descriptor or file path).
+ *  \returns true if image could be decoded, false otherwise.
+ */
+bool lv_pngle_reload(const void * src);
+#endif
+
 #ifdef __cplusplus
 } /* extern "C" */
 #endif
@@ -0,0 +1,170 @@
+/** \file lv_pngle_arena.c
+ *  \brief Allocation of decoding memory from a static arena given at initialization,
+ *  so that no heap is used once lv_pngle is initialized.
+ *
+ *  The arena is a sequence of blocks, each starting with a header holding its size
+ *  and whether it's in use. Allocation takes the first free block large enough,
+ *  merging consecutive free blocks on the way, and splits it; release marks the
+ *  block free and merges it with the next one if free.
+ *
+ *  Pngle allocates its state with calloc and free: pngle.c is built with these
+ *  names mapped to _lv_pngle_calloc and _lv_pngle_free (see CMakeLists.txt),
+ *  which use the arena if enabled and the C library otherwise.
+ *
+ *  Author: Vincent Paeder
+ *  License: MIT
+ */
+#include "lv_pngle_private.h"
+#include <stdlib.h>
+
+#if LV_PNGLE_USE_ARENA
+
+#define ARENA_ALIGN 8 ///< Alignment of blocks
+#define ARENA_HDR_SIZE 8 ///< Size of block header (a multiple of ARENA_ALIGN)
+
+/** \brief Header of an arena block. */
+typedef struct _arena_block_t {
+    /** \brief Block size, header included. */
+    uint32_t size;
+
+    /** \brief If 1, block is in use. */
+    uint32_t used;
+} arena_block_t;
+
+/** \brief Arena given to lv_pngle_init_arena. */
+static struct {
+    /** \brief First block, or NULL if no arena is set. */
+    uint8_t * base;
+
+    /** \brief Arena size, in bytes. */
+    uint32_t size;
+
+    /** \brief Bytes held by blocks in use, headers included. */
+    uint32_t used;
+
+    /** \brief Highest value of used. */
+    uint32_t peak;
+
+    /** \brief Number of failed allocations. */
+    uint32_t failed;
+} arena = { 0 };
+
+
+/** \brief Get the block following another one.
+ *  \param b: pointer to block.
+ *  \returns pointer to next block, or NULL if b is the last one.
+ */
+static arena_block_t * arena_next(arena_block_t * b) {
+    uint8_t * next = (uint8_t*)b + b->size;
+    return next < arena.base + arena.size ? (arena_block_t*)next : NULL;
+}
+
+/** \brief Merge a free block with the free blocks following it.
+ *  \param b: pointer to free block.
+ */
+static void arena_merge(arena_block_t * b) {
+    arena_block_t * next;
+    while ((next = arena_next(b)) != NULL && !next->used) b->size += next->size;
+}
+
+
+bool lv_pngle_init_arena(void * buf, uint32_t size) {
+    uint32_t ofs = (ARENA_ALIGN - (uintptr_t)buf % ARENA_ALIGN) % ARENA_ALIGN;
+    if (buf == NULL || size < ofs + 2*ARENA_HDR_SIZE) {
+        LV_LOG_ERROR("arena is too small.\n");
+        return false;
+    }
+    memset(&arena, 0, sizeof(arena));
+    arena.base = (uint8_t*)buf + ofs;
+    arena.size = (size - ofs) & ~(uint32_t)(ARENA_ALIGN - 1);
+    arena_block_t * b = (arena_block_t*)arena.base;
+    b->size = arena.size;
+    b->used = 0;
+    LV_LOG_INFO("decoding memory taken from arena of %d bytes.\n", arena.size);
+    lv_pngle_init();
+    return true;
+}
+
+
+void lv_pngle_arena_get_stats(lv_pngle_arena_stats_t * stats) {
+    stats->size = arena.size;
+    stats->used = arena.used;
+    stats->peak = arena.peak;
+    stats->failed = arena.failed;
+}
+
+
+void * _lv_pngle_arena_alloc(size_t size) {
+    if (arena.base != NULL && size > 0 && size <= arena.size) {
+        uint32_t need = ((uint32_t)size + ARENA_HDR_SIZE + ARENA_ALIGN - 1) & ~(uint32_t)(ARENA_ALIGN - 1);
+        for (arena_block_t * b = (arena_block_t*)arena.base; b != NULL; b = arena_next(b)) {
+            if (b->used) continue;
+            arena_merge(b);
+            if (b->size < need) continue;
+            if (b->size - need >= ARENA_HDR_SIZE + ARENA_ALIGN) {
+                // split: rest of block stays free
+                arena_block_t * rest = (arena_block_t*)((uint8_t*)b + need);
+                rest->size = b->size - need;
+                rest->used = 0;
+                b->size = need;
+            }
+            b->used = 1;
+            arena.used += b->size;
+            if (arena.used > arena.peak) arena.peak = arena.used;
+            return (uint8_t*)b + ARENA_HDR_SIZE;
+        }
+    }
+    arena.failed++;
+    LV_LOG_WARN("arena can't hold %d bytes (%d of %d bytes in use).\n", (uint32_t)size, arena.used, arena.size);
+    return NULL;
+}
+
+
+void _lv_pngle_arena_free(void * p) {
+    if (p == NULL) return;
+    arena_block_t * b = (arena_block_t*)((uint8_t*)p - ARENA_HDR_SIZE);
+    b->used = 0;
+    arena.used -= b->size;
+    arena_merge(b);
+}
+
+
+bool _lv_pngle_arena_fits(uint32_t need, uint32_t largest) {
+    uint32_t largest_free = 0;
+    if (arena.base != NULL) {
+        for (arena_block_t * b = (arena_block_t*)arena.base; b != NULL; b = arena_next(b)) {
+            if (b->used) continue;
+            arena_merge(b);
+            if (b->size > largest_free) largest_free = b->size;
+        }
+    }
+    if (arena.size - arena.used < need || largest_free < largest + PNGLE_ARENA_OVERHEAD) {
+        LV_LOG_WARN("arena can't hold image: %d bytes needed, %d of %d bytes in use.\n", need, arena.used, arena.size);
+        arena.failed++;
+        return false;
+    }
+    return true;
+}
+
+#endif
+
+
+void * _lv_pngle_calloc(size_t n, size_t size) {
+#if LV_PNGLE_USE_ARENA
+    if (size != 0 && n > UINT32_MAX/size) return NULL;
+    void * p = _lv_pngle_arena_alloc(n*size);
+    if (p != NULL) memset(p, 0, n*size);
+    return p;
+#else
+    return calloc(n, size);
+#endif
+}
+
+
+void _lv_pngle_free(void * p) {
+#if LV_PNGLE_USE_ARENA
+    _lv_pngle_arena_free(p);
+#else
+    free(p);
+#endif
+}
@@ -0,0 +1,292 @@
+/** \file lv_pngle_bundle.c
+ *  \brief Read-only bundle of PNG images in a single file, opened once, with an index
+ *  of image names, so that bundled images are found without filesystem lookups.
+ *
+ *  Bundle file layout (little-endian): magic "LVPB" | version (2 bytes) |
+ *  reserved (2 bytes) | number of entries (4 bytes) | size of names (4 bytes) |
+ *  entries sorted by name | names | PNG images, stored contiguously.
+ *
+ *  Entry layout: name offset in names (4 bytes) | name length (2 bytes) |
+ *  reserved (2 bytes) | image offset in file (4 bytes) | image size (4 bytes) |
+ *  width (4 bytes) | height (4 bytes).
+ *
+ *  Bundles are written by tools/lv_pngle_bundle.py.
+ *
+ *  Author: Vincent Paeder
+ *  License: MIT
+ */
+#include "lv_pngle_private.h"
+
+#if LV_PNGLE_USE_BUNDLE
+
+#if LV_PNGLE_BUNDLE_MMAP
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#endif
+
+#define BUNDLE_VERSION 1 ///< Version of bundle file layout
+#define BUNDLE_HDR_SIZE 16 ///< Size of bundle file header
+#define BUNDLE_ENTRY_SIZE 24 ///< Size of an entry in bundle file
+
+/** \brief A bundled image. */
+typedef struct _bundle_entry_t {
+    /** \brief Image name (not null-terminated). */
+    const char * name;
+
+    /** \brief Length of image name. */
+    uint16_t name_len;
+
+    /** \brief Offset of image in bundle file. */
+    uint32_t offset;
+
+    /** \brief Image size, in bytes. */
+    uint32_t size;
+
+    /** \brief Image width. */
+    uint32_t w;
+
+    /** \brief Image height. */
+    uint32_t h;
+} bundle_entry_t;
+
+/** \brief Open bundle. */
+static struct {
+    /** \brief If true, a bundle file is open. */
+    bool is_open;
+
+    /** \brief Entries, sorted by name. */
+    bundle_entry_t * entries;
+
+    /** \brief Number of entries. */
+    uint32_t n;
+
+    /** \brief Names of all entries. */
+    char * names;
+
+#if LV_PNGLE_BUNDLE_MMAP
+    /** \brief Mapped bundle file. */
+    const uint8_t * map;
+
+    /** \brief Size of mapped bundle file. */
+    size_t map_size;
+#else
+    /** \brief Bundle file, open as long as the bundle is. */
+    lv_fs_file_t f;
+
+    /** \brief Position of bundle file. */
+    uint32_t f_pos;
+#endif
+} bundle = { 0 };
+
+
+/** \brief Read a little-endian 32-bit integer.
+ *  \param buf: pointer to data.
+ *  \returns integer value.
+ */
+static uint32_t bundle_le32(const uint8_t * buf) {
+    return ((uint32_t)buf[3] << 24) | ((uint32_t)buf[2] << 16) | ((uint32_t)buf[1] << 8) | buf[0];
+}
+
+/** \brief Find the entry of an image.
+ *  \param name: image name, without drive letter.
+ *  \returns pointer to entry, or NULL if image isn't in bundle.
+ */
+static const bundle_entry_t * bundle_find(const char * name) {
+    size_t len = strlen(name);
+    uint32_t lo = 0, hi = bundle.n;
+    while (lo < hi) {
+        uint32_t mid = (lo + hi)/2;
+        const bundle_entry_t * e = &bundle.entries[mid];
+        // byte order, shorter names first on common prefix
+        int cmp = memcmp(e->name, name, e->name_len < len ? e->name_len : len);
+        if (cmp == 0) cmp = e->name_len < len ? -1 : e->name_len > len;
+        if (cmp == 0) return e;
+        if (cmp < 0) lo = mid + 1;
+        else hi = mid;
+    }
+    return NULL;
+}
+
+#if LV_PNGLE_BUNDLE_MMAP
+/** \brief Map a bundle file.
+ *  \param path: native file path.
+ *  \returns LV_RES_OK if successful, LV_RES_INV if failed.
+ */
+static lv_res_t bundle_map(const char * path) {
+    int fd = open(path, O_RDONLY);
+    if (fd < 0) return LV_RES_INV;
+    struct stat st;
+    void * map = MAP_FAILED;
+    if (fstat(fd, &st) == 0 && st.st_size > 0) map = mmap(NULL, st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+    // the mapping stays valid once the file is closed
+    close(fd);
+    if (map == MAP_FAILED) return LV_RES_INV;
+    bundle.map = (const uint8_t*)map;
+    bundle.map_size = st.st_size;
+    return LV_RES_OK;
+}
+
+/** \brief Read bytes of an open bundle file.
+ *  \param pos: position of first byte.
+ *  \param buf: target buffer.
+ *  \param len: number of bytes to read.
+ *  \returns LV_RES_OK if successful, LV_RES_INV if file is too short.
+ */
+static lv_res_t bundle_load(uint32_t pos, void * buf, uint32_t len) {
+    if (pos > bundle.map_size || len > bundle.map_size - pos) return LV_RES_INV;
+    memcpy(buf, bundle.map + pos, len);
+    return LV_RES_OK;
+}
+
+/** \brief Get the size of the open bundle file.
+ *  \returns file size, in bytes.
+ */
+static uint32_t bundle_file_size(void) {
+    return bundle.map_size > UINT32_MAX ? UINT32_MAX : (uint32_t)bundle.map_size;
+}
+#else
+/** \brief Read bytes of an open bundle file.
+ *  \param pos: position of first byte.
+ *  \param buf: target buffer.
+ *  \param len: number of bytes to read.
+ *  \returns LV_RES_OK if successful, LV_RES_INV if file is too short.
+ */
+static lv_res_t bundle_load(uint32_t pos, void * buf, uint32_t len) {
+    uint32_t rb = 0;
+    if (bundle.f_pos != pos) {
+        if (lv_fs_seek(&bundle.f, pos, LV_FS_SEEK_SET) != LV_FS_RES_OK) return LV_RES_INV;
+        bundle.f_pos = pos;
+    }
+    if (lv_fs_read(&bundle.f, buf, len, &rb) != LV_FS_RES_OK) return LV_RES_INV;
+    bundle.f_pos += rb;
+    return rb == len ? LV_RES_OK : LV_RES_INV;
+}
+
+/** \brief Get the size of the open bundle file.
+ *  \returns file size, in bytes (0 if unknown).
+ */
+static uint32_t bundle_file_size(void) {
+    uint32_t size = 0;
+    if (lv_fs_seek(&bundle.f, 0, LV_FS_SEEK_END) != LV_FS_RES_OK || lv_fs_tell(&bundle.f, &size) != LV_FS_RES_OK) size = 0;
+    bundle.f_pos = size;
+    return size;
+}
+
+/** \brief Read function of bundled images.
+ *  \param user_data: pointer to entry.
+ *  \param pos: position of first byte in image.
+ *  \param buf: target buffer.
+ *  \param len: number of bytes to read.
+ *  \returns number of bytes read, less than len at end of image.
+ */
+static uint32_t bundle_read_cb(void * user_data, uint32_t pos, uint8_t * buf, uint32_t len) {
+    const bundle_entry_t * e = (const bundle_entry_t*)user_data;
+    if (pos >= e->size) return 0;
+    if (len > e->size - pos) len = e->size - pos;
+    return bundle_load(e->offset + pos, buf, len) == LV_RES_OK ? len : 0;
+}
+#endif
+
+
+bool lv_pngle_bundle_open(const char * path) {
+    lv_pngle_bundle_close();
+#if LV_PNGLE_BUNDLE_MMAP
+    if (bundle_map(path) != LV_RES_OK) {
+#else
+    bundle.f_pos = 0;
+    if (lv_fs_open(&bundle.f, path, LV_FS_MODE_RD) != LV_FS_RES_OK) {
+#endif
+        LV_LOG_WARN("couldn't open bundle file: %s\n", path);
+        return false;
+    }
+    bundle.is_open = true;
+
+    uint8_t buf[BUNDLE_ENTRY_SIZE];
+    if (bundle_load(0, buf, BUNDLE_HDR_SIZE) != LV_RES_OK || memcmp(buf, "LVPB", 4) || (buf[4] | (buf[5] << 8)) != BUNDLE_VERSION) {
+        LV_LOG_WARN("invalid bundle file: %s\n", path);
+        lv_pngle_bundle_close();
+        return false;
+    }
+    uint32_t n = bundle_le32(buf + 8);
+    uint32_t names_size = bundle_le32(buf + 12);
+    // counts are checked against the file size before anything is allocated from them
+    uint32_t file_size = bundle_file_size();
+    uint32_t index_size = file_size > BUNDLE_HDR_SIZE ? file_size - BUNDLE_HDR_SIZE : 0;
+    if (n > index_size/BUNDLE_ENTRY_SIZE || names_size > index_size - n*BUNDLE_ENTRY_SIZE) {
+        LV_LOG_WARN("invalid bundle index: %s\n", path);
+        lv_pngle_bundle_close();
+        return false;
+    }
+    bundle.entries = n ? (bundle_entry_t*)PNGLE_MALLOC(n*sizeof(bundle_entry_t)) : NULL;
+    bundle.names = names_size ? (char*)PNGLE_MALLOC(names_size) : NULL;
+    if ((n && bundle.entries == NULL) || (names_size && bundle.names == NULL) ||
+        bundle_load(BUNDLE_HDR_SIZE + n*BUNDLE_ENTRY_SIZE, bundle.names, names_size) != LV_RES_OK) {
+        LV_LOG_WARN("couldn't load bundle index: %s\n", path);
+        lv_pngle_bundle_close();
+        return false;
+    }
+
+    for (uint32_t i = 0; i < n; i++) {
+        if (bundle_load(BUNDLE_HDR_SIZE + i*BUNDLE_ENTRY_SIZE, buf, BUNDLE_ENTRY_SIZE) != LV_RES_OK) break;
+        bundle_entry_t * e = &bundle.entries[bundle.n];
+        uint32_t name_ofs = bundle_le32(buf);
+        e->name_len = buf[4] | (buf[5] << 8);
+        e->offset = bundle_le32(buf + 8);
+        e->size = bundle_le32(buf + 12);
+        e->w = bundle_le32(buf + 16);
+        e->h = bundle_le32(buf + 20);
+        if (name_ofs > names_size || e->name_len > names_size - name_ofs) {
+            LV_LOG_WARN("invalid bundle entry %d, skipped.\n", i);
+            continue;
+        }
+        e->name = bundle.names + name_ofs;
+        bundle.n++;
+    }
+    LV_LOG_INFO("opened bundle of %d PNG images.\n", bundle.n);
+    return true;
+}
+
+
+void lv_pngle_bundle_close(void) {
+    if (bundle.is_open) {
+#if LV_PNGLE_BUNDLE_MMAP
+        munmap((void*)bundle.map, bundle.map_size);
+        bundle.map = NULL;
+#else
+        lv_fs_close(&bundle.f);
+#endif
+    }
+    bundle.is_open = false;
+    if (bundle.entries != NULL) PNGLE_FREE(bundle.entries);
+    if (bundle.names != NULL) PNGLE_FREE(bundle.names);
+    bundle.entries = NULL;
+    bundle.names = NULL;
+    bundle.n = 0;
+}
+
+
+uint32_t lv_pngle_bundle_get_count(void) {
+    return bundle.n;
+}
+
+
+lv_res_t _lv_pngle_bundle_get_src(const char * fn, lv_pngle_input_t * in) {
+    if (bundle.n == 0 || fn[0] != LV_PNGLE_BUNDLE_LETTER || fn[1] != ':') return LV_RES_INV;
+    const bundle_entry_t * e = bundle_find(fn + 2);
+    if (e == NULL) return LV_RES_INV;
+    in->size = e->size;
+    in->w = e->w;
+    in->h = e->h;
+#if LV_PNGLE_BUNDLE_MMAP
+    if (e->offset > bundle.map_size || e->size > bundle.map_size - e->offset) return LV_RES_INV;
+    in->data = bundle.map + e->offset;
+#else
+    in->read_cb = bundle_read_cb;
+    in->user_data = (void*)e;
+#endif
+    return LV_RES_OK;
+}
+
+#endif
@@ -0,0 +1,381 @@
+/** \file lv_pngle_carousel.c
+ *  \brief Carousel of images sharing a few fixed buffers sized for the largest one:
+ *  pages next to the current one are decoded ahead into idle buffers, so that page
+ *  changes swap buffers instead of allocating and freeing images.
+ *
+ *  Author: Vincent Paeder
+ *  License: MIT
+ */
+#include "lv_pngle_private.h"
+
+#if LV_PNGLE_USE_CAROUSEL
+
+#if LV_PNGLE_CAROUSEL_BUFFERS < 2
+#error "LV_PNGLE_CAROUSEL_BUFFERS must be at least 2"
+#endif
+
+/** \brief A fixed buffer of a carousel. */
+typedef struct _carousel_slot_t {
+    /** \brief Image descriptor given to LVGL, pointing to data. */
+#if LV_PNGLE_USE_LVGL_V9
+    lv_image_dsc_t dsc;
+#else
+    lv_img_dsc_t dsc;
+#endif
+
+    /** \brief Fixed buffer, sized for the largest image. */
+    uint8_t * data;
+
+    /** \brief Page held, or -1 if none. */
+    int32_t page;
+
+    /** \brief If true, page is fully decoded. */
+    bool ready;
+} carousel_slot_t;
+
+/** \brief A carousel of images. */
+struct _lv_pngle_carousel_t {
+    /** \brief Image sources of pages. */
+    const void * const * srcs;
+
+    /** \brief Number of pages. */
+    uint32_t n;
+
+    /** \brief If true, first page follows last one. */
+    bool loop;
+
+    /** \brief Number of pixels of the largest image. */
+    uint32_t max_px;
+
+    /** \brief Fixed buffers. */
+    carousel_slot_t slots[LV_PNGLE_CAROUSEL_BUFFERS];
+
+    /** \brief Memory of all buffers. */
+    uint8_t * data;
+
+    /** \brief Buffer of the page shown, or NULL if none. */
+    carousel_slot_t * cur;
+
+    /** \brief Direction of last page change (1 forward, -1 backward). */
+    int32_t dir;
+
+    /** \brief Buffer being decoded ahead, or NULL if none. */
+    carousel_slot_t * job;
+
+    /** \brief Pngle instance (while decoding ahead). */
+    pngle_t * pngle;
+
+#if LV_PNGLE_USE_QOI
+    /** \brief QOI decoding state (while decoding QOI images ahead, pngle is then NULL). */
+    lv_pngle_qoi_t * qoi;
+#endif
+
+    /** \brief Reader over image data (while decoding ahead). */
+    lv_pngle_reader_t r;
+
+    /** \brief Data shared with decoder. */
+    lv_pngle_data_t ud;
+
+    /** \brief Timer decoding pages ahead, or NULL if there's nothing to decode. */
+    lv_timer_t * timer;
+};
+
+
+/** \brief Get the page at some distance from another one.
+ *  \param c: pointer to carousel.
+ *  \param page: page index.
+ *  \param step: distance (negative backward).
+ *  \returns page index, or -1 if there's no such page.
+ */
+static int32_t carousel_neighbour(const lv_pngle_carousel_t * c, int32_t page, int32_t step) {
+    int32_t p = page + step;
+    if (c->loop) p = (p % (int32_t)c->n + (int32_t)c->n) % (int32_t)c->n;
+    return p >= 0 && p < (int32_t)c->n ? p : -1;
+}
+
+/** \brief Check whether a page should be decoded ahead.
+ *  \param c: pointer to carousel.
+ *  \param page: page index.
+ *  \returns true if page is the next one in direction of last change or, with more than two
+ *  buffers, the previous one.
+ */
+static bool carousel_wanted(const lv_pngle_carousel_t * c, int32_t page) {
+    if (c->cur == NULL || page < 0) return false;
+    if (page == carousel_neighbour(c, c->cur->page, c->dir)) return true;
+    return LV_PNGLE_CAROUSEL_BUFFERS > 2 && page == carousel_neighbour(c, c->cur->page, -c->dir);
+}
+
+/** \brief Find the buffer holding a page.
+ *  \param c: pointer to carousel.
+ *  \param page: page index.
+ *  \returns pointer to buffer, or NULL if page isn't held.
+ */
+static carousel_slot_t * carousel_find(lv_pngle_carousel_t * c, int32_t page) {
+    for (uint8_t i = 0; i < LV_PNGLE_CAROUSEL_BUFFERS; i++) {
+        if (c->slots[i].page == page) return &c->slots[i];
+    }
+    return NULL;
+}
+
+/** \brief Stop decoding ahead, leaving the buffer being decoded not ready.
+ *  \param c: pointer to carousel.
+ */
+static void carousel_stop(lv_pngle_carousel_t * c) {
+    _lv_pngle_reader_close(&c->r);
+    if (c->pngle != NULL) pngle_destroy(c->pngle);
+    c->pngle = NULL;
+#if LV_PNGLE_USE_QOI
+    if (c->qoi != NULL) PNGLE_FREE(c->qoi);
+    c->qoi = NULL;
+#endif
+    c->job = NULL;
+}
+
+/** \brief Empty a buffer, and drop copies LVGL may have cached.
+ *  \param c: pointer to carousel.
+ *  \param slot: pointer to buffer.
+ */
+static void carousel_drop(lv_pngle_carousel_t * c, carousel_slot_t * slot) {
+    if (c->job == slot) carousel_stop(c);
+    if (slot->page < 0) return;
+#if LV_PNGLE_USE_LVGL_V9
+    lv_image_cache_drop(&slot->dsc);
+#else
+    lv_img_cache_invalidate_src(&slot->dsc);
+#endif
+    slot->page = -1;
+    slot->ready = false;
+}
+
+/** \brief Take a buffer to decode a page in, other than the one shown.
+ *  \param c: pointer to carousel.
+ *  \returns pointer to buffer: an empty one, else one holding no page wanted ahead.
+ */
+static carousel_slot_t * carousel_take(lv_pngle_carousel_t * c) {
+    carousel_slot_t * slot = NULL;
+    for (uint8_t i = 0; i < LV_PNGLE_CAROUSEL_BUFFERS; i++) {
+        carousel_slot_t * s = &c->slots[i];
+        if (s == c->cur) continue;
+        if (s->page < 0) return s;
+        if (slot == NULL || !carousel_wanted(c, s->page)) slot = s;
+    }
+    return slot;
+}
+
+/** \brief Start decoding a page into a buffer.
+ *  \param c: pointer to carousel.
+ *  \param slot: pointer to buffer (emptied first).
+ *  \param page: page index.
+ *  \returns LV_RES_OK if successful, LV_RES_INV if failed (the buffer is then still being decoded,
+ *  to be completed as failed).
+ */
+static lv_res_t carousel_begin(lv_pngle_carousel_t * c, carousel_slot_t * slot, int32_t page) {
+    carousel_drop(c, slot);
+    if (c->job != NULL) carousel_stop(c);
+    // page is held even if decoding fails, so that it isn't retried ahead
+    slot->page = page;
+    c->job = slot;
+
+    const void * src = c->srcs[page];
+    lv_pngle_input_t in;
+    uint32_t w, h;
+    if (_lv_pngle_get_src(src, &in) != LV_RES_OK || _lv_pngle_read_header(&in, &w, &h) != LV_RES_OK) return LV_RES_INV;
+    if (w*h > c->max_px) {
+        LV_LOG_WARN("carousel page %d is larger than buffers.\n", page);
+        return LV_RES_INV;
+    }
+    slot->dsc.header.w = w;
+    slot->dsc.header.h = h;
+#if LV_PNGLE_USE_LVGL_V9
+    slot->dsc.header.stride = w*PNGLE_COLOR_SIZE;
+#endif
+    slot->dsc.data_size = w*h*PNGLE_PX_SIZE;
+    memset(slot->data, 0, w*h*PNGLE_PX_SIZE);
+
+    _lv_pngle_data_init(&c->ud, w, h);
+    _lv_pngle_get_tint(src, &c->ud);
+    c->ud.data = slot->data;
+    c->ud.stride = w*PNGLE_COLOR_SIZE;
+#if PNGLE_PLANAR_ALPHA
+    // alpha plane follows color plane
+    c->ud.alpha = slot->data + w*h*PNGLE_COLOR_SIZE;
+    c->ud.alpha_stride = w;
+#endif
+
+    if (_lv_pngle_reader_open(&c->r, &in) != LV_RES_OK) return LV_RES_INV;
+#if LV_PNGLE_USE_QOI
+    if (_lv_pngle_qoi_detect(&c->r)) {
+        c->qoi = (lv_pngle_qoi_t*)PNGLE_MALLOC(sizeof(lv_pngle_qoi_t));
+        if (c->qoi == NULL) return LV_RES_INV;
+        return _lv_pngle_qoi_start(c->qoi, &c->r, &c->ud);
+    }
+#endif
+    c->pngle = pngle_new();
+    if (c->pngle == NULL) return LV_RES_INV;
+    _lv_pngle_setup(c->pngle, &c->ud);
+    return LV_RES_OK;
+}
+
+/** \brief Decode next slice of the page being decoded.
+ *  \param c: pointer to carousel.
+ *  \returns LV_RES_OK if successful, LV_RES_INV if decoding failed or if data ended.
+ */
+static lv_res_t carousel_feed(lv_pngle_carousel_t * c) {
+#if LV_PNGLE_USE_QOI
+    if (c->qoi != NULL) return _lv_pngle_qoi_feed(c->qoi, &c->r, &c->ud, _lv_pngle_put_pixel, PNGLE_BUF_SIZE);
+#endif
+    return _lv_pngle_reader_feed(&c->r, c->pngle, PNGLE_BUF_SIZE);
+}
+
+/** \brief Finish decoding ahead.
+ *  \param c: pointer to carousel.
+ *  \param ok: true if page was decoded.
+ */
+static void carousel_complete(lv_pngle_carousel_t * c, bool ok) {
+    carousel_slot_t * slot = c->job;
+    if (!ok) LV_LOG_WARN("decoding of carousel page %d failed.\n", slot->page);
+    slot->ready = ok;
+    carousel_stop(c);
+}
+
+/** \brief Stop the timer decoding pages ahead.
+ *  \param c: pointer to carousel.
+ */
+static void carousel_stop_timer(lv_pngle_carousel_t * c) {
+    if (c->timer == NULL) return;
+#if LV_PNGLE_USE_LVGL_V9
+    lv_timer_delete(c->timer);
+#else
+    lv_timer_del(c->timer);
+#endif
+    c->timer = NULL;
+}
+
+/** \brief Start decoding ahead the next page wanted and not held yet.
+ *  \param c: pointer to carousel.
+ *  \returns true if a decoding is running.
+ */
+static bool carousel_schedule(lv_pngle_carousel_t * c) {
+    if (c->job != NULL) return true;
+    if (c->cur == NULL) return false;
+    int32_t steps[2] = {c->dir, -c->dir};
+    for (uint8_t k = 0; k < LV_PNGLE_CAROUSEL_BUFFERS - 1 && k < 2; k++) {
+        int32_t page = carousel_neighbour(c, c->cur->page, steps[k]);
+        if (page < 0 || carousel_find(c, page) != NULL) continue;
+        carousel_slot_t * slot = carousel_take(c);
+        if (slot == NULL) return false;
+        if (carousel_begin(c, slot, page) == LV_RES_OK) return true;
+        carousel_complete(c, false);
+    }
+    return false;
+}
+
+/** \brief Timer callback decoding pages ahead for a time slice.
+ *  \param t: pointer to timer.
+ */
+static void carousel_timer_cb(lv_timer_t * t) {
+#if LV_PNGLE_USE_LVGL_V9
+    lv_pngle_carousel_t * c = (lv_pngle_carousel_t*)lv_timer_get_user_data(t);
+#else
+    lv_pngle_carousel_t * c = (lv_pngle_carousel_t*)t->user_data;
+#endif
+    uint32_t t0 = lv_tick_get();
+    while (lv_tick_elaps(t0) < LV_PNGLE_CAROUSEL_SLICE_MS) {
+        if (!carousel_schedule(c)) {
+            carousel_stop_timer(c);
+            return;
+        }
+        lv_res_t res = LV_RES_OK;
+        while (!c->ud.data_ready && res == LV_RES_OK && lv_tick_elaps(t0) < LV_PNGLE_CAROUSEL_SLICE_MS)
+            res = carousel_feed(c);
+        if (res != LV_RES_OK) carousel_complete(c, false);
+        else if (c->ud.data_ready) carousel_complete(c, true);
+    }
+}
+
+
+lv_pngle_carousel_t * lv_pngle_carousel_create(const void * const * srcs, uint32_t n, bool loop) {
+    // buffers are sized for the largest image
+    uint32_t max_px = 0;
+    for (uint32_t i = 0; i < n; i++) {
+        lv_pngle_input_t in;
+        uint32_t w, h;
+        if (_lv_pngle_get_src(srcs[i], &in) != LV_RES_OK || _lv_pngle_read_header(&in, &w, &h) != LV_RES_OK) {
+            LV_LOG_WARN("couldn't read header of carousel page %d.\n", i);
+            continue;
+        }
+        if (w*h > max_px) max_px = w*h;
+    }
+    if (max_px == 0) return NULL;
+
+    lv_pngle_carousel_t * c = (lv_pngle_carousel_t*)PNGLE_MALLOC(sizeof(lv_pngle_carousel_t));
+    if (c == NULL) return NULL;
+    memset(c, 0, sizeof(lv_pngle_carousel_t));
+    LV_LOG_INFO("allocating memory for carousel buffers: %d bytes\n", LV_PNGLE_CAROUSEL_BUFFERS*max_px*PNGLE_PX_SIZE);
+    c->data = (uint8_t*)PNGLE_MALLOC(LV_PNGLE_CAROUSEL_BUFFERS*max_px*PNGLE_PX_SIZE);
+    if (c->data == NULL) {
+        PNGLE_FREE(c);
+        return NULL;
+    }
+    c->srcs = srcs;
+    c->n = n;
+    c->loop = loop;
+    c->max_px = max_px;
+    c->dir = 1;
+    for (uint8_t i = 0; i < LV_PNGLE_CAROUSEL_BUFFERS; i++) {
+        carousel_slot_t * slot = &c->slots[i];
+        slot->page = -1;
+        slot->data = c->data + i*max_px*PNGLE_PX_SIZE;
+        slot->dsc.data = slot->data;
+#if LV_PNGLE_USE_LVGL_V9
+        slot->dsc.header.magic = LV_IMAGE_HEADER_MAGIC;
+        slot->dsc.header.cf = PNGLE_CF;
+#else
+        slot->dsc.header.always_zero = 0;
+        slot->dsc.header.cf = LV_IMG_CF_TRUE_COLOR_ALPHA;
+#endif
+    }
+    return c;
+}
+
+
+void lv_pngle_carousel_delete(lv_pngle_carousel_t * c) {
+    carousel_stop_timer(c);
+    for (uint8_t i = 0; i < LV_PNGLE_CAROUSEL_BUFFERS; i++) carousel_drop(c, &c->slots[i]);
+    PNGLE_FREE(c->data);
+    PNGLE_FREE(c);
+}
+
+
+const void * lv_pngle_carousel_show(lv_pngle_carousel_t * c, uint32_t page) {
+    if (page >= c->n) return NULL;
+    carousel_slot_t * slot = carousel_find(c, (int32_t)page);
+    if (slot == NULL || (!slot->ready && c->job != slot)) {
+        // not decoded ahead: decode now
+        if (slot == NULL) slot = carousel_take(c);
+        if (carousel_begin(c, slot, (int32_t)page) != LV_RES_OK) {
+            carousel_complete(c, false);
+            return NULL;
+        }
+    }
+    if (c->job == slot) {
+        lv_res_t res = LV_RES_OK;
+        while (!c->ud.data_ready && res == LV_RES_OK) res = carousel_feed(c);
+        carousel_complete(c, res == LV_RES_OK);
+        if (!slot->ready) return NULL;
+    }
+
+    if (c->cur != NULL && c->cur != slot) {
+        int32_t prev = c->cur->page;
+        if ((int32_t)page == carousel_neighbour(c, prev, 1)) c->dir = 1;
+        else if ((int32_t)page == carousel_neighbour(c, prev, -1)) c->dir = -1;
+        else c->dir = (int32_t)page > prev ? 1 : -1;
+    }
+    c->cur = slot;
+    if (c->job != NULL && !carousel_wanted(c, c->job->page)) carousel_drop(c, c->job);
+    if (carousel_schedule(c) && c->timer == NULL)
+        c->timer = lv_timer_create(carousel_timer_cb, LV_PNGLE_CAROUSEL_PERIOD, c);
+    return &slot->dsc;
+}
+
+#endif
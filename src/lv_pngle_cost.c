@@ -0,0 +1,135 @@
+/** \file lv_pngle_cost.c
+ *  \brief Estimation of PNG decoding cost from image header.
+ *
+ *  Author: Vincent Paeder
+ *  License: MIT
+ */
+#include "lv_pngle_private.h"
+
+#if LV_PNGLE_USE_COST
+
+#define COST_SCALE_ONE 256 ///< Calibration factor for measured times equal to estimates
+#define COST_MIN_SAMPLE_MS 5 ///< Shorter decoding times are too coarse to calibrate estimates
+#define COST_PNGLE_MEM (32768 + 11008 + 256) ///< Memory used by a Pngle instance besides its row buffers (LZ dictionary, inflate state)
+
+/** \brief Calibration state. */
+static struct {
+    /** \brief Ratio of measured to estimated decoding times, times COST_SCALE_ONE. */
+    uint32_t scale;
+
+    /** \brief Number of decoding times measured. */
+    uint32_t n_samples;
+} cost_cal = { COST_SCALE_ONE, 0 };
+
+/** \brief Read a big-endian 32-bit integer.
+ *  \param buf: pointer to data.
+ *  \returns integer value.
+ */
+static uint32_t cost_be32(const uint8_t * buf) {
+    return ((uint32_t)buf[0] << 24) | ((uint32_t)buf[1] << 16) | ((uint32_t)buf[2] << 8) | buf[3];
+}
+
+/** \brief Walk through PNG chunks and collect header fields and image data size.
+ *  \param r: pointer to reader.
+ *  \param cost: target for collected values.
+ *  \returns LV_RES_OK if successful, LV_RES_INV if data isn't a valid PNG image.
+ */
+static lv_res_t cost_scan(lv_pngle_reader_t * r, lv_pngle_cost_t * cost) {
+    const uint8_t magic[] = {0x89, 0x50, 0x4e, 0x47, 0x0d, 0x0a, 0x1a, 0x0a};
+    uint8_t buf[13];
+    if (_lv_pngle_reader_read(r, buf, 8) != LV_RES_OK || memcmp(buf, magic, 8)) return LV_RES_INV;
+    bool has_ihdr = false;
+    // chunk structure: length (4 bytes) | chunk type (4 bytes) | chunk data (length) | CRC (4 bytes)
+    while (_lv_pngle_reader_read(r, buf, 8) == LV_RES_OK) {
+        uint32_t len = cost_be32(buf);
+        if (!memcmp(buf + 4, "IHDR", 4)) {
+            if (len != 13 || _lv_pngle_reader_read(r, buf, 13) != LV_RES_OK) return LV_RES_INV;
+            cost->width = cost_be32(buf);
+            cost->height = cost_be32(buf + 4);
+            cost->bit_depth = buf[8];
+            cost->color_type = buf[9];
+            cost->interlaced = buf[12] != 0;
+            has_ihdr = true;
+            len = 0;
+        } else if (!memcmp(buf + 4, "IDAT", 4)) {
+            cost->idat_size += len;
+            cost->idat_count++;
+        } else if (!memcmp(buf + 4, "IEND", 4)) {
+            break;
+        }
+        _lv_pngle_reader_seek(r, _lv_pngle_reader_tell(r) + len + 4);
+    }
+    return has_ihdr ? LV_RES_OK : LV_RES_INV;
+}
+
+/** \brief Get the size of a row of unfiltered image data.
+ *  \param w: image width.
+ *  \param depth: bits per sample.
+ *  \param color_type: PNG color type.
+ *  \returns number of bytes, filter type byte included.
+ */
+static uint32_t cost_row_size(uint32_t w, uint8_t depth, uint8_t color_type) {
+    // samples per pixel: grayscale, -, RGB, indexed, gray + alpha, -, RGBA
+    static const uint8_t channels[] = {1, 1, 3, 1, 2, 1, 4};
+    uint8_t ch = color_type < sizeof(channels) ? channels[color_type] : 4;
+    return 1 + (w*ch*depth + 7)/8;
+}
+
+/** \brief Estimate decoding time before calibration.
+ *  \param w: image width.
+ *  \param h: image height.
+ *  \param depth: bits per sample.
+ *  \param color_type: PNG color type.
+ *  \param interlaced: true if image is interlaced.
+ *  \param data_size: size of compressed image data.
+ *  \returns estimated time, in microseconds.
+ */
+static uint64_t cost_predict(uint32_t w, uint32_t h, uint8_t depth, uint8_t color_type, bool interlaced, uint32_t data_size) {
+    uint64_t ns = (uint64_t)w*h*LV_PNGLE_COST_NS_PER_PX
+                + (uint64_t)cost_row_size(w, depth, color_type)*h*LV_PNGLE_COST_NS_PER_RAW_BYTE
+                + (uint64_t)data_size*LV_PNGLE_COST_NS_PER_BYTE;
+    // interlaced images go through 7 passes, with extra row setup and filter state
+    if (interlaced) ns += ns/4;
+    return ns/1000;
+}
+
+
+void _lv_pngle_cost_record(const pngle_ihdr_t * ihdr, uint32_t data_size, uint32_t elapsed) {
+    if (elapsed < COST_MIN_SAMPLE_MS) return;
+    uint64_t predicted = cost_predict(ihdr->width, ihdr->height, ihdr->depth, ihdr->color_type,
+                                      ihdr->interlace != 0, data_size);
+    if (predicted == 0) return;
+    uint64_t ratio = (uint64_t)elapsed*1000*COST_SCALE_ONE/predicted;
+    if (ratio > UINT32_MAX) ratio = UINT32_MAX;
+    // moving average, so that estimates follow changes in load or storage speed
+    cost_cal.scale = cost_cal.n_samples ? (uint32_t)((cost_cal.scale*7ULL + ratio)/8) : (uint32_t)ratio;
+    cost_cal.n_samples++;
+    LV_LOG_INFO("decoding took %d ms, %d%% of estimate\n", elapsed, (int)(ratio*100/COST_SCALE_ONE));
+}
+
+
+bool lv_pngle_estimate_cost(const void * src, lv_pngle_cost_t * cost) {
+    lv_pngle_input_t in;
+    lv_pngle_reader_t r;
+    memset(cost, 0, sizeof(lv_pngle_cost_t));
+    if (_lv_pngle_get_src(src, &in) != LV_RES_OK || _lv_pngle_reader_open(&r, &in) != LV_RES_OK) return false;
+    lv_res_t res = cost_scan(&r, cost);
+    _lv_pngle_reader_close(&r);
+    if (res != LV_RES_OK) return false;
+
+    uint64_t t = cost_predict(cost->width, cost->height, cost->bit_depth, cost->color_type,
+                              cost->interlaced, cost->idat_size)*cost_cal.scale/COST_SCALE_ONE;
+    cost->time_us = t > UINT32_MAX ? UINT32_MAX : (uint32_t)t;
+
+    // Pngle keeps two rows of unfiltered data
+    uint32_t pngle_mem = COST_PNGLE_MEM + 2*cost_row_size(cost->width, cost->bit_depth, cost->color_type);
+    cost->mem_full = cost->width*cost->height*PNGLE_PX_SIZE + pngle_mem;
+    if (!cost->interlaced) {
+        uint32_t rows = cost->height < LV_PNGLE_STREAM_BAND_ROWS ? cost->height : LV_PNGLE_STREAM_BAND_ROWS;
+        // band, row handed over to LVGL, file buffer
+        cost->mem_stream = (rows + 1)*cost->width*PNGLE_PX_SIZE + PNGLE_BUF_SIZE + pngle_mem;
+    }
+    return true;
+}
+
+#endif
@@ -0,0 +1,757 @@
+/** \file lv_pngle_huge.c
+ *  \brief Viewport-based display of PNG images too large to be decoded in memory.
+ *
+ *  The image is inflated once when opened, and the inflate state is recorded
+ *  every LV_PNGLE_HUGE_BAND_ROWS rows. Tiles intersecting the drawn area are
+ *  then decoded on demand, resuming from the closest recorded state, and kept
+ *  in a small cache.
+ *
+ *  Resuming decoding requires a copy of the inflate state (LZ dictionary
+ *  included), which Pngle doesn't expose: rows are decoded here with miniz
+ *  directly.
+ *
+ *  Author: Vincent Paeder
+ *  License: MIT
+ */
+#include "lv_pngle_private.h"
+
+#if LV_PNGLE_USE_HUGE
+
+#include "external/src/miniz.h"
+
+#define HUGE_DICT_MASK (TINFL_LZ_DICT_SIZE - 1) ///< Mask wrapping positions in LZ dictionary
+
+#if LV_PNGLE_USE_LVGL_V9
+typedef lv_image_dsc_t huge_dsc_t; ///< Image descriptor of a tile
+#else
+typedef lv_img_dsc_t huge_dsc_t; ///< Image descriptor of a tile
+#endif
+
+/** \brief Decoding state at a row boundary, from which decoding can be resumed. */
+typedef struct _huge_state_t {
+    /** \brief Inflate state. */
+    tinfl_decompressor inflator;
+
+    /** \brief LZ dictionary, also used as output ring buffer. */
+    uint8_t dict[TINFL_LZ_DICT_SIZE];
+
+    /** \brief Position in dictionary where next inflated bytes go. */
+    uint32_t dict_ofs;
+
+    /** \brief Position in dictionary of inflated bytes not yet copied to rows. */
+    uint32_t pending_ofs;
+
+    /** \brief Number of inflated bytes not yet copied to rows. */
+    uint32_t pending_len;
+
+    /** \brief Position in source of next compressed byte. */
+    uint32_t src_pos;
+
+    /** \brief Number of bytes left in current IDAT chunk, from src_pos. */
+    uint32_t chunk_remain;
+
+    /** \brief Next row to decode. */
+    uint32_t row;
+
+    /** \brief If true, compressed data stream ended. */
+    bool done;
+} huge_state_t;
+
+/** \brief A cached tile. */
+typedef struct _huge_tile_t {
+    /** \brief Image descriptor. */
+    huge_dsc_t dsc;
+
+    /** \brief Pixel data. */
+    uint8_t * data;
+
+    /** \brief Tile column, -1 if slot is free. */
+    int32_t tx;
+
+    /** \brief Tile row. */
+    int32_t ty;
+
+    /** \brief Time of last use, for LRU replacement. */
+    uint32_t stamp;
+
+    /** \brief Last drawing pass that used the tile. */
+    uint32_t draw_id;
+} huge_tile_t;
+
+/** \brief A huge PNG image, decoded by tiles. */
+struct _lv_pngle_huge_t {
+    /** \brief Reader over image data. */
+    lv_pngle_reader_t r;
+
+    /** \brief Image width. */
+    uint32_t w;
+
+    /** \brief Image height. */
+    uint32_t h;
+
+    /** \brief Bits per sample. */
+    uint8_t depth;
+
+    /** \brief PNG color type. */
+    uint8_t color_type;
+
+    /** \brief Samples per pixel. */
+    uint8_t channels;
+
+    /** \brief Bytes per pixel, rounded up to 1 (distance used by row filters). */
+    uint8_t bpp;
+
+    /** \brief Size of a row of image data, filter type byte excluded. */
+    uint32_t row_bytes;
+
+    /** \brief Palette, as RGBA values (indexed images only). */
+    uint8_t palette[PNGLE_PALETTE_COLORS*4];
+
+    /** \brief Transparent sample values (grayscale and RGB images only). */
+    uint16_t trns[3];
+
+    /** \brief If true, trns holds a transparent color. */
+    bool has_trns;
+
+    /** \brief Current decoding state. */
+    huge_state_t * st;
+
+    /** \brief Compressed data, in place for memory sources, in reader buffer otherwise. */
+    const uint8_t * in;
+
+    /** \brief Position of next unused byte in compressed data buffer. */
+    uint32_t in_ofs;
+
+    /** \brief Number of bytes in compressed data buffer. */
+    uint32_t in_len;
+
+    /** \brief Previous row, unfiltered, filter type byte first. */
+    uint8_t * prev;
+
+    /** \brief Row being received, filter type byte first. */
+    uint8_t * cur;
+
+    /** \brief Number of bytes of current row received. */
+    uint32_t cur_fill;
+
+    /** \brief Recorded states, one per band of LV_PNGLE_HUGE_BAND_ROWS rows, each followed by the previous row. */
+    huge_state_t ** ckpts;
+
+    /** \brief Number of bands. */
+    uint32_t n_ckpts;
+
+    /** \brief Cached tiles. */
+    huge_tile_t tiles[LV_PNGLE_HUGE_CACHE_TILES];
+
+    /** \brief Pixel data of cached tiles. */
+    uint8_t * tile_data;
+
+    /** \brief Clock used to time tile uses. */
+    uint32_t clock;
+
+    /** \brief Current drawing pass. */
+    uint32_t draw_id;
+
+    /** \brief Horizontal position in image of the left edge of attached object. */
+    int32_t view_x;
+
+    /** \brief Vertical position in image of the top edge of attached object. */
+    int32_t view_y;
+
+    /** \brief Attached object, or NULL. */
+    lv_obj_t * obj;
+};
+
+
+/** \brief Read a big-endian 32-bit integer.
+ *  \param buf: pointer to data.
+ *  \returns integer value.
+ */
+static uint32_t huge_be32(const uint8_t * buf) {
+    return ((uint32_t)buf[0] << 24) | ((uint32_t)buf[1] << 16) | ((uint32_t)buf[2] << 8) | buf[3];
+}
+
+/** \brief Read bytes from source.
+ *  \param hg: pointer to image.
+ *  \param pos: position in source.
+ *  \param buf: target buffer.
+ *  \param len: number of bytes to read.
+ *  \returns LV_RES_OK if successful, LV_RES_INV if data ended.
+ */
+static lv_res_t huge_read(lv_pngle_huge_t * hg, uint32_t pos, uint8_t * buf, uint32_t len) {
+    _lv_pngle_reader_seek(&hg->r, pos);
+    return _lv_pngle_reader_read(&hg->r, buf, len);
+}
+
+/** \brief Read chunks up to the first IDAT chunk, and collect image properties.
+ *  \param hg: pointer to image.
+ *  \returns LV_RES_OK if successful, LV_RES_INV if image can't be decoded by tiles.
+ */
+static lv_res_t huge_scan(lv_pngle_huge_t * hg) {
+    // samples per pixel: grayscale, -, RGB, indexed, gray + alpha, -, RGBA
+    static const uint8_t channels[] = {1, 0, 3, 1, 2, 0, 4};
+    const uint8_t magic[] = {0x89, 0x50, 0x4e, 0x47, 0x0d, 0x0a, 0x1a, 0x0a};
+    uint8_t buf[13];
+    uint32_t pos = 8;
+    if (huge_read(hg, 0, buf, 8) != LV_RES_OK || memcmp(buf, magic, 8)) return LV_RES_INV;
+    for (uint16_t i = 0; i < PNGLE_PALETTE_COLORS; i++) hg->palette[i*4 + 3] = 0xff;
+
+    // chunk structure: length (4 bytes) | chunk type (4 bytes) | chunk data (length) | CRC (4 bytes)
+    while (huge_read(hg, pos, buf, 8) == LV_RES_OK) {
+        uint32_t len = huge_be32(buf);
+        // a corrupt length would wrap the position around
+        if (len > UINT32_MAX - 12 - pos) return LV_RES_INV;
+        pos += 8;
+        if (!memcmp(buf + 4, "IHDR", 4)) {
+            if (len != 13 || huge_read(hg, pos, buf, 13) != LV_RES_OK) return LV_RES_INV;
+            hg->w = huge_be32(buf);
+            hg->h = huge_be32(buf + 4);
+            hg->depth = buf[8];
+            hg->color_type = buf[9];
+            hg->channels = hg->color_type < sizeof(channels) ? channels[hg->color_type] : 0;
+            if (hg->channels == 0 || hg->depth == 0 || hg->depth > 16 || hg->w == 0 || hg->h == 0) return LV_RES_INV;
+            if (buf[12]) {
+                LV_LOG_ERROR("interlaced images can't be decoded by tiles.\n");
+                return LV_RES_INV;
+            }
+        } else if (!memcmp(buf + 4, "PLTE", 4)) {
+            for (uint32_t i = 0; i < len/3 && i < PNGLE_PALETTE_COLORS; i++) {
+                if (huge_read(hg, pos + i*3, hg->palette + i*4, 3) != LV_RES_OK) return LV_RES_INV;
+            }
+        } else if (!memcmp(buf + 4, "tRNS", 4)) {
+            if (hg->color_type == 3) {
+                for (uint32_t i = 0; i < len && i < PNGLE_PALETTE_COLORS; i++) {
+                    if (huge_read(hg, pos + i, hg->palette + i*4 + 3, 1) != LV_RES_OK) return LV_RES_INV;
+                }
+            } else if (len <= 6 && huge_read(hg, pos, buf, len) == LV_RES_OK) {
+                for (uint32_t i = 0; i < len/2; i++) hg->trns[i] = (buf[2*i] << 8) | buf[2*i + 1];
+                hg->has_trns = true;
+            }
+        } else if (!memcmp(buf + 4, "IDAT", 4)) {
+            if (hg->channels == 0) return LV_RES_INV;
+            hg->st->src_pos = pos;
+            hg->st->chunk_remain = len;
+            uint32_t bits = hg->channels*hg->depth;
+            hg->bpp = bits < 8 ? 1 : bits/8;
+            hg->row_bytes = (hg->w*bits + 7)/8;
+            return LV_RES_OK;
+        }
+        pos += len + 4;
+    }
+    return LV_RES_INV;
+}
+
+/** \brief Fill compressed data buffer from the current IDAT chunk, or the next one.
+ *  \param hg: pointer to image.
+ *  \returns LV_RES_OK if successful, LV_RES_INV if image data ended.
+ */
+static lv_res_t huge_refill(lv_pngle_huge_t * hg) {
+    huge_state_t * st = hg->st;
+    hg->in_ofs = hg->in_len = 0;
+    while (st->chunk_remain == 0) {
+        // CRC of current chunk, then length and type of next one
+        uint8_t buf[12];
+        if (huge_read(hg, st->src_pos, buf, 12) != LV_RES_OK || memcmp(buf + 8, "IDAT", 4)) return LV_RES_INV;
+        st->chunk_remain = huge_be32(buf + 4);
+        st->src_pos += 12;
+    }
+    // data stays valid until the next read, which only happens once it's all inflated
+    _lv_pngle_reader_seek(&hg->r, st->src_pos);
+    uint32_t n = _lv_pngle_reader_peek(&hg->r, &hg->in, st->chunk_remain);
+    if (n == 0) return LV_RES_INV;
+    hg->in_len = n;
+    st->src_pos += n;
+    st->chunk_remain -= n;
+    return LV_RES_OK;
+}
+
+/** \brief Inflate compressed data until some output is available.
+ *  \param hg: pointer to image.
+ *  \returns LV_RES_OK if successful, LV_RES_INV if data is corrupted or truncated.
+ */
+static lv_res_t huge_inflate(lv_pngle_huge_t * hg) {
+    huge_state_t * st = hg->st;
+    while (st->pending_len == 0) {
+        if (st->done) return LV_RES_INV;
+        // a failed refill leaves the buffer empty: the inflator may still hold output
+        if (hg->in_ofs == hg->in_len) huge_refill(hg);
+        size_t in_size = hg->in_len - hg->in_ofs;
+        size_t out_size = TINFL_LZ_DICT_SIZE - st->dict_ofs;
+        tinfl_status status = tinfl_decompress(&st->inflator, hg->in + hg->in_ofs, &in_size,
+                                               st->dict, st->dict + st->dict_ofs, &out_size,
+                                               TINFL_FLAG_PARSE_ZLIB_HEADER | TINFL_FLAG_HAS_MORE_INPUT);
+        hg->in_ofs += in_size;
+        st->pending_ofs = st->dict_ofs;
+        st->pending_len = out_size;
+        st->dict_ofs = (st->dict_ofs + out_size) & HUGE_DICT_MASK;
+        if (status < TINFL_STATUS_DONE || (in_size == 0 && out_size == 0)) return LV_RES_INV;
+        if (status == TINFL_STATUS_DONE) st->done = true;
+    }
+    return LV_RES_OK;
+}
+
+/** \brief Reverse PNG row filter.
+ *  \param cur: row to unfilter, filter type byte first.
+ *  \param prev: previous row, unfiltered, filter type byte first.
+ *  \param len: number of bytes in row, filter type byte excluded.
+ *  \param bpp: bytes per pixel, rounded up to 1.
+ *  \returns LV_RES_OK if successful, LV_RES_INV if filter type is unknown.
+ */
+static lv_res_t huge_unfilter(uint8_t * cur, const uint8_t * prev, uint32_t len, uint8_t bpp) {
+    uint8_t filter = *cur++;
+    prev++;
+    switch (filter) {
+    case 0:
+        break;
+    case 1:
+        for (uint32_t i = bpp; i < len; i++) cur[i] += cur[i - bpp];
+        break;
+    case 2:
+        for (uint32_t i = 0; i < len; i++) cur[i] += prev[i];
+        break;
+    case 3:
+        for (uint32_t i = 0; i < len; i++) cur[i] += ((i >= bpp ? cur[i - bpp] : 0) + prev[i]) >> 1;
+        break;
+    case 4:
+        for (uint32_t i = 0; i < len; i++) {
+            int16_t a = i >= bpp ? cur[i - bpp] : 0;
+            int16_t b = prev[i];
+            int16_t c = i >= bpp ? prev[i - bpp] : 0;
+            int16_t p = a + b - c;
+            int16_t pa = p > a ? p - a : a - p;
+            int16_t pb = p > b ? p - b : b - p;
+            int16_t pc = p > c ? p - c : c - p;
+            cur[i] += (pa <= pb && pa <= pc) ? a : (pb <= pc ? b : c);
+        }
+        break;
+    default:
+        return LV_RES_INV;
+    }
+    return LV_RES_OK;
+}
+
+/** \brief Record decoding state at a band boundary, if not done yet.
+ *  \param hg: pointer to image.
+ */
+static void huge_record(lv_pngle_huge_t * hg) {
+    huge_state_t * st = hg->st;
+    uint32_t band = st->row/LV_PNGLE_HUGE_BAND_ROWS;
+    if (hg->ckpts[band] != NULL) return;
+    huge_state_t * ck = (huge_state_t*)PNGLE_MALLOC(sizeof(huge_state_t) + hg->row_bytes + 1);
+    if (ck == NULL) {
+        LV_LOG_WARN("not enough memory to record decoding state of band %d.\n", band);
+        return;
+    }
+    memcpy(ck, st, sizeof(huge_state_t));
+    // buffered compressed bytes are read again when resuming
+    ck->src_pos -= hg->in_len - hg->in_ofs;
+    ck->chunk_remain += hg->in_len - hg->in_ofs;
+    memcpy(ck + 1, hg->prev, hg->row_bytes + 1);
+    hg->ckpts[band] = ck;
+}
+
+/** \brief Resume decoding from a recorded state.
+ *  \param hg: pointer to image.
+ *  \param band: band index.
+ *  \returns LV_RES_OK if successful, LV_RES_INV if there's no state recorded for this band.
+ */
+static lv_res_t huge_restore(lv_pngle_huge_t * hg, uint32_t band) {
+    const huge_state_t * ck = hg->ckpts[band];
+    if (ck == NULL) return LV_RES_INV;
+    memcpy(hg->st, ck, sizeof(huge_state_t));
+    memcpy(hg->prev, ck + 1, hg->row_bytes + 1);
+    hg->in_ofs = hg->in_len = 0;
+    hg->cur_fill = 0;
+    return LV_RES_OK;
+}
+
+/** \brief Decode next row.
+ *  \param hg: pointer to image.
+ *  \returns pointer to unfiltered row data, or NULL if failed.
+ */
+static const uint8_t * huge_next_row(lv_pngle_huge_t * hg) {
+    huge_state_t * st = hg->st;
+    if (st->row >= hg->h) return NULL;
+    if (st->row % LV_PNGLE_HUGE_BAND_ROWS == 0) huge_record(hg);
+
+    uint32_t need = hg->row_bytes + 1;
+    while (hg->cur_fill < need) {
+        if (huge_inflate(hg) != LV_RES_OK) return NULL;
+        uint32_t n = need - hg->cur_fill;
+        if (n > st->pending_len) n = st->pending_len;
+        memcpy(hg->cur + hg->cur_fill, st->dict + st->pending_ofs, n);
+        hg->cur_fill += n;
+        st->pending_ofs += n;
+        st->pending_len -= n;
+    }
+    hg->cur_fill = 0;
+    if (huge_unfilter(hg->cur, hg->prev, hg->row_bytes, hg->bpp) != LV_RES_OK) return NULL;
+    uint8_t * row = hg->cur;
+    hg->cur = hg->prev;
+    hg->prev = row;
+    st->row++;
+    return row + 1;
+}
+
+/** \brief Get a sample from a row.
+ *  \param hg: pointer to image.
+ *  \param row: unfiltered row data.
+ *  \param i: sample index.
+ *  \returns sample value.
+ */
+static uint16_t huge_sample(const lv_pngle_huge_t * hg, const uint8_t * row, uint32_t i) {
+    switch (hg->depth) {
+    case 16:
+        return (row[2*i] << 8) | row[2*i + 1];
+    case 8:
+        return row[i];
+    default: {
+        uint32_t bit = i*hg->depth;
+        return (row[bit >> 3] >> (8 - hg->depth - (bit & 7))) & ((1 << hg->depth) - 1);
+    }
+    }
+}
+
+/** \brief Scale a sample to 8 bits.
+ *  \param hg: pointer to image.
+ *  \param v: sample value.
+ *  \returns 8-bit value.
+ */
+static uint8_t huge_scale(const lv_pngle_huge_t * hg, uint16_t v) {
+    if (hg->depth == 16) return v >> 8;
+    if (hg->depth == 8) return v;
+    return v*255/((1 << hg->depth) - 1);
+}
+
+/** \brief Get a pixel from a row.
+ *  \param hg: pointer to image.
+ *  \param row: unfiltered row data.
+ *  \param x: pixel column.
+ *  \param rgba: target for pixel value.
+ */
+static void huge_get_pixel(const lv_pngle_huge_t * hg, const uint8_t * row, uint32_t x, uint8_t * rgba) {
+    uint32_t i = x*hg->channels;
+    uint16_t s[4];
+    for (uint8_t c = 0; c < hg->channels; c++) s[c] = huge_sample(hg, row, i + c);
+    switch (hg->color_type) {
+    case 3:
+        memcpy(rgba, hg->palette + (s[0] & 0xff)*4, 4);
+        break;
+    case 0:
+        rgba[0] = rgba[1] = rgba[2] = huge_scale(hg, s[0]);
+        rgba[3] = (hg->has_trns && s[0] == hg->trns[0]) ? 0 : 0xff;
+        break;
+    case 2:
+        for (uint8_t c = 0; c < 3; c++) rgba[c] = huge_scale(hg, s[c]);
+        rgba[3] = (hg->has_trns && s[0] == hg->trns[0] && s[1] == hg->trns[1] && s[2] == hg->trns[2]) ? 0 : 0xff;
+        break;
+    case 4:
+        rgba[0] = rgba[1] = rgba[2] = huge_scale(hg, s[0]);
+        rgba[3] = huge_scale(hg, s[1]);
+        break;
+    default:
+        for (uint8_t c = 0; c < 4; c++) rgba[c] = huge_scale(hg, s[c]);
+        break;
+    }
+}
+
+/** \brief Decode tiles of a tile row.
+ *  \param hg: pointer to image.
+ *  \param ty: tile row.
+ *  \param tiles: tiles to decode.
+ *  \param n: number of tiles.
+ *  \returns LV_RES_OK if successful, LV_RES_INV if failed.
+ */
+static lv_res_t huge_decode_tiles(lv_pngle_huge_t * hg, uint32_t ty, huge_tile_t ** tiles, uint16_t n) {
+    uint32_t y0 = ty*LV_PNGLE_HUGE_TILE_SIZE;
+    uint32_t y1 = y0 + LV_PNGLE_HUGE_TILE_SIZE < hg->h ? y0 + LV_PNGLE_HUGE_TILE_SIZE : hg->h;
+    // carry on from current state if it isn't further than a recorded one
+    uint32_t row = hg->st->row;
+    if (row > y0 || y0 - row >= LV_PNGLE_HUGE_BAND_ROWS) {
+        // states that couldn't be recorded for lack of memory are replaced by earlier ones
+        uint32_t band = y0/LV_PNGLE_HUGE_BAND_ROWS;
+        while (band > 0 && hg->ckpts[band] == NULL) band--;
+        if (huge_restore(hg, band) != LV_RES_OK) return LV_RES_INV;
+    }
+
+    while (hg->st->row < y1) {
+        uint32_t y = hg->st->row;
+        const uint8_t * src = huge_next_row(hg);
+        if (src == NULL) {
+            LV_LOG_ERROR("PNG decoding failed at row %d.\n", y);
+            // force a restart from a recorded state next time
+            hg->st->row = hg->h;
+            return LV_RES_INV;
+        }
+        if (y < y0) continue;
+        for (uint16_t k = 0; k < n; k++) {
+            huge_tile_t * tile = tiles[k];
+            uint32_t tw = tile->dsc.header.w;
+            uint32_t th = tile->dsc.header.h;
+            uint32_t x0 = tile->tx*LV_PNGLE_HUGE_TILE_SIZE;
+            uint32_t ly = y - y0;
+            for (uint32_t lx = 0; lx < tw; lx++) {
+                uint8_t rgba[4];
+                huge_get_pixel(hg, src, x0 + lx, rgba);
+                _lv_pngle_convert_pixel(tile->data + (ly*tw + lx)*PNGLE_COLOR_SIZE,
+                                        PNGLE_PLANAR_ALPHA ? tile->data + tw*th*PNGLE_COLOR_SIZE + ly*tw + lx : NULL, rgba);
+            }
+        }
+    }
+    return LV_RES_OK;
+}
+
+/** \brief Release a tile slot, and drop copies LVGL may have cached.
+ *  \param tile: pointer to tile.
+ */
+static void huge_free_tile(huge_tile_t * tile) {
+    if (tile->tx < 0) return;
+#if LV_PNGLE_USE_LVGL_V9
+    lv_image_cache_drop(&tile->dsc);
+#else
+    lv_img_cache_invalidate_src(&tile->dsc);
+#endif
+    tile->tx = -1;
+}
+
+/** \brief Find a cached tile.
+ *  \param hg: pointer to image.
+ *  \param tx: tile column.
+ *  \param ty: tile row.
+ *  \returns pointer to tile, or NULL if not cached.
+ */
+static huge_tile_t * huge_find_tile(lv_pngle_huge_t * hg, int32_t tx, int32_t ty) {
+    for (uint16_t i = 0; i < LV_PNGLE_HUGE_CACHE_TILES; i++) {
+        if (hg->tiles[i].tx == tx && hg->tiles[i].ty == ty) return &hg->tiles[i];
+    }
+    return NULL;
+}
+
+/** \brief Take a tile slot, replacing the least recently used tile not drawn in the current pass.
+ *  \param hg: pointer to image.
+ *  \param tx: tile column.
+ *  \param ty: tile row.
+ *  \returns pointer to tile, or NULL if all tiles are in use.
+ */
+static huge_tile_t * huge_take_tile(lv_pngle_huge_t * hg, int32_t tx, int32_t ty) {
+    huge_tile_t * tile = NULL;
+    for (uint16_t i = 0; i < LV_PNGLE_HUGE_CACHE_TILES; i++) {
+        huge_tile_t * t = &hg->tiles[i];
+        if (t->tx >= 0 && t->draw_id == hg->draw_id) continue;
+        if (tile == NULL || t->tx < 0 || (tile->tx >= 0 && t->stamp < tile->stamp)) tile = t;
+        if (t->tx < 0) break;
+    }
+    if (tile == NULL) return NULL;
+    huge_free_tile(tile);
+
+    uint32_t x0 = tx*LV_PNGLE_HUGE_TILE_SIZE;
+    uint32_t y0 = ty*LV_PNGLE_HUGE_TILE_SIZE;
+    uint32_t tw = hg->w - x0 < LV_PNGLE_HUGE_TILE_SIZE ? hg->w - x0 : LV_PNGLE_HUGE_TILE_SIZE;
+    uint32_t th = hg->h - y0 < LV_PNGLE_HUGE_TILE_SIZE ? hg->h - y0 : LV_PNGLE_HUGE_TILE_SIZE;
+    tile->tx = tx;
+    tile->ty = ty;
+    tile->dsc.header.w = tw;
+    tile->dsc.header.h = th;
+#if LV_PNGLE_USE_LVGL_V9
+    tile->dsc.header.stride = tw*PNGLE_COLOR_SIZE;
+#endif
+    tile->dsc.data_size = tw*th*PNGLE_PX_SIZE;
+    return tile;
+}
+
+
+lv_pngle_huge_t * lv_pngle_huge_open(const void * src) {
+    lv_pngle_input_t in;
+    if (_lv_pngle_get_src(src, &in) != LV_RES_OK) return NULL;
+
+    lv_pngle_huge_t * hg = (lv_pngle_huge_t*)PNGLE_MALLOC(sizeof(lv_pngle_huge_t));
+    if (hg == NULL) return NULL;
+    memset(hg, 0, sizeof(lv_pngle_huge_t));
+    for (uint16_t i = 0; i < LV_PNGLE_HUGE_CACHE_TILES; i++) hg->tiles[i].tx = -1;
+    if (_lv_pngle_reader_open(&hg->r, &in) != LV_RES_OK) {
+        PNGLE_FREE(hg);
+        return NULL;
+    }
+
+    hg->st = (huge_state_t*)PNGLE_MALLOC(sizeof(huge_state_t));
+    if (hg->st == NULL || huge_scan(hg) != LV_RES_OK) {
+        LV_LOG_ERROR("PNG image can't be decoded by tiles.\n");
+        lv_pngle_huge_close(hg);
+        return NULL;
+    }
+    tinfl_init(&hg->st->inflator);
+    hg->st->dict_ofs = hg->st->pending_ofs = hg->st->pending_len = 0;
+    hg->st->row = 0;
+    hg->st->done = false;
+
+    hg->n_ckpts = (hg->h + LV_PNGLE_HUGE_BAND_ROWS - 1)/LV_PNGLE_HUGE_BAND_ROWS;
+    uint32_t tile_size = LV_PNGLE_HUGE_TILE_SIZE*LV_PNGLE_HUGE_TILE_SIZE*PNGLE_PX_SIZE;
+    LV_LOG_INFO("allocating memory for tiled image: %d bytes\n",
+                (int)(hg->n_ckpts*(sizeof(huge_state_t) + hg->row_bytes + 1) + LV_PNGLE_HUGE_CACHE_TILES*tile_size));
+    hg->ckpts = (huge_state_t**)PNGLE_MALLOC(hg->n_ckpts*sizeof(huge_state_t*));
+    hg->prev = (uint8_t*)PNGLE_MALLOC(hg->row_bytes + 1);
+    hg->cur = (uint8_t*)PNGLE_MALLOC(hg->row_bytes + 1);
+    hg->tile_data = (uint8_t*)PNGLE_MALLOC(LV_PNGLE_HUGE_CACHE_TILES*tile_size);
+    if (hg->ckpts == NULL || hg->prev == NULL || hg->cur == NULL || hg->tile_data == NULL) {
+        lv_pngle_huge_close(hg);
+        return NULL;
+    }
+    memset(hg->ckpts, 0, hg->n_ckpts*sizeof(huge_state_t*));
+    memset(hg->prev, 0, hg->row_bytes + 1);
+
+    for (uint16_t i = 0; i < LV_PNGLE_HUGE_CACHE_TILES; i++) {
+        huge_tile_t * tile = &hg->tiles[i];
+        tile->data = hg->tile_data + i*tile_size;
+        tile->dsc.data = tile->data;
+#if LV_PNGLE_USE_LVGL_V9
+        tile->dsc.header.magic = LV_IMAGE_HEADER_MAGIC;
+        tile->dsc.header.cf = PNGLE_CF;
+#else
+        tile->dsc.header.always_zero = 0;
+        tile->dsc.header.cf = LV_IMG_CF_TRUE_COLOR_ALPHA;
+#endif
+    }
+
+    // indexing pass: inflate the whole image once, recording states along the way
+    while (hg->st->row < hg->h) {
+        if (huge_next_row(hg) == NULL) {
+            LV_LOG_ERROR("PNG decoding failed at row %d.\n", hg->st->row);
+            lv_pngle_huge_close(hg);
+            return NULL;
+        }
+    }
+    return hg;
+}
+
+
+void lv_pngle_huge_close(lv_pngle_huge_t * hg) {
+    for (uint16_t i = 0; i < LV_PNGLE_HUGE_CACHE_TILES; i++) huge_free_tile(&hg->tiles[i]);
+    if (hg->ckpts != NULL) {
+        for (uint32_t i = 0; i < hg->n_ckpts; i++) {
+            if (hg->ckpts[i] != NULL) PNGLE_FREE(hg->ckpts[i]);
+        }
+        PNGLE_FREE(hg->ckpts);
+    }
+    if (hg->st != NULL) PNGLE_FREE(hg->st);
+    if (hg->prev != NULL) PNGLE_FREE(hg->prev);
+    if (hg->cur != NULL) PNGLE_FREE(hg->cur);
+    if (hg->tile_data != NULL) PNGLE_FREE(hg->tile_data);
+    _lv_pngle_reader_close(&hg->r);
+    PNGLE_FREE(hg);
+}
+
+
+void lv_pngle_huge_get_size(const lv_pngle_huge_t * hg, uint32_t * w, uint32_t * h) {
+    *w = hg->w;
+    *h = hg->h;
+}
+
+
+/** \brief Draw a tile.
+ *  \param ctx: drawing target.
+ *  \param tile: tile.
+ *  \param x: horizontal position of tile on screen.
+ *  \param y: vertical position of tile on screen.
+ *  \param opa: opacity.
+ */
+static void huge_draw_tile(lv_pngle_draw_ctx_t * ctx, const huge_tile_t * tile, int32_t x, int32_t y, lv_opa_t opa) {
+    lv_area_t a;
+    a.x1 = x;
+    a.y1 = y;
+    a.x2 = x + tile->dsc.header.w - 1;
+    a.y2 = y + tile->dsc.header.h - 1;
+#if LV_PNGLE_USE_LVGL_V9
+    lv_draw_image_dsc_t dsc;
+    lv_draw_image_dsc_init(&dsc);
+    dsc.src = &tile->dsc;
+    dsc.opa = opa;
+    lv_draw_image(ctx, &dsc, &a);
+#else
+    lv_draw_img_dsc_t dsc;
+    lv_draw_img_dsc_init(&dsc);
+    dsc.opa = opa;
+    lv_draw_img(ctx, &dsc, &a, &tile->dsc);
+#endif
+}
+
+
+void lv_pngle_huge_draw(lv_pngle_draw_ctx_t * ctx, lv_pngle_huge_t * hg, const lv_area_t * coords,
+                        int32_t x, int32_t y, lv_opa_t opa) {
+    lv_area_t clip;
+#if LV_PNGLE_USE_LVGL_V9
+    if (!lv_area_intersect(&clip, coords, &ctx->_clip_area)) return;
+#else
+    if (!_lv_area_intersect(&clip, coords, ctx->clip_area)) return;
+#endif
+    // image pixel (ix, iy) is drawn at (ox + ix, oy + iy); only tiles under the clip area are needed
+    int32_t ox = coords->x1 - x;
+    int32_t oy = coords->y1 - y;
+    int32_t ix1 = clip.x1 - ox > 0 ? clip.x1 - ox : 0;
+    int32_t iy1 = clip.y1 - oy > 0 ? clip.y1 - oy : 0;
+    int32_t ix2 = clip.x2 - ox < (int32_t)hg->w - 1 ? clip.x2 - ox : (int32_t)hg->w - 1;
+    int32_t iy2 = clip.y2 - oy < (int32_t)hg->h - 1 ? clip.y2 - oy : (int32_t)hg->h - 1;
+    if (ix1 > ix2 || iy1 > iy2) return;
+
+    hg->draw_id++;
+    for (int32_t ty = iy1/LV_PNGLE_HUGE_TILE_SIZE; ty <= iy2/LV_PNGLE_HUGE_TILE_SIZE; ty++) {
+        huge_tile_t * missing[LV_PNGLE_HUGE_CACHE_TILES];
+        uint16_t n = 0;
+        int32_t tx2 = ix2/LV_PNGLE_HUGE_TILE_SIZE;
+        for (int32_t tx = ix1/LV_PNGLE_HUGE_TILE_SIZE; tx <= tx2; tx++) {
+            huge_tile_t * tile = huge_find_tile(hg, tx, ty);
+            if (tile == NULL) {
+                tile = huge_take_tile(hg, tx, ty);
+                if (tile == NULL) {
+                    LV_LOG_WARN("tile cache is too small for drawn area.\n");
+                    tx2 = tx - 1;
+                    break;
+                }
+                missing[n++] = tile;
+            }
+            tile->stamp = ++hg->clock;
+            tile->draw_id = hg->draw_id;
+        }
+        // all missing tiles of a tile row are decoded in one pass over its rows
+        if (n && huge_decode_tiles(hg, ty, missing, n) != LV_RES_OK) {
+            for (uint16_t k = 0; k < n; k++) huge_free_tile(missing[k]);
+            return;
+        }
+        for (int32_t tx = ix1/LV_PNGLE_HUGE_TILE_SIZE; tx <= tx2; tx++) {
+            huge_tile_t * tile = huge_find_tile(hg, tx, ty);
+            huge_draw_tile(ctx, tile, ox + tx*LV_PNGLE_HUGE_TILE_SIZE, oy + ty*LV_PNGLE_HUGE_TILE_SIZE, opa);
+        }
+        if (tx2 < ix2/LV_PNGLE_HUGE_TILE_SIZE) return;
+    }
+}
+
+
+/** \brief Event callback drawing a huge image as object background.
+ *  \param e: event.
+ */
+static void huge_event_cb(lv_event_t * e) {
+    lv_obj_t * obj = (lv_obj_t*)lv_event_get_current_target(e);
+    lv_pngle_huge_t * hg = (lv_pngle_huge_t*)lv_event_get_user_data(e);
+    lv_area_t coords;
+    lv_obj_get_coords(obj, &coords);
+#if LV_PNGLE_USE_LVGL_V9
+    lv_pngle_huge_draw(lv_event_get_layer(e), hg, &coords, hg->view_x, hg->view_y, LV_OPA_COVER);
+#else
+    lv_pngle_huge_draw(lv_event_get_draw_ctx(e), hg, &coords, hg->view_x, hg->view_y, LV_OPA_COVER);
+#endif
+}
+
+
+void lv_pngle_huge_attach(lv_obj_t * obj, lv_pngle_huge_t * hg) {
+    hg->obj = obj;
+    lv_obj_add_event_cb(obj, huge_event_cb, LV_EVENT_DRAW_MAIN, hg);
+}
+
+
+void lv_pngle_huge_set_view(lv_pngle_huge_t * hg, int32_t x, int32_t y) {
+    if (hg->view_x == x && hg->view_y == y) return;
+    hg->view_x = x;
+    hg->view_y = y;
+    if (hg->obj != NULL) lv_obj_invalidate(hg->obj);
+}
+
+#endif
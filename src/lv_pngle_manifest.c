@@ -0,0 +1,494 @@
+/** \file lv_pngle_manifest.c
+ *  \brief Asset manifest holding header fields of PNG files, so that they can be
+ *  looked up without opening the files.
+ *
+ *  Manifest file layout (little-endian): magic "LVPM" | version (2 bytes) |
+ *  reserved (2 bytes) | number of entries (4 bytes) | size of paths (4 bytes) |
+ *  entries sorted by path hash | paths, stored contiguously.
+ *
+ *  Entries are found by path hash, then by comparing the full path. The size
+ *  of a file is checked against its entry the first time the entry is used, and
+ *  entries of files that changed since are ignored.
+ *
+ *  Author: Vincent Paeder
+ *  License: MIT
+ */
+#include "lv_pngle_private.h"
+
+#if LV_PNGLE_USE_MANIFEST
+
+#define MANIFEST_VERSION 2 ///< Version of manifest file layout
+#define MANIFEST_HDR_SIZE 16 ///< Size of manifest file header
+#define MANIFEST_ENTRY_SIZE 32 ///< Size of an entry in manifest file
+#define MANIFEST_FLAG_ALPHA 0x01 ///< Image has an alpha channel or a transparent color
+#define MANIFEST_FLAG_INTERLACED 0x02 ///< Image is interlaced
+#define MANIFEST_FLAG_CHECKED 0x40 ///< File size was checked against the entry (in memory only)
+#define MANIFEST_FLAG_STALE 0x80 ///< File changed since the manifest was written (in memory only)
+#define MANIFEST_MEM_FLAGS (MANIFEST_FLAG_CHECKED | MANIFEST_FLAG_STALE) ///< Flags not written to manifest files
+
+/** \brief Header fields of a PNG file. */
+typedef struct _manifest_entry_t {
+    /** \brief Hash of file path. */
+    uint32_t hash;
+
+    /** \brief Offset of file path in paths. */
+    uint32_t name_ofs;
+
+    /** \brief Length of file path. */
+    uint8_t name_len;
+
+    /** \brief File size, used to detect changed files. */
+    uint32_t file_size;
+
+    /** \brief Image width. */
+    uint32_t w;
+
+    /** \brief Image height. */
+    uint32_t h;
+
+    /** \brief Offset of the first IDAT chunk. */
+    uint32_t idat_offset;
+
+    /** \brief Offset after the last chunk needed to decode image data (IHDR, PLTE, tRNS). */
+    uint32_t hdr_end;
+
+    /** \brief Bits per sample. */
+    uint8_t depth;
+
+    /** \brief PNG color type. */
+    uint8_t color_type;
+
+    /** \brief Combination of MANIFEST_FLAG_* values. */
+    uint8_t flags;
+} manifest_entry_t;
+
+/** \brief Loaded manifest. */
+static struct {
+    /** \brief Entries, sorted by path hash. */
+    manifest_entry_t * entries;
+
+    /** \brief Number of entries. */
+    uint32_t n;
+
+    /** \brief File paths of entries. */
+    char * names;
+} manifest = { NULL, 0, NULL };
+
+/** \brief Entries collected while building a manifest. */
+typedef struct _manifest_build_t {
+    /** \brief Entries. */
+    manifest_entry_t * entries;
+
+    /** \brief Number of entries. */
+    uint32_t n;
+
+    /** \brief Number of allocated entries. */
+    uint32_t size;
+
+    /** \brief File paths of entries. */
+    char * names;
+
+    /** \brief Size of file paths. */
+    uint32_t names_len;
+
+    /** \brief Allocated size of file paths. */
+    uint32_t names_size;
+} manifest_build_t;
+
+
+/** \brief Hash a file path (FNV-1a).
+ *  \param fn: file path.
+ *  \returns hash value.
+ */
+static uint32_t manifest_hash(const char * fn) {
+    uint32_t h = 2166136261u;
+    while (*fn) h = (h ^ (uint8_t)*fn++)*16777619u;
+    return h;
+}
+
+/** \brief Read a big-endian 32-bit integer.
+ *  \param buf: pointer to data.
+ *  \returns integer value.
+ */
+static uint32_t manifest_be32(const uint8_t * buf) {
+    return ((uint32_t)buf[0] << 24) | ((uint32_t)buf[1] << 16) | ((uint32_t)buf[2] << 8) | buf[3];
+}
+
+/** \brief Read a little-endian 32-bit integer.
+ *  \param buf: pointer to data.
+ *  \returns integer value.
+ */
+static uint32_t manifest_le32(const uint8_t * buf) {
+    return ((uint32_t)buf[3] << 24) | ((uint32_t)buf[2] << 16) | ((uint32_t)buf[1] << 8) | buf[0];
+}
+
+/** \brief Write a little-endian 32-bit integer.
+ *  \param buf: target buffer.
+ *  \param v: integer value.
+ */
+static void manifest_put_le32(uint8_t * buf, uint32_t v) {
+    buf[0] = v & 0xff;
+    buf[1] = (v >> 8) & 0xff;
+    buf[2] = (v >> 16) & 0xff;
+    buf[3] = v >> 24;
+}
+
+/** \brief Find the entry of a file.
+ *  \param fn: file path.
+ *  \returns pointer to entry, or NULL if file isn't in manifest or changed since it was written.
+ */
+static manifest_entry_t * manifest_find(const char * fn) {
+    uint32_t hash = manifest_hash(fn);
+    size_t len = strlen(fn);
+    uint32_t lo = 0, hi = manifest.n;
+    while (lo < hi) {
+        uint32_t mid = (lo + hi)/2;
+        if (manifest.entries[mid].hash < hash) lo = mid + 1;
+        else hi = mid;
+    }
+    // paths with the same hash follow each other
+    for (; lo < manifest.n && manifest.entries[lo].hash == hash; lo++) {
+        manifest_entry_t * e = &manifest.entries[lo];
+        if (e->name_len == len && !memcmp(manifest.names + e->name_ofs, fn, len)) {
+            return (e->flags & MANIFEST_FLAG_STALE) ? NULL : e;
+        }
+    }
+    return NULL;
+}
+
+/** \brief Check that a file has the size recorded in its entry, the first time the entry is used.
+ *  Entries of files that changed are ignored from then on.
+ *  \param fn: file path.
+ *  \param e: pointer to entry.
+ *  \param file_size: file size if known, 0 to read it.
+ *  \returns LV_RES_OK if entry can be trusted, LV_RES_INV otherwise.
+ */
+static lv_res_t manifest_check(const char * fn, manifest_entry_t * e, uint32_t file_size) {
+    if (file_size == 0) {
+        if (e->flags & MANIFEST_FLAG_CHECKED) return LV_RES_OK;
+        // no data is read: only the file size
+        lv_fs_file_t f;
+        if (lv_fs_open(&f, fn, LV_FS_MODE_RD) != LV_FS_RES_OK) return LV_RES_INV;
+        lv_res_t res = (lv_fs_seek(&f, 0, LV_FS_SEEK_END) == LV_FS_RES_OK &&
+                        lv_fs_tell(&f, &file_size) == LV_FS_RES_OK) ? LV_RES_OK : LV_RES_INV;
+        lv_fs_close(&f);
+        if (res != LV_RES_OK) return LV_RES_INV;
+    }
+    if (e->file_size != file_size) {
+        // header is parsed from the file instead
+        LV_LOG_WARN("%s changed since the manifest was written.\n", fn);
+        e->flags |= MANIFEST_FLAG_STALE;
+        return LV_RES_INV;
+    }
+    e->flags |= MANIFEST_FLAG_CHECKED;
+    return LV_RES_OK;
+}
+
+/** \brief Walk through chunks of a PNG file up to image data and fill an entry.
+ *  \param f: pointer to open file.
+ *  \param e: target entry.
+ *  \returns LV_RES_OK if successful, LV_RES_INV if file isn't a valid PNG image.
+ */
+static lv_res_t manifest_scan(lv_fs_file_t * f, manifest_entry_t * e) {
+    const uint8_t magic[] = {0x89, 0x50, 0x4e, 0x47, 0x0d, 0x0a, 0x1a, 0x0a};
+    uint8_t buf[13];
+    uint32_t rb;
+    uint32_t pos = 8;
+    bool has_ihdr = false;
+    if (lv_fs_read(f, buf, 8, &rb) != LV_FS_RES_OK || rb != 8 || memcmp(buf, magic, 8)) return LV_RES_INV;
+
+    // chunk structure: length (4 bytes) | chunk type (4 bytes) | chunk data (length) | CRC (4 bytes)
+    while (lv_fs_seek(f, pos, LV_FS_SEEK_SET) == LV_FS_RES_OK &&
+           lv_fs_read(f, buf, 8, &rb) == LV_FS_RES_OK && rb == 8) {
+        uint32_t len = manifest_be32(buf);
+        // chunk data is read into buf as well
+        bool is_hdr = !memcmp(buf + 4, "IHDR", 4) || !memcmp(buf + 4, "PLTE", 4) || !memcmp(buf + 4, "tRNS", 4);
+        if (!memcmp(buf + 4, "IDAT", 4)) {
+            e->idat_offset = pos;
+            return has_ihdr ? LV_RES_OK : LV_RES_INV;
+        }
+        if (!memcmp(buf + 4, "IHDR", 4)) {
+            if (len != 13 || lv_fs_read(f, buf, 13, &rb) != LV_FS_RES_OK || rb != 13) return LV_RES_INV;
+            e->w = manifest_be32(buf);
+            e->h = manifest_be32(buf + 4);
+            e->depth = buf[8];
+            e->color_type = buf[9];
+            if (e->color_type & 4) e->flags |= MANIFEST_FLAG_ALPHA;
+            if (buf[12]) e->flags |= MANIFEST_FLAG_INTERLACED;
+            has_ihdr = true;
+        }
+        if (!memcmp(buf + 4, "tRNS", 4)) e->flags |= MANIFEST_FLAG_ALPHA;
+        // a corrupt length would wrap the position around
+        if (len > UINT32_MAX - 12 - pos) return LV_RES_INV;
+        pos += len + 12;
+        if (is_hdr) e->hdr_end = pos;
+    }
+    return LV_RES_INV;
+}
+
+/** \brief Add a PNG file to a manifest being built.
+ *  \param b: pointer to build state.
+ *  \param fn: file path.
+ */
+static void manifest_add_file(manifest_build_t * b, const char * fn) {
+    lv_fs_file_t f;
+    if (lv_fs_open(&f, fn, LV_FS_MODE_RD) != LV_FS_RES_OK) return;
+    size_t len = strlen(fn);
+    if (len > UINT8_MAX) {
+        LV_LOG_WARN("%s has too long a path, skipped.\n", fn);
+        lv_fs_close(&f);
+        return;
+    }
+    manifest_entry_t e;
+    memset(&e, 0, sizeof(e));
+    e.hash = manifest_hash(fn);
+    lv_res_t res = manifest_scan(&f, &e);
+    if (res == LV_RES_OK && (lv_fs_seek(&f, 0, LV_FS_SEEK_END) != LV_FS_RES_OK ||
+                             lv_fs_tell(&f, &e.file_size) != LV_FS_RES_OK)) res = LV_RES_INV;
+    lv_fs_close(&f);
+    if (res != LV_RES_OK) {
+        LV_LOG_WARN("%s isn't a valid PNG file, skipped.\n", fn);
+        return;
+    }
+
+    if (b->n == b->size) {
+        uint32_t size = b->size ? b->size*2 : 32;
+        manifest_entry_t * entries = (manifest_entry_t*)PNGLE_MALLOC(size*sizeof(manifest_entry_t));
+        if (entries == NULL) return;
+        if (b->entries != NULL) {
+            memcpy(entries, b->entries, b->n*sizeof(manifest_entry_t));
+            PNGLE_FREE(b->entries);
+        }
+        b->entries = entries;
+        b->size = size;
+    }
+    if (b->names_len + len > b->names_size) {
+        uint32_t size = b->names_size ? b->names_size*2 : 1024;
+        while (size < b->names_len + len) size *= 2;
+        char * names = (char*)PNGLE_MALLOC(size);
+        if (names == NULL) return;
+        if (b->names != NULL) {
+            memcpy(names, b->names, b->names_len);
+            PNGLE_FREE(b->names);
+        }
+        b->names = names;
+        b->names_size = size;
+    }
+    memcpy(b->names + b->names_len, fn, len);
+    e.name_ofs = b->names_len;
+    e.name_len = (uint8_t)len;
+    b->names_len += len;
+    // just read from the file
+    e.flags |= MANIFEST_FLAG_CHECKED;
+
+    // insertion keeps entries sorted by hash
+    uint32_t i = b->n++;
+    while (i > 0 && b->entries[i - 1].hash > e.hash) {
+        b->entries[i] = b->entries[i - 1];
+        i--;
+    }
+    b->entries[i] = e;
+}
+
+/** \brief Add PNG files of a directory and its subdirectories to a manifest being built.
+ *  \param b: pointer to build state.
+ *  \param dir: directory path, with drive letter.
+ *  \param depth: remaining subdirectory levels.
+ */
+static void manifest_add_dir(manifest_build_t * b, const char * dir, uint8_t depth) {
+    lv_fs_dir_t d;
+    if (lv_fs_dir_open(&d, dir) != LV_FS_RES_OK) {
+        LV_LOG_WARN("couldn't open directory: %s\n", dir);
+        return;
+    }
+    char name[256];
+    char path[256];
+    size_t dir_len = strlen(dir);
+    bool sep = dir_len > 0 && dir[dir_len - 1] != '/' && dir[dir_len - 1] != ':';
+#if LV_PNGLE_USE_LVGL_V9
+    while (lv_fs_dir_read(&d, name, sizeof(name)) == LV_FS_RES_OK && name[0] != '\0') {
+#else
+    while (lv_fs_dir_read(&d, name) == LV_FS_RES_OK && name[0] != '\0') {
+#endif
+        // directory names start with '/'
+        bool is_dir = name[0] == '/';
+        const char * n = is_dir ? name + 1 : name;
+        if (is_dir && (!strcmp(n, ".") || !strcmp(n, ".."))) continue;
+        if (dir_len + 1 + strlen(n) >= sizeof(path)) continue;
+        memcpy(path, dir, dir_len);
+        if (sep) path[dir_len] = '/';
+        strcpy(path + dir_len + sep, n);
+        if (is_dir) {
+            if (depth > 0) manifest_add_dir(b, path, depth - 1);
+        } else {
+            const char * ext = lv_fs_get_ext(path);
+            if (ext != NULL && (!strcmp(ext, "png") || !strcmp(ext, "PNG"))) manifest_add_file(b, path);
+        }
+    }
+    lv_fs_dir_close(&d);
+}
+
+
+bool lv_pngle_manifest_build(const char * dir, const char * fn) {
+    manifest_build_t b;
+    memset(&b, 0, sizeof(b));
+    manifest_add_dir(&b, dir, LV_PNGLE_MANIFEST_MAX_DEPTH);
+    LV_LOG_INFO("writing manifest of %d PNG files to: %s\n", b.n, fn);
+
+    lv_fs_file_t f;
+    if (lv_fs_open(&f, fn, LV_FS_MODE_WR) != LV_FS_RES_OK) {
+        LV_LOG_ERROR("couldn't write manifest file: %s\n", fn);
+        if (b.entries != NULL) PNGLE_FREE(b.entries);
+        if (b.names != NULL) PNGLE_FREE(b.names);
+        return false;
+    }
+    uint8_t buf[MANIFEST_ENTRY_SIZE];
+    uint32_t bw;
+    bool ok = true;
+    memcpy(buf, "LVPM", 4);
+    buf[4] = MANIFEST_VERSION & 0xff;
+    buf[5] = MANIFEST_VERSION >> 8;
+    buf[6] = buf[7] = 0;
+    manifest_put_le32(buf + 8, b.n);
+    manifest_put_le32(buf + 12, b.names_len);
+    if (lv_fs_write(&f, buf, MANIFEST_HDR_SIZE, &bw) != LV_FS_RES_OK || bw != MANIFEST_HDR_SIZE) ok = false;
+    for (uint32_t i = 0; ok && i < b.n; i++) {
+        const manifest_entry_t * e = &b.entries[i];
+        manifest_put_le32(buf, e->hash);
+        manifest_put_le32(buf + 4, e->name_ofs);
+        manifest_put_le32(buf + 8, e->file_size);
+        manifest_put_le32(buf + 12, e->w);
+        manifest_put_le32(buf + 16, e->h);
+        manifest_put_le32(buf + 20, e->idat_offset);
+        manifest_put_le32(buf + 24, e->hdr_end);
+        buf[28] = e->depth;
+        buf[29] = e->color_type;
+        buf[30] = e->flags & ~MANIFEST_MEM_FLAGS;
+        buf[31] = e->name_len;
+        if (lv_fs_write(&f, buf, MANIFEST_ENTRY_SIZE, &bw) != LV_FS_RES_OK || bw != MANIFEST_ENTRY_SIZE) ok = false;
+    }
+    if (ok && b.names_len > 0 && (lv_fs_write(&f, b.names, b.names_len, &bw) != LV_FS_RES_OK || bw != b.names_len)) ok = false;
+    lv_fs_close(&f);
+    if (!ok) LV_LOG_ERROR("couldn't write manifest file: %s\n", fn);
+
+    // use the new manifest right away
+    if (ok) {
+        lv_pngle_manifest_unload();
+        manifest.entries = b.entries;
+        manifest.n = b.n;
+        manifest.names = b.names;
+    } else {
+        if (b.entries != NULL) PNGLE_FREE(b.entries);
+        if (b.names != NULL) PNGLE_FREE(b.names);
+    }
+    return ok;
+}
+
+
+bool lv_pngle_manifest_load(const char * fn) {
+    lv_fs_file_t f;
+    uint8_t buf[MANIFEST_ENTRY_SIZE];
+    uint32_t rb;
+    if (lv_fs_open(&f, fn, LV_FS_MODE_RD) != LV_FS_RES_OK) {
+        LV_LOG_WARN("couldn't open manifest file: %s\n", fn);
+        return false;
+    }
+    if (lv_fs_read(&f, buf, MANIFEST_HDR_SIZE, &rb) != LV_FS_RES_OK || rb != MANIFEST_HDR_SIZE ||
+        memcmp(buf, "LVPM", 4) || (buf[4] | (buf[5] << 8)) != MANIFEST_VERSION) {
+        LV_LOG_WARN("invalid manifest file (or written by another version): %s\n", fn);
+        lv_fs_close(&f);
+        return false;
+    }
+    uint32_t n = manifest_le32(buf + 8);
+    uint32_t names_len = manifest_le32(buf + 12);
+    // counts are checked against the file size before anything is allocated from them
+    uint32_t file_size = 0;
+    if (lv_fs_seek(&f, 0, LV_FS_SEEK_END) != LV_FS_RES_OK || lv_fs_tell(&f, &file_size) != LV_FS_RES_OK ||
+        lv_fs_seek(&f, MANIFEST_HDR_SIZE, LV_FS_SEEK_SET) != LV_FS_RES_OK) {
+        lv_fs_close(&f);
+        return false;
+    }
+    uint32_t index_size = file_size > MANIFEST_HDR_SIZE ? file_size - MANIFEST_HDR_SIZE : 0;
+    if (n > index_size/MANIFEST_ENTRY_SIZE || n > UINT32_MAX/sizeof(manifest_entry_t) ||
+        names_len > index_size - n*MANIFEST_ENTRY_SIZE) {
+        LV_LOG_WARN("invalid manifest file: %s\n", fn);
+        lv_fs_close(&f);
+        return false;
+    }
+    manifest_entry_t * entries = n ? (manifest_entry_t*)PNGLE_MALLOC(n*sizeof(manifest_entry_t)) : NULL;
+    char * names = names_len ? (char*)PNGLE_MALLOC(names_len) : NULL;
+    if ((n && entries == NULL) || (names_len && names == NULL)) {
+        if (entries != NULL) PNGLE_FREE(entries);
+        if (names != NULL) PNGLE_FREE(names);
+        lv_fs_close(&f);
+        return false;
+    }
+    for (uint32_t i = 0; i < n; i++) {
+        if (lv_fs_read(&f, buf, MANIFEST_ENTRY_SIZE, &rb) != LV_FS_RES_OK || rb != MANIFEST_ENTRY_SIZE) {
+            LV_LOG_WARN("truncated manifest file: %s\n", fn);
+            n = i;
+            break;
+        }
+        manifest_entry_t * e = &entries[i];
+        e->hash = manifest_le32(buf);
+        e->name_ofs = manifest_le32(buf + 4);
+        e->file_size = manifest_le32(buf + 8);
+        e->w = manifest_le32(buf + 12);
+        e->h = manifest_le32(buf + 16);
+        e->idat_offset = manifest_le32(buf + 20);
+        e->hdr_end = manifest_le32(buf + 24);
+        e->depth = buf[28];
+        e->color_type = buf[29];
+        e->flags = buf[30] & ~MANIFEST_MEM_FLAGS;
+        e->name_len = buf[31];
+        // entries whose path is out of bounds never match
+        if (e->name_ofs > names_len || e->name_len > names_len - e->name_ofs) e->flags |= MANIFEST_FLAG_STALE;
+    }
+    if (names_len && (lv_fs_read(&f, names, names_len, &rb) != LV_FS_RES_OK || rb != names_len)) {
+        LV_LOG_WARN("truncated manifest file: %s\n", fn);
+        n = 0;
+    }
+    lv_fs_close(&f);
+
+    lv_pngle_manifest_unload();
+    manifest.entries = entries;
+    manifest.n = n;
+    manifest.names = names;
+    LV_LOG_INFO("loaded manifest of %d PNG files.\n", n);
+    return true;
+}
+
+
+void lv_pngle_manifest_unload(void) {
+    if (manifest.entries != NULL) PNGLE_FREE(manifest.entries);
+    if (manifest.names != NULL) PNGLE_FREE(manifest.names);
+    manifest.entries = NULL;
+    manifest.n = 0;
+    manifest.names = NULL;
+}
+
+
+lv_res_t _lv_pngle_manifest_get_size(const char * fn, uint32_t * w, uint32_t * h) {
+    manifest_entry_t * e = manifest_find(fn);
+    if (e == NULL || manifest_check(fn, e, 0) != LV_RES_OK) return LV_RES_INV;
+    *w = e->w;
+    *h = e->h;
+    return LV_RES_OK;
+}
+
+
+lv_res_t _lv_pngle_manifest_get_offsets(const char * fn, uint32_t file_size, uint32_t * hdr_end, uint32_t * idat_offset) {
+    manifest_entry_t * e = manifest_find(fn);
+    if (e == NULL || manifest_check(fn, e, file_size) != LV_RES_OK) return LV_RES_INV;
+    *hdr_end = e->hdr_end;
+    *idat_offset = e->idat_offset;
+    return LV_RES_OK;
+}
+
+
+void _lv_pngle_manifest_forget(const char * fn) {
+    manifest_entry_t * e = manifest_find(fn);
+    if (e != NULL) e->flags |= MANIFEST_FLAG_STALE;
+}
+
+#endif
@@ -0,0 +1,258 @@
+/** \file lv_pngle_mipmap.c
+ *  \brief Mip chain generation for PNG images displayed with zoom.
+ *
+ *  Author: Vincent Paeder
+ *  License: MIT
+ */
+#include "lv_pngle_private.h"
+
+#if LV_PNGLE_USE_MIPMAP
+
+/** \brief A PNG image decoded together with versions of it downscaled by 2, 4, ... */
+struct _lv_pngle_mipmap_t {
+    /** \brief Number of levels, full size image included. */
+    uint8_t n_levels;
+
+#if LV_PNGLE_USE_LVGL_V9
+    /** \brief Image buffers, from full size to smallest. */
+    lv_draw_buf_t * levels[LV_PNGLE_MIPMAP_MAX_LEVELS + 1];
+#else
+    /** \brief Image descriptors, from full size to smallest. */
+    lv_img_dsc_t levels[LV_PNGLE_MIPMAP_MAX_LEVELS + 1];
+#endif
+};
+
+/** \brief State used while generating a mip chain. */
+typedef struct _lv_pngle_mip_build_t {
+    /** \brief Number of levels, full size image included. */
+    uint8_t n_levels;
+
+    /** \brief Width of each level. */
+    uint32_t w[LV_PNGLE_MIPMAP_MAX_LEVELS + 1];
+
+    /** \brief Height of each level. */
+    uint32_t h[LV_PNGLE_MIPMAP_MAX_LEVELS + 1];
+
+    /** \brief Color data of each level. */
+    uint8_t * data[LV_PNGLE_MIPMAP_MAX_LEVELS + 1];
+
+    /** \brief Number of bytes between two rows of color data of each level. */
+    uint32_t stride[LV_PNGLE_MIPMAP_MAX_LEVELS + 1];
+
+    /** \brief Alpha plane of each level (planar color formats only). */
+    uint8_t * alpha[LV_PNGLE_MIPMAP_MAX_LEVELS + 1];
+
+    /** \brief Number of bytes between two rows of alpha plane of each level. */
+    uint32_t alpha_stride[LV_PNGLE_MIPMAP_MAX_LEVELS + 1];
+
+    /** \brief Sums of alpha-weighted color and of alpha for the row being built, for each level but the first. */
+    uint32_t * acc[LV_PNGLE_MIPMAP_MAX_LEVELS + 1];
+} lv_pngle_mip_build_t;
+
+
+/** \brief Add a pixel of a level to the 2x2 box it falls in on the next level.
+ *
+ *  Once the last pixel of a row pair has been added, the row of the next level
+ *  is converted and its pixels are passed down the chain.
+ *
+ *  \param b: pointer to build state.
+ *  \param k: index of the level receiving the pixel (pixel belongs to level k-1).
+ *  \param x: horizontal coordinate of pixel in level k-1.
+ *  \param y: vertical coordinate of pixel in level k-1.
+ *  \param rgba: pointer to pixel value.
+ */
+static void mip_push(lv_pngle_mip_build_t * b, uint8_t k, uint32_t x, uint32_t y, const uint8_t * rgba) {
+    if (k >= b->n_levels) return;
+    uint32_t * acc = b->acc[k] + (x >> 1)*4;
+    // weight color by alpha so that transparent pixels don't darken edges
+    acc[0] += rgba[0]*rgba[3];
+    acc[1] += rgba[1]*rgba[3];
+    acc[2] += rgba[2]*rgba[3];
+    acc[3] += rgba[3];
+
+    uint32_t pw = b->w[k-1];
+    uint32_t ph = b->h[k-1];
+    if (x + 1 < pw || (!(y & 1) && y + 1 < ph)) return;
+
+    // row of level k is complete
+    uint32_t oy = y >> 1;
+    uint32_t rows = (y & 1) ? 2 : 1;
+    for (uint32_t ox = 0; ox < b->w[k]; ox++) {
+        uint32_t n = rows*((2*ox + 1 < pw) ? 2 : 1);
+        uint32_t * a = b->acc[k] + ox*4;
+        uint8_t px[4];
+        px[3] = (a[3] + n/2)/n;
+        for (uint8_t c = 0; c < 3; c++) px[c] = a[3] ? (a[c] + a[3]/2)/a[3] : 0;
+        memset(a, 0, 4*sizeof(uint32_t));
+        _lv_pngle_convert_pixel(b->data[k] + oy*b->stride[k] + ox*PNGLE_COLOR_SIZE,
+                                b->alpha[k] ? b->alpha[k] + oy*b->alpha_stride[k] + ox : NULL, px);
+        mip_push(b, k + 1, ox, oy, px);
+    }
+}
+
+/** \brief Function called with each pixel of the full size image while it's decoded.
+ *  \param ud: pointer to the data structure shared with Pngle.
+ *  \param x: horizontal coordinate of pixel.
+ *  \param y: vertical coordinate of pixel.
+ *  \param rgba: pointer to pixel value.
+ */
+static void mip_px_cb(lv_pngle_data_t * ud, uint32_t x, uint32_t y, const uint8_t * rgba) {
+    // pixels of interlaced images don't arrive in row order: levels are built after decoding
+    if (ud->interlaced) return;
+    mip_push((lv_pngle_mip_build_t*)ud->user_data, 1, x, y, rgba);
+}
+
+/** \brief Allocate the buffer of a level.
+ *  \param mm: pointer to mip chain.
+ *  \param b: pointer to build state.
+ *  \param k: level index.
+ *  \returns LV_RES_OK if successful, LV_RES_INV if failed.
+ */
+static lv_res_t mip_alloc_level(lv_pngle_mipmap_t * mm, lv_pngle_mip_build_t * b, uint8_t k) {
+#if LV_PNGLE_USE_LVGL_V9
+    lv_draw_buf_t * buf = lv_draw_buf_create(b->w[k], b->h[k], PNGLE_CF, LV_STRIDE_AUTO);
+    if (buf == NULL) return LV_RES_INV;
+    mm->levels[k] = buf;
+    b->data[k] = buf->data;
+    b->stride[k] = buf->header.stride;
+#if PNGLE_PLANAR_ALPHA
+    // alpha plane follows color plane, with half its stride
+    b->alpha[k] = buf->data + b->stride[k]*b->h[k];
+    b->alpha_stride[k] = b->stride[k]/2;
+#endif
+#else
+    uint32_t size = b->w[k]*b->h[k]*PNGLE_PX_SIZE;
+    uint8_t * data = (uint8_t*)PNGLE_MALLOC(size);
+    if (data == NULL) return LV_RES_INV;
+    memset(data, 0, size);
+    lv_img_dsc_t * dsc = &mm->levels[k];
+    dsc->header.always_zero = 0;
+    dsc->header.cf = LV_IMG_CF_TRUE_COLOR_ALPHA;
+    dsc->header.w = b->w[k];
+    dsc->header.h = b->h[k];
+    dsc->data_size = size;
+    dsc->data = data;
+    b->data[k] = data;
+    b->stride[k] = b->w[k]*PNGLE_PX_SIZE;
+#endif
+    return LV_RES_OK;
+}
+
+
+lv_pngle_mipmap_t * lv_pngle_mipmap_create(const void * src, uint8_t levels) {
+    lv_pngle_input_t in;
+    uint32_t w, h;
+    if (_lv_pngle_get_src(src, &in) != LV_RES_OK) return NULL;
+    if (_lv_pngle_read_header(&in, &w, &h) != LV_RES_OK) return NULL;
+
+    lv_pngle_mipmap_t * mm = (lv_pngle_mipmap_t*)PNGLE_MALLOC(sizeof(lv_pngle_mipmap_t));
+    if (mm == NULL) return NULL;
+    memset(mm, 0, sizeof(lv_pngle_mipmap_t));
+
+    lv_pngle_mip_build_t b;
+    memset(&b, 0, sizeof(b));
+    if (levels > LV_PNGLE_MIPMAP_MAX_LEVELS) levels = LV_PNGLE_MIPMAP_MAX_LEVELS;
+    b.w[0] = w;
+    b.h[0] = h;
+    b.n_levels = 1;
+    while (b.n_levels <= levels && (b.w[b.n_levels - 1] > 1 || b.h[b.n_levels - 1] > 1)) {
+        b.w[b.n_levels] = (b.w[b.n_levels - 1] + 1)/2;
+        b.h[b.n_levels] = (b.h[b.n_levels - 1] + 1)/2;
+        b.n_levels++;
+    }
+    mm->n_levels = b.n_levels;
+
+    bool failed = false;
+    for (uint8_t k = 0; k < b.n_levels && !failed; k++) {
+        if (mip_alloc_level(mm, &b, k) != LV_RES_OK) failed = true;
+        if (k > 0) {
+            b.acc[k] = (uint32_t*)PNGLE_MALLOC(b.w[k]*4*sizeof(uint32_t));
+            if (b.acc[k] == NULL) failed = true;
+            else memset(b.acc[k], 0, b.w[k]*4*sizeof(uint32_t));
+        }
+    }
+    LV_LOG_INFO("generating %d downscaled levels for %d x %d image\n", b.n_levels - 1, w, h);
+
+    if (!failed) {
+        lv_pngle_data_t ud;
+        _lv_pngle_data_init(&ud, w, h);
+        ud.data = b.data[0];
+        ud.stride = b.stride[0];
+        ud.alpha = b.alpha[0];
+        ud.alpha_stride = b.alpha_stride[0];
+        ud.px_cb = mip_px_cb;
+        ud.user_data = &b;
+        if (_lv_pngle_decode(&in, &ud) != LV_RES_OK) {
+            LV_LOG_ERROR("PNG decoding failed.\n");
+            failed = true;
+        } else if (ud.interlaced) {
+            // read full size image back to build the other levels
+            uint8_t rgba[4];
+            for (uint32_t y = 0; y < h; y++) {
+                for (uint32_t x = 0; x < w; x++) {
+                    _lv_pngle_unpack_pixel(b.data[0] + y*b.stride[0] + x*PNGLE_COLOR_SIZE,
+                                           b.alpha[0] ? b.alpha[0] + y*b.alpha_stride[0] + x : NULL, rgba);
+                    mip_push(&b, 1, x, y, rgba);
+                }
+            }
+        }
+    }
+
+    for (uint8_t k = 1; k < b.n_levels; k++) {
+        if (b.acc[k] != NULL) PNGLE_FREE(b.acc[k]);
+    }
+    if (failed) {
+        lv_pngle_mipmap_delete(mm);
+        return NULL;
+    }
+    return mm;
+}
+
+
+void lv_pngle_mipmap_delete(lv_pngle_mipmap_t * mm) {
+    for (uint8_t k = 0; k < mm->n_levels; k++) {
+#if LV_PNGLE_USE_LVGL_V9
+        if (mm->levels[k] != NULL) lv_draw_buf_destroy(mm->levels[k]);
+#else
+        if (mm->levels[k].data != NULL) PNGLE_FREE((uint8_t*)mm->levels[k].data);
+#endif
+    }
+    PNGLE_FREE(mm);
+}
+
+
+uint8_t lv_pngle_mipmap_get_level_count(const lv_pngle_mipmap_t * mm) {
+    return mm->n_levels;
+}
+
+
+uint8_t lv_pngle_mipmap_select_level(const lv_pngle_mipmap_t * mm, uint32_t zoom) {
+    uint8_t level = 0;
+    while (level + 1 < mm->n_levels && (zoom << (level + 1)) <= PNGLE_ZOOM_NONE) level++;
+    return level;
+}
+
+
+const void * lv_pngle_mipmap_get_src(const lv_pngle_mipmap_t * mm, uint8_t level) {
+    if (level >= mm->n_levels) return NULL;
+#if LV_PNGLE_USE_LVGL_V9
+    return mm->levels[level];
+#else
+    return &mm->levels[level];
+#endif
+}
+
+
+void lv_pngle_mipmap_set_zoom(lv_obj_t * img, const lv_pngle_mipmap_t * mm, uint32_t zoom) {
+    uint8_t level = lv_pngle_mipmap_select_level(mm, zoom);
+    const void * src = lv_pngle_mipmap_get_src(mm, level);
+#if LV_PNGLE_USE_LVGL_V9
+    if (lv_image_get_src(img) != src) lv_image_set_src(img, src);
+    lv_image_set_scale(img, zoom << level);
+#else
+    if (lv_img_get_src(img) != src) lv_img_set_src(img, src);
+    lv_img_set_zoom(img, (uint16_t)(zoom << level));
+#endif
+}
+
+#endif
@@ -0,0 +1,496 @@
+/** \file lv_pngle_ninepatch.c
+ *  \brief Nine-patch (stretchable) PNG images stored as compact tiles.
+ *
+ *  Author: Vincent Paeder
+ *  License: MIT
+ */
+#include "lv_pngle_private.h"
+
+#if LV_PNGLE_USE_NINEPATCH
+
+#if LV_PNGLE_USE_LVGL_V9
+typedef lv_image_dsc_t np_tile_t; ///< Image descriptor of a tile
+#else
+typedef lv_img_dsc_t np_tile_t; ///< Image descriptor of a tile
+#endif
+
+/** \brief A run of fixed or stretchable rows or columns. */
+typedef struct _np_seg_t {
+    /** \brief First row or column of the run in the image (border markers excluded). */
+    uint16_t start;
+
+    /** \brief Number of rows or columns in the run. */
+    uint16_t len;
+
+    /** \brief First row or column of the run in the compact image. */
+    uint16_t cstart;
+
+    /** \brief If true, the run is stretchable and only its first row or column is kept. */
+    bool stretch;
+} np_seg_t;
+
+/** \brief A stretchable image stored as its fixed tiles plus one row or column per stretchable area. */
+struct _lv_pngle_ninepatch_t {
+    /** \brief Number of column runs. */
+    uint8_t n_cols;
+
+    /** \brief Number of row runs. */
+    uint8_t n_rows;
+
+    /** \brief Column runs. */
+    np_seg_t cols[LV_PNGLE_NINEPATCH_MAX_SEGS];
+
+    /** \brief Row runs. */
+    np_seg_t rows[LV_PNGLE_NINEPATCH_MAX_SEGS];
+
+    /** \brief Content padding (left, top, right, bottom). */
+    lv_area_t pad;
+
+    /** \brief Tile descriptors, row by row. */
+    np_tile_t * tiles;
+
+    /** \brief Pixel data of all tiles. */
+    uint8_t * data;
+};
+
+/** \brief State used while decoding a nine-patch image. */
+typedef struct _np_build_t {
+    /** \brief Nine-patch image being built. */
+    lv_pngle_ninepatch_t * np;
+
+    /** \brief Width of border holding markers (1, or 0 when insets are given). */
+    uint8_t border;
+
+    /** \brief Fixed border sizes (used when there are no border markers). */
+    lv_pngle_ninepatch_insets_t insets;
+
+    /** \brief Image width, border included. */
+    uint32_t w;
+
+    /** \brief Image height, border included. */
+    uint32_t h;
+
+    /** \brief Column in compact image for each image column. */
+    uint16_t * col_map;
+
+    /** \brief For each image column, true if its pixels are stored, false if they're compared with a stored one. */
+    uint8_t * col_store;
+
+    /** \brief If true, pixels of current row are stored, otherwise they're compared with a stored row. */
+    bool row_store;
+
+    /** \brief Width of compact image. */
+    uint32_t cw;
+
+    /** \brief Number of rows stored in compact image. */
+    uint32_t ch;
+
+    /** \brief Compact image, as RGBA values. */
+    uint8_t * compact;
+
+    /** \brief First and last columns marked for content on bottom border (-1 if none). */
+    int32_t pad_x[2];
+
+    /** \brief First and last rows marked for content on right border (-1 if none). */
+    int32_t pad_y[2];
+
+    /** \brief If false, some stretchable area isn't uniform. */
+    bool uniform;
+
+    /** \brief If true, decoding failed. */
+    bool failed;
+} np_build_t;
+
+
+/** \brief Build column runs from stretchable column flags, held in col_store.
+ *  \param b: pointer to build state.
+ *  \returns LV_RES_OK if successful, LV_RES_INV if there are too many runs.
+ */
+static lv_res_t np_build_cols(np_build_t * b) {
+    lv_pngle_ninepatch_t * np = b->np;
+    uint32_t iw = b->w - 2*b->border;
+    np->n_cols = 0;
+    b->cw = 0;
+    for (uint32_t ix = 0; ix < iw; ix++) {
+        // col_store holds stretch flags on input and is overwritten in place
+        bool stretch = b->col_store[ix] != 0;
+        np_seg_t * seg = np->n_cols ? &np->cols[np->n_cols - 1] : NULL;
+        if (seg == NULL || seg->stretch != stretch) {
+            if (np->n_cols == LV_PNGLE_NINEPATCH_MAX_SEGS) {
+                LV_LOG_ERROR("too many nine-patch column runs.\n");
+                return LV_RES_INV;
+            }
+            seg = &np->cols[np->n_cols++];
+            seg->start = ix;
+            seg->len = 0;
+            seg->cstart = b->cw;
+            seg->stretch = stretch;
+            if (stretch) b->cw++;
+        }
+        b->col_map[ix] = stretch ? seg->cstart : b->cw++;
+        b->col_store[ix] = !stretch || seg->len == 0;
+        seg->len++;
+    }
+    b->compact = (uint8_t*)PNGLE_MALLOC(b->cw*4*(b->h - 2*b->border));
+    return b->compact != NULL ? LV_RES_OK : LV_RES_INV;
+}
+
+/** \brief Start a new image row.
+ *  \param b: pointer to build state.
+ *  \param iy: row index (border markers excluded).
+ *  \param stretch: true if row is stretchable.
+ */
+static void np_begin_row(np_build_t * b, uint32_t iy, bool stretch) {
+    lv_pngle_ninepatch_t * np = b->np;
+    np_seg_t * seg = np->n_rows ? &np->rows[np->n_rows - 1] : NULL;
+    if (seg == NULL || seg->stretch != stretch) {
+        if (np->n_rows == LV_PNGLE_NINEPATCH_MAX_SEGS) {
+            LV_LOG_ERROR("too many nine-patch row runs.\n");
+            b->failed = true;
+            return;
+        }
+        seg = &np->rows[np->n_rows++];
+        seg->start = iy;
+        seg->len = 0;
+        seg->cstart = b->ch++;
+        seg->stretch = stretch;
+        b->row_store = true;
+    } else if (stretch) {
+        b->row_store = false;
+    } else {
+        b->ch++;
+        b->row_store = true;
+    }
+    seg->len++;
+}
+
+/** \brief Record a content marker.
+ *  \param pad: first and last marked positions.
+ *  \param pos: marked position.
+ */
+static void np_mark_pad(int32_t * pad, int32_t pos) {
+    if (pad[0] < 0) pad[0] = pos;
+    pad[1] = pos;
+}
+
+/** \brief Function called with each pixel while the image is decoded.
+ *  \param ud: pointer to the data structure shared with Pngle.
+ *  \param x: horizontal coordinate of pixel.
+ *  \param y: vertical coordinate of pixel.
+ *  \param rgba: pointer to pixel value.
+ */
+static void np_px_cb(lv_pngle_data_t * ud, uint32_t x, uint32_t y, const uint8_t * rgba) {
+    np_build_t * b = (np_build_t*)ud->user_data;
+    if (b->failed) return;
+    if (ud->interlaced) {
+        LV_LOG_ERROR("interlaced nine-patch images aren't supported.\n");
+        b->failed = true;
+        return;
+    }
+
+    if (b->border) {
+        bool marker = rgba[3] == 0xff && !(rgba[0] | rgba[1] | rgba[2]);
+        bool x_edge = x == 0 || x + 1 == b->w;
+        if (y == 0) {
+            // top border: stretchable columns
+            if (!x_edge) b->col_store[x - 1] = marker;
+            else if (x > 0 && np_build_cols(b) != LV_RES_OK) b->failed = true;
+            return;
+        }
+        if (y + 1 == b->h) {
+            // bottom border: content columns
+            if (!x_edge && marker) np_mark_pad(b->pad_x, x - 1);
+            return;
+        }
+        if (x == 0) {
+            // left border: stretchable rows
+            np_begin_row(b, y - 1, marker);
+            return;
+        }
+        if (x + 1 == b->w) {
+            // right border: content rows
+            if (marker) np_mark_pad(b->pad_y, y - 1);
+            return;
+        }
+    } else if (x == 0) {
+        np_begin_row(b, y, y >= b->insets.top && y + b->insets.bottom < b->h);
+    }
+    if (b->failed) return;
+
+    uint32_t ix = x - b->border;
+    uint8_t * dst = b->compact + ((b->ch - 1)*b->cw + b->col_map[ix])*4;
+    if (b->row_store && b->col_store[ix]) memcpy(dst, rgba, 4);
+    else if (memcmp(dst, rgba, 4)) b->uniform = false;
+}
+
+/** \brief Convert compact image to tiles.
+ *  \param b: pointer to build state.
+ *  \returns LV_RES_OK if successful, LV_RES_INV if failed.
+ */
+static lv_res_t np_build_tiles(np_build_t * b) {
+    lv_pngle_ninepatch_t * np = b->np;
+    uint32_t total = 0;
+    for (uint8_t i = 0; i < np->n_rows; i++) {
+        for (uint8_t j = 0; j < np->n_cols; j++) {
+            uint32_t tw = np->cols[j].stretch ? 1 : np->cols[j].len;
+            uint32_t th = np->rows[i].stretch ? 1 : np->rows[i].len;
+            total += tw*th*PNGLE_PX_SIZE;
+        }
+    }
+    LV_LOG_INFO("allocating memory for nine-patch tiles: %d bytes\n", total);
+    np->tiles = (np_tile_t*)PNGLE_MALLOC(np->n_rows*np->n_cols*sizeof(np_tile_t));
+    np->data = (uint8_t*)PNGLE_MALLOC(total);
+    if (np->tiles == NULL || np->data == NULL) return LV_RES_INV;
+    memset(np->tiles, 0, np->n_rows*np->n_cols*sizeof(np_tile_t));
+
+    uint8_t * t = np->data;
+    for (uint8_t i = 0; i < np->n_rows; i++) {
+        for (uint8_t j = 0; j < np->n_cols; j++) {
+            uint32_t tw = np->cols[j].stretch ? 1 : np->cols[j].len;
+            uint32_t th = np->rows[i].stretch ? 1 : np->rows[i].len;
+            for (uint32_t ty = 0; ty < th; ty++) {
+                for (uint32_t tx = 0; tx < tw; tx++) {
+                    const uint8_t * rgba = b->compact + ((np->rows[i].cstart + ty)*b->cw + np->cols[j].cstart + tx)*4;
+                    _lv_pngle_convert_pixel(t + (ty*tw + tx)*PNGLE_COLOR_SIZE,
+                                            PNGLE_PLANAR_ALPHA ? t + tw*th*PNGLE_COLOR_SIZE + ty*tw + tx : NULL, rgba);
+                }
+            }
+            np_tile_t * tile = &np->tiles[i*np->n_cols + j];
+#if LV_PNGLE_USE_LVGL_V9
+            tile->header.magic = LV_IMAGE_HEADER_MAGIC;
+            tile->header.cf = PNGLE_CF;
+            tile->header.stride = tw*PNGLE_COLOR_SIZE;
+#else
+            tile->header.always_zero = 0;
+            tile->header.cf = LV_IMG_CF_TRUE_COLOR_ALPHA;
+#endif
+            tile->header.w = tw;
+            tile->header.h = th;
+            tile->data_size = tw*th*PNGLE_PX_SIZE;
+            tile->data = t;
+            t += tile->data_size;
+        }
+    }
+    return LV_RES_OK;
+}
+
+
+lv_pngle_ninepatch_t * lv_pngle_ninepatch_create(const void * src, const lv_pngle_ninepatch_insets_t * insets) {
+    lv_pngle_input_t in;
+    uint32_t w, h;
+    if (_lv_pngle_get_src(src, &in) != LV_RES_OK) return NULL;
+    if (_lv_pngle_read_header(&in, &w, &h) != LV_RES_OK) return NULL;
+
+    np_build_t b;
+    memset(&b, 0, sizeof(b));
+    b.border = insets == NULL ? 1 : 0;
+    b.w = w;
+    b.h = h;
+    b.pad_x[0] = b.pad_x[1] = b.pad_y[0] = b.pad_y[1] = -1;
+    b.uniform = true;
+    if (insets != NULL) b.insets = *insets;
+    if (w <= 2u*b.border || h <= 2u*b.border ||
+        (insets != NULL && (insets->left + insets->right > w || insets->top + insets->bottom > h))) {
+        LV_LOG_ERROR("nine-patch image is too small.\n");
+        return NULL;
+    }
+
+    lv_pngle_ninepatch_t * np = (lv_pngle_ninepatch_t*)PNGLE_MALLOC(sizeof(lv_pngle_ninepatch_t));
+    if (np == NULL) return NULL;
+    memset(np, 0, sizeof(lv_pngle_ninepatch_t));
+    b.np = np;
+
+    uint32_t iw = w - 2*b.border;
+    b.col_map = (uint16_t*)PNGLE_MALLOC(iw*sizeof(uint16_t));
+    b.col_store = (uint8_t*)PNGLE_MALLOC(iw);
+    if (b.col_map == NULL || b.col_store == NULL) b.failed = true;
+    else if (insets != NULL) {
+        for (uint32_t ix = 0; ix < iw; ix++) b.col_store[ix] = ix >= insets->left && ix + insets->right < iw;
+        if (np_build_cols(&b) != LV_RES_OK) b.failed = true;
+    }
+
+    if (!b.failed) {
+        lv_pngle_data_t ud;
+        _lv_pngle_data_init(&ud, w, h);
+        ud.px_cb = np_px_cb;
+        ud.user_data = &b;
+        if (_lv_pngle_decode(&in, &ud) != LV_RES_OK) {
+            LV_LOG_ERROR("PNG decoding failed.\n");
+            b.failed = true;
+        }
+    }
+    if (!b.failed && (np->n_cols == 0 || np->n_rows == 0)) b.failed = true;
+    if (!b.failed && !b.uniform) LV_LOG_WARN("nine-patch stretchable areas aren't uniform: they're drawn from their first row or column.\n");
+    if (!b.failed && np_build_tiles(&b) != LV_RES_OK) b.failed = true;
+
+    if (b.pad_x[0] >= 0) {
+        np->pad.x1 = b.pad_x[0];
+        np->pad.x2 = iw - 1 - b.pad_x[1];
+    }
+    if (b.pad_y[0] >= 0) {
+        np->pad.y1 = b.pad_y[0];
+        np->pad.y2 = h - 2*b.border - 1 - b.pad_y[1];
+    }
+
+    if (b.col_map != NULL) PNGLE_FREE(b.col_map);
+    if (b.col_store != NULL) PNGLE_FREE(b.col_store);
+    if (b.compact != NULL) PNGLE_FREE(b.compact);
+    if (b.failed) {
+        lv_pngle_ninepatch_delete(np);
+        return NULL;
+    }
+    return np;
+}
+
+
+void lv_pngle_ninepatch_delete(lv_pngle_ninepatch_t * np) {
+    if (np->tiles != NULL) PNGLE_FREE(np->tiles);
+    if (np->data != NULL) PNGLE_FREE(np->data);
+    PNGLE_FREE(np);
+}
+
+
+void lv_pngle_ninepatch_get_padding(const lv_pngle_ninepatch_t * np, lv_area_t * pad) {
+    *pad = np->pad;
+}
+
+
+/** \brief Compute drawn sizes of runs along an axis.
+ *
+ *  Fixed runs keep their size; stretchable runs share the remaining space in
+ *  proportion of their original size.
+ *
+ *  \param segs: runs.
+ *  \param n: number of runs.
+ *  \param size: size to fill.
+ *  \param out: target for drawn sizes.
+ */
+static void np_layout(const np_seg_t * segs, uint8_t n, int32_t size, int32_t * out) {
+    int32_t fixed = 0;
+    int32_t stretch = 0;
+    for (uint8_t k = 0; k < n; k++) {
+        if (segs[k].stretch) stretch += segs[k].len;
+        else fixed += segs[k].len;
+    }
+    int32_t avail = size > fixed ? size - fixed : 0;
+    int32_t left = avail;
+    int32_t seen = 0;
+    for (uint8_t k = 0; k < n; k++) {
+        if (!segs[k].stretch) {
+            out[k] = segs[k].len;
+            continue;
+        }
+        seen += segs[k].len;
+        // last stretchable run takes the rounding remainder
+        out[k] = seen == stretch ? left : avail*segs[k].len/stretch;
+        left -= out[k];
+    }
+}
+
+/** \brief Fill an area with a single pixel value.
+ *  \param ctx: drawing target.
+ *  \param a: area to fill.
+ *  \param px: pointer to color data.
+ *  \param alpha: pointer to alpha value (planar color formats only).
+ *  \param opa: opacity.
+ */
+static void np_fill(lv_pngle_draw_ctx_t * ctx, const lv_area_t * a, const uint8_t * px, const uint8_t * alpha, lv_opa_t opa) {
+    uint8_t rgba[4];
+    _lv_pngle_unpack_pixel(px, alpha, rgba);
+    lv_opa_t o = (lv_opa_t)((rgba[3]*opa)/255);
+    if (o == LV_OPA_TRANSP) return;
+    lv_draw_rect_dsc_t dsc;
+    lv_draw_rect_dsc_init(&dsc);
+#if LV_PNGLE_USE_LVGL_V9
+    dsc.bg_color = lv_color_make(rgba[0], rgba[1], rgba[2]);
+#else
+    dsc.bg_color = _lv_pngle_make_color(rgba);
+#endif
+    dsc.bg_opa = o;
+    lv_draw_rect(ctx, &dsc, a);
+}
+
+/** \brief Draw a fixed tile.
+ *  \param ctx: drawing target.
+ *  \param tile: tile descriptor.
+ *  \param a: area to draw to.
+ *  \param opa: opacity.
+ */
+static void np_draw_tile(lv_pngle_draw_ctx_t * ctx, const np_tile_t * tile, const lv_area_t * a, lv_opa_t opa) {
+#if LV_PNGLE_USE_LVGL_V9
+    lv_draw_image_dsc_t dsc;
+    lv_draw_image_dsc_init(&dsc);
+    dsc.src = tile;
+    dsc.opa = opa;
+    lv_draw_image(ctx, &dsc, a);
+#else
+    lv_draw_img_dsc_t dsc;
+    lv_draw_img_dsc_init(&dsc);
+    dsc.opa = opa;
+    lv_draw_img(ctx, &dsc, a, tile);
+#endif
+}
+
+
+void lv_pngle_ninepatch_draw(lv_pngle_draw_ctx_t * ctx, const lv_pngle_ninepatch_t * np,
+                             const lv_area_t * coords, lv_opa_t opa) {
+    int32_t col_w[LV_PNGLE_NINEPATCH_MAX_SEGS];
+    int32_t row_h[LV_PNGLE_NINEPATCH_MAX_SEGS];
+    np_layout(np->cols, np->n_cols, lv_area_get_width(coords), col_w);
+    np_layout(np->rows, np->n_rows, lv_area_get_height(coords), row_h);
+
+    int32_t y = coords->y1;
+    for (uint8_t i = 0; i < np->n_rows; y += row_h[i], i++) {
+        int32_t x = coords->x1;
+        for (uint8_t j = 0; j < np->n_cols; x += col_w[j], j++) {
+            if (col_w[j] <= 0 || row_h[i] <= 0) continue;
+            const np_tile_t * tile = &np->tiles[i*np->n_cols + j];
+            lv_area_t a;
+            a.x1 = x;
+            a.y1 = y;
+            a.x2 = x + col_w[j] - 1;
+            a.y2 = y + row_h[i] - 1;
+            if (!np->cols[j].stretch && !np->rows[i].stretch) {
+                np_draw_tile(ctx, tile, &a, opa);
+                continue;
+            }
+            // stretched tiles are one pixel thick along stretched axes: draw them as lines or as a single fill
+            uint32_t tw = tile->header.w;
+            uint32_t th = tile->header.h;
+            for (uint32_t ty = 0; ty < th; ty++) {
+                for (uint32_t tx = 0; tx < tw; tx++) {
+                    lv_area_t f;
+                    f.x1 = np->cols[j].stretch ? a.x1 : a.x1 + (int32_t)tx;
+                    f.x2 = np->cols[j].stretch ? a.x2 : f.x1;
+                    f.y1 = np->rows[i].stretch ? a.y1 : a.y1 + (int32_t)ty;
+                    f.y2 = np->rows[i].stretch ? a.y2 : f.y1;
+                    np_fill(ctx, &f, tile->data + (ty*tw + tx)*PNGLE_COLOR_SIZE,
+                            PNGLE_PLANAR_ALPHA ? tile->data + tw*th*PNGLE_COLOR_SIZE + ty*tw + tx : NULL, opa);
+                }
+            }
+        }
+    }
+}
+
+
+/** \brief Event callback drawing a nine-patch image as object background.
+ *  \param e: event.
+ */
+static void np_event_cb(lv_event_t * e) {
+    lv_obj_t * obj = (lv_obj_t*)lv_event_get_current_target(e);
+    const lv_pngle_ninepatch_t * np = (const lv_pngle_ninepatch_t*)lv_event_get_user_data(e);
+    lv_area_t coords;
+    lv_obj_get_coords(obj, &coords);
+#if LV_PNGLE_USE_LVGL_V9
+    lv_pngle_ninepatch_draw(lv_event_get_layer(e), np, &coords, LV_OPA_COVER);
+#else
+    lv_pngle_ninepatch_draw(lv_event_get_draw_ctx(e), np, &coords, LV_OPA_COVER);
+#endif
+}
+
+
+void lv_pngle_ninepatch_attach(lv_obj_t * obj, const lv_pngle_ninepatch_t * np) {
+    lv_obj_add_event_cb(obj, np_event_cb, LV_EVENT_DRAW_MAIN, (void*)np);
+}
+
+#endif
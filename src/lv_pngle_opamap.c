@@ -0,0 +1,426 @@
+/** \file lv_pngle_opamap.c
+ *  \brief Images decoded with the opacity of their rows, drawn without blending
+ *  fully transparent and fully opaque spans.
+ *
+ *  Author: Vincent Paeder
+ *  License: MIT
+ */
+#include "lv_pngle_private.h"
+
+#if LV_PNGLE_USE_OPAMAP
+
+/** \brief An image decoded with the opacity of its rows. */
+struct _lv_pngle_opamap_t {
+    /** \brief Image width. */
+    uint32_t w;
+
+    /** \brief Image height. */
+    uint32_t h;
+
+    /** \brief Opacity of each row. */
+    lv_pngle_row_opa_t * rows;
+
+    /** \brief Pixel data. */
+    uint8_t * data;
+
+#if LV_PNGLE_USE_LVGL_V9
+    /** \brief Image descriptor of pixel data, with alpha. */
+    lv_image_dsc_t img;
+
+    /** \brief Image descriptor of the color data of the same pixels, without alpha (fully opaque spans). */
+    lv_image_dsc_t opaque;
+#else
+    /** \brief Color plane, in pixel data. */
+    lv_color_t * color;
+
+    /** \brief Alpha plane, in pixel data. */
+    lv_opa_t * alpha;
+#endif
+};
+
+/** \brief Rows drawn with the same spans. */
+typedef struct _opamap_band_t {
+    /** \brief First row of band. */
+    int32_t y1;
+
+    /** \brief Last row of band. */
+    int32_t y2;
+
+    /** \brief First column that isn't fully transparent in some row. */
+    int32_t x1;
+
+    /** \brief Last column that isn't fully transparent in some row. */
+    int32_t x2;
+
+    /** \brief First column of fully opaque span common to all rows. */
+    int32_t ox1;
+
+    /** \brief Last column of fully opaque span common to all rows (ox2 < ox1 if none). */
+    int32_t ox2;
+} opamap_band_t;
+
+
+/** \brief Point to the alpha values of a row.
+ *  \param m: pointer to image.
+ *  \param y: row index.
+ *  \param step: target for distance between alpha values, in bytes.
+ *  \returns pointer to alpha value of first pixel.
+ */
+static const uint8_t * opamap_row_alpha(const lv_pngle_opamap_t * m, uint32_t y, uint32_t * step) {
+#if LV_PNGLE_USE_LVGL_V9
+#if PNGLE_PLANAR_ALPHA
+    *step = 1;
+    return m->data + m->w*m->h*PNGLE_COLOR_SIZE + y*m->w;
+#else
+    *step = PNGLE_COLOR_SIZE;
+    return m->data + y*m->w*PNGLE_COLOR_SIZE + 3;
+#endif
+#else
+    *step = 1;
+    return m->alpha + y*m->w;
+#endif
+}
+
+/** \brief Classify a decoded row.
+ *  \param m: pointer to image.
+ *  \param y: row index.
+ */
+static void opamap_scan_row(lv_pngle_opamap_t * m, uint32_t y) {
+    uint32_t step;
+    const uint8_t * a = opamap_row_alpha(m, y, &step);
+    int32_t x1 = -1;
+    int32_t x2 = -1;
+    uint32_t run = 0;
+    uint32_t best = 0;
+    uint32_t best_end = 0;
+    for (uint32_t x = 0; x < m->w; x++, a += step) {
+        if (*a != LV_OPA_TRANSP) {
+            if (x1 < 0) x1 = (int32_t)x;
+            x2 = (int32_t)x;
+        }
+        if (*a == LV_OPA_COVER) {
+            if (++run > best) {
+                best = run;
+                best_end = x;
+            }
+        } else {
+            run = 0;
+        }
+    }
+
+    lv_pngle_row_opa_t * r = &m->rows[y];
+    // empty spans have their end before their start
+    r->ox1 = 1;
+    r->ox2 = 0;
+    if (x1 < 0) {
+        r->cls = LV_PNGLE_ROW_TRANSP;
+        r->x1 = 1;
+        r->x2 = 0;
+        return;
+    }
+    r->x1 = (uint16_t)x1;
+    r->x2 = (uint16_t)x2;
+    r->cls = best == m->w ? LV_PNGLE_ROW_COVER : LV_PNGLE_ROW_MIXED;
+    if (best == m->w || best >= LV_PNGLE_OPAMAP_MIN_RUN) {
+        r->ox1 = (uint16_t)(best_end + 1 - best);
+        r->ox2 = (uint16_t)best_end;
+    }
+}
+
+/** \brief Function called with each pixel while the image is decoded.
+ *  \param ud: pointer to the data structure shared with Pngle.
+ *  \param x: horizontal coordinate of pixel.
+ *  \param y: vertical coordinate of pixel.
+ *  \param rgba: pointer to pixel value.
+ */
+static void opamap_px_cb(lv_pngle_data_t * ud, uint32_t x, uint32_t y, const uint8_t * rgba) {
+    lv_pngle_opamap_t * m = (lv_pngle_opamap_t*)ud->user_data;
+#if !LV_PNGLE_USE_LVGL_V9
+    m->color[y*m->w + x] = _lv_pngle_make_color(rgba);
+    m->alpha[y*m->w + x] = rgba[3];
+#else
+    LV_UNUSED(rgba);
+#endif
+    // classified while the row is still in cache; interlaced images are classified once decoded
+    if (x + 1 == m->w && !ud->interlaced) opamap_scan_row(m, y);
+}
+
+
+lv_pngle_opamap_t * lv_pngle_opamap_create(const void * src) {
+    lv_pngle_input_t in;
+    uint32_t w, h;
+    if (_lv_pngle_get_src(src, &in) != LV_RES_OK) return NULL;
+    if (_lv_pngle_read_header(&in, &w, &h) != LV_RES_OK) return NULL;
+    if (w > UINT16_MAX) {
+        LV_LOG_ERROR("image is too wide for an opacity map.\n");
+        return NULL;
+    }
+
+    lv_pngle_opamap_t * m = (lv_pngle_opamap_t*)PNGLE_MALLOC(sizeof(lv_pngle_opamap_t));
+    if (m == NULL) return NULL;
+    memset(m, 0, sizeof(lv_pngle_opamap_t));
+    m->w = w;
+    m->h = h;
+#if LV_PNGLE_USE_LVGL_V9
+    uint32_t size = w*h*PNGLE_PX_SIZE;
+#else
+    uint32_t size = w*h*(sizeof(lv_color_t) + 1);
+#endif
+    LV_LOG_INFO("allocating memory for image and opacity map: %d bytes\n", size + h*sizeof(lv_pngle_row_opa_t));
+    m->data = (uint8_t*)PNGLE_MALLOC(size);
+    m->rows = (lv_pngle_row_opa_t*)PNGLE_MALLOC(h*sizeof(lv_pngle_row_opa_t));
+    if (m->data == NULL || m->rows == NULL) {
+        LV_LOG_ERROR("couldn't allocate memory for image.\n");
+        lv_pngle_opamap_delete(m);
+        return NULL;
+    }
+
+    lv_pngle_data_t ud;
+    _lv_pngle_data_init(&ud, w, h);
+    _lv_pngle_get_tint(src, &ud);
+    ud.px_cb = opamap_px_cb;
+    ud.user_data = m;
+#if LV_PNGLE_USE_LVGL_V9
+    // pixels are converted by the decoder, in the format of full buffers
+    ud.data = m->data;
+    ud.stride = w*PNGLE_COLOR_SIZE;
+#if PNGLE_PLANAR_ALPHA
+    ud.alpha = m->data + w*h*PNGLE_COLOR_SIZE;
+    ud.alpha_stride = w;
+#endif
+#else
+    // planar, so that opaque spans can be copied from the color plane
+    m->color = (lv_color_t*)m->data;
+    m->alpha = m->data + w*h*sizeof(lv_color_t);
+#endif
+    if (_lv_pngle_decode(&in, &ud) != LV_RES_OK) {
+        LV_LOG_ERROR("PNG decoding failed.\n");
+        lv_pngle_opamap_delete(m);
+        return NULL;
+    }
+    if (ud.interlaced) {
+        for (uint32_t y = 0; y < h; y++) opamap_scan_row(m, y);
+    }
+
+#if LV_PNGLE_USE_LVGL_V9
+    m->img.header.magic = LV_IMAGE_HEADER_MAGIC;
+    m->img.header.cf = PNGLE_CF;
+    m->img.header.w = w;
+    m->img.header.h = h;
+    m->img.header.stride = w*PNGLE_COLOR_SIZE;
+    m->img.data_size = size;
+    m->img.data = m->data;
+    // same color data, alpha ignored
+    m->opaque = m->img;
+    m->opaque.header.cf = PNGLE_PLANAR_ALPHA ? LV_COLOR_FORMAT_RGB565 : LV_COLOR_FORMAT_XRGB8888;
+    m->opaque.data_size = w*h*PNGLE_COLOR_SIZE;
+#endif
+    return m;
+}
+
+
+void lv_pngle_opamap_delete(lv_pngle_opamap_t * m) {
+#if LV_PNGLE_USE_LVGL_V9
+    lv_image_cache_drop(&m->img);
+    lv_image_cache_drop(&m->opaque);
+#endif
+    if (m->rows != NULL) PNGLE_FREE(m->rows);
+    if (m->data != NULL) PNGLE_FREE(m->data);
+    PNGLE_FREE(m);
+}
+
+
+void lv_pngle_opamap_get_size(const lv_pngle_opamap_t * m, uint32_t * w, uint32_t * h) {
+    *w = m->w;
+    *h = m->h;
+}
+
+
+const lv_pngle_row_opa_t * lv_pngle_opamap_get_rows(const lv_pngle_opamap_t * m) {
+    return m->rows;
+}
+
+
+/** \brief Gather rows that can be drawn with the same spans, starting from a row that isn't fully transparent.
+ *
+ *  With LVGL v9, every span drawn is a draw task: rows are merged as long as their
+ *  common opaque span stays at least 3/4 of the first one. With LVGL v8, spans are
+ *  blended right away and bands hold a single row.
+ *
+ *  \param m: pointer to image.
+ *  \param y: first row.
+ *  \param y_max: last row that can be included.
+ *  \param b: target for band.
+ */
+static void opamap_band(const lv_pngle_opamap_t * m, int32_t y, int32_t y_max, opamap_band_t * b) {
+    const lv_pngle_row_opa_t * r = &m->rows[y];
+    b->y1 = b->y2 = y;
+    b->x1 = r->x1;
+    b->x2 = r->x2;
+    b->ox1 = r->ox1;
+    b->ox2 = r->ox2;
+#if LV_PNGLE_USE_LVGL_V9
+    int32_t min_run = (b->ox2 - b->ox1 + 1)*3/4;
+    if (min_run < LV_PNGLE_OPAMAP_MIN_RUN) min_run = LV_PNGLE_OPAMAP_MIN_RUN;
+    bool has_run = b->ox2 >= b->ox1;
+    while (b->y2 < y_max) {
+        r = &m->rows[b->y2 + 1];
+        if (r->cls == LV_PNGLE_ROW_TRANSP || (r->ox2 >= r->ox1) != has_run) break;
+        int32_t ox1 = r->ox1 > b->ox1 ? r->ox1 : b->ox1;
+        int32_t ox2 = r->ox2 < b->ox2 ? r->ox2 : b->ox2;
+        if (has_run && ox2 - ox1 + 1 < min_run) break;
+        b->y2++;
+        if (r->x1 < b->x1) b->x1 = r->x1;
+        if (r->x2 > b->x2) b->x2 = r->x2;
+        if (has_run) {
+            b->ox1 = ox1;
+            b->ox2 = ox2;
+        }
+    }
+#else
+    LV_UNUSED(y_max);
+#endif
+}
+
+#if LV_PNGLE_USE_LVGL_V9
+/** \brief Draw a span of a band.
+ *  \param layer: drawing target.
+ *  \param m: pointer to image.
+ *  \param coords: screen area of image.
+ *  \param clip: screen area to draw, within image area.
+ *  \param b: band.
+ *  \param x1: first column of span.
+ *  \param x2: last column of span.
+ *  \param cover: if true, span is fully opaque.
+ *  \param opa: opacity.
+ */
+static void opamap_draw_span(lv_layer_t * layer, lv_pngle_opamap_t * m, const lv_area_t * coords, const lv_area_t * clip,
+                             const opamap_band_t * b, int32_t x1, int32_t x2, bool cover, lv_opa_t opa) {
+    lv_area_t span;
+    span.x1 = coords->x1 + x1;
+    span.x2 = coords->x1 + x2;
+    span.y1 = coords->y1 + b->y1;
+    span.y2 = coords->y1 + b->y2;
+    lv_area_t clip_ori = layer->_clip_area;
+    if (!lv_area_intersect(&layer->_clip_area, &span, clip)) {
+        layer->_clip_area = clip_ori;
+        return;
+    }
+    // the whole image is drawn, clipped to the span
+    lv_area_t a;
+    a.x1 = coords->x1;
+    a.y1 = coords->y1;
+    a.x2 = coords->x1 + (int32_t)m->w - 1;
+    a.y2 = coords->y1 + (int32_t)m->h - 1;
+    lv_draw_image_dsc_t dsc;
+    lv_draw_image_dsc_init(&dsc);
+    dsc.src = cover ? &m->opaque : &m->img;
+    dsc.opa = opa;
+    lv_draw_image(layer, &dsc, &a);
+    layer->_clip_area = clip_ori;
+}
+#else
+/** \brief Blend a span of a row.
+ *  \param ctx: drawing target.
+ *  \param m: pointer to image.
+ *  \param coords: screen area of image.
+ *  \param clip: screen area to draw, within image area.
+ *  \param b: band (single row).
+ *  \param x1: first column of span.
+ *  \param x2: last column of span.
+ *  \param cover: if true, span is fully opaque and is copied as is.
+ *  \param opa: opacity.
+ */
+static void opamap_draw_span(lv_draw_ctx_t * ctx, lv_pngle_opamap_t * m, const lv_area_t * coords, const lv_area_t * clip,
+                             const opamap_band_t * b, int32_t x1, int32_t x2, bool cover, lv_opa_t opa) {
+    lv_area_t span;
+    span.x1 = coords->x1 + x1;
+    span.x2 = coords->x1 + x2;
+    span.y1 = span.y2 = coords->y1 + b->y1;
+    // source pixels start at the first visible one
+    if (!_lv_area_intersect(&span, &span, clip)) return;
+
+    uint32_t ofs = b->y1*m->w + (span.x1 - coords->x1);
+    lv_draw_sw_blend_dsc_t dsc;
+    memset(&dsc, 0, sizeof(dsc));
+    dsc.blend_area = &span;
+    dsc.src_buf = m->color + ofs;
+    dsc.mask_area = &span;
+    dsc.opa = opa;
+    dsc.blend_mode = LV_BLEND_MODE_NORMAL;
+
+    lv_opa_t * mask = NULL;
+    if (lv_draw_mask_is_any(&span)) {
+        // masks of parents (rounded corners, ...) apply on top of pixel opacity
+        uint32_t len = lv_area_get_width(&span);
+        mask = (lv_opa_t*)lv_mem_buf_get(len);
+        if (cover) memset(mask, LV_OPA_COVER, len);
+        else memcpy(mask, m->alpha + ofs, len);
+        if (lv_draw_mask_apply(mask, span.x1, span.y1, (lv_coord_t)len) == LV_DRAW_MASK_RES_TRANSP) {
+            lv_mem_buf_release(mask);
+            return;
+        }
+        dsc.mask_buf = mask;
+        dsc.mask_res = LV_DRAW_MASK_RES_CHANGED;
+    } else if (cover) {
+        dsc.mask_res = LV_DRAW_MASK_RES_FULL_COVER;
+    } else {
+        dsc.mask_buf = m->alpha + ofs;
+        dsc.mask_res = LV_DRAW_MASK_RES_CHANGED;
+    }
+    lv_draw_sw_blend(ctx, &dsc);
+    if (mask != NULL) lv_mem_buf_release(mask);
+}
+#endif
+
+
+void lv_pngle_opamap_draw(lv_pngle_draw_ctx_t * ctx, lv_pngle_opamap_t * m, const lv_area_t * coords, lv_opa_t opa) {
+    if (opa == LV_OPA_TRANSP) return;
+    lv_area_t clip;
+#if LV_PNGLE_USE_LVGL_V9
+    if (!lv_area_intersect(&clip, coords, &ctx->_clip_area)) return;
+#else
+    if (!_lv_area_intersect(&clip, coords, ctx->clip_area)) return;
+#endif
+    int32_t y1 = clip.y1 - coords->y1;
+    int32_t y2 = clip.y2 - coords->y1;
+    if (y2 > (int32_t)m->h - 1) y2 = (int32_t)m->h - 1;
+
+    for (int32_t y = y1; y <= y2; y++) {
+        if (m->rows[y].cls == LV_PNGLE_ROW_TRANSP) continue;
+        opamap_band_t b;
+        opamap_band(m, y, y2, &b);
+        y = b.y2;
+        if (b.ox2 < b.ox1) {
+            opamap_draw_span(ctx, m, coords, &clip, &b, b.x1, b.x2, false, opa);
+            continue;
+        }
+        // fully transparent ends are skipped, the opaque span is copied, the rest is blended
+        if (b.x1 < b.ox1) opamap_draw_span(ctx, m, coords, &clip, &b, b.x1, b.ox1 - 1, false, opa);
+        opamap_draw_span(ctx, m, coords, &clip, &b, b.ox1, b.ox2, true, opa);
+        if (b.ox2 < b.x2) opamap_draw_span(ctx, m, coords, &clip, &b, b.ox2 + 1, b.x2, false, opa);
+    }
+}
+
+
+/** \brief Event callback drawing an image as object background.
+ *  \param e: event.
+ */
+static void opamap_event_cb(lv_event_t * e) {
+    lv_obj_t * obj = (lv_obj_t*)lv_event_get_current_target(e);
+    lv_pngle_opamap_t * m = (lv_pngle_opamap_t*)lv_event_get_user_data(e);
+    lv_area_t coords;
+    lv_obj_get_coords(obj, &coords);
+#if LV_PNGLE_USE_LVGL_V9
+    lv_pngle_opamap_draw(lv_event_get_layer(e), m, &coords, LV_OPA_COVER);
+#else
+    lv_pngle_opamap_draw(lv_event_get_draw_ctx(e), m, &coords, LV_OPA_COVER);
+#endif
+}
+
+
+void lv_pngle_opamap_attach(lv_obj_t * obj, lv_pngle_opamap_t * m) {
+    lv_obj_add_event_cb(obj, opamap_event_cb, LV_EVENT_DRAW_MAIN, m);
+}
+
+#endif
@@ -0,0 +1,84 @@
+/** \file lv_pngle_palette.c
+ *  \brief Mapping of decoded pixels to a global 256-color palette through a lookup table.
+ *
+ *  Author: Vincent Paeder
+ *  License: MIT
+ */
+#include "lv_pngle_private.h"
+
+#if LV_PNGLE_USE_PALETTE
+
+#define PALETTE_LUT_SIZE (1UL << (3*LV_PNGLE_PALETTE_LUT_BITS)) ///< Number of entries in lookup table
+
+const uint8_t * _lv_pngle_palette_lut = NULL;
+uint8_t _lv_pngle_palette_rgb[PNGLE_PALETTE_COLORS*3];
+
+/** \brief Lookup table computed by lv_pngle_palette_set, NULL if a precomputed one is used. */
+static uint8_t * palette_own_lut = NULL;
+
+
+/** \brief Find the palette color nearest to a value.
+ *  \param rgb: palette colors.
+ *  \param n: number of palette colors.
+ *  \param r: red value.
+ *  \param g: green value.
+ *  \param b: blue value.
+ *  \returns palette index.
+ */
+static uint8_t palette_nearest(const uint8_t * rgb, uint16_t n, int32_t r, int32_t g, int32_t b) {
+    uint8_t best = 0;
+    uint32_t best_d = UINT32_MAX;
+    for (uint16_t i = 0; i < n; i++, rgb += 3) {
+        int32_t dr = r - rgb[0];
+        int32_t dg = g - rgb[1];
+        int32_t db = b - rgb[2];
+        // weighted for eye sensitivity
+        uint32_t d = 2*dr*dr + 4*dg*dg + 3*db*db;
+        if (d < best_d) {
+            best_d = d;
+            best = i;
+            if (d == 0) break;
+        }
+    }
+    return best;
+}
+
+
+bool lv_pngle_palette_set(const uint8_t * rgb, uint16_t n, const uint8_t * lut) {
+    _lv_pngle_palette_lut = NULL;
+    if (palette_own_lut != NULL) {
+        PNGLE_FREE(palette_own_lut);
+        palette_own_lut = NULL;
+    }
+    // images decoded with the previous palette are stale
+    lv_img_cache_invalidate_src(NULL);
+    if (rgb == NULL || n == 0) return true;
+    if (n > PNGLE_PALETTE_COLORS) return false;
+
+    memset(_lv_pngle_palette_rgb, 0, sizeof(_lv_pngle_palette_rgb));
+    memcpy(_lv_pngle_palette_rgb, rgb, n*3);
+    if (lut != NULL) {
+        _lv_pngle_palette_lut = lut;
+        return true;
+    }
+
+    LV_LOG_INFO("allocating memory for palette lookup table: %d bytes\n", (int)PALETTE_LUT_SIZE);
+    palette_own_lut = (uint8_t*)PNGLE_MALLOC(PALETTE_LUT_SIZE);
+    if (palette_own_lut == NULL) return false;
+    const uint32_t levels = 1UL << LV_PNGLE_PALETTE_LUT_BITS;
+    // each entry maps the center of its quantization cell
+    const int32_t half = (1 << PNGLE_LUT_SHIFT) >> 1;
+    uint8_t * p = palette_own_lut;
+    for (uint32_t r = 0; r < levels; r++) {
+        for (uint32_t g = 0; g < levels; g++) {
+            for (uint32_t b = 0; b < levels; b++) {
+                *p++ = palette_nearest(rgb, n, (r << PNGLE_LUT_SHIFT) + half,
+                                       (g << PNGLE_LUT_SHIFT) + half, (b << PNGLE_LUT_SHIFT) + half);
+            }
+        }
+    }
+    _lv_pngle_palette_lut = palette_own_lut;
+    return true;
+}
+
+#endif
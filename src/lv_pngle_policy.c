@@ -0,0 +1,191 @@
+/** \file lv_pngle_policy.c
+ *  \brief Choice between full and row by row decoding per image, and of its priority
+ *  in LVGL's image cache, from measured costs.
+ *
+ *  Author: Vincent Paeder
+ *  License: MIT
+ */
+#include "lv_pngle_private.h"
+
+#if LV_PNGLE_USE_POLICY
+
+/** \brief What is known of an image. */
+typedef struct _policy_entry_t {
+    /** \brief Path hash (file sources) or address (other sources), 0 if slot is free. */
+    uint32_t key;
+
+    /** \brief If true, key is a path hash. */
+    bool is_file;
+
+    /** \brief If true, image is streamed too often and gets decoded fully from now on. */
+    bool promoted;
+
+    /** \brief Last decision. */
+    lv_pngle_policy_reason_t reason;
+
+    /** \brief Cache priority given by last decision. */
+    uint8_t priority;
+
+    /** \brief Number of times the image was opened. */
+    uint32_t opens;
+
+    /** \brief Tick of last opening. */
+    uint32_t last_open;
+
+    /** \brief Image height. */
+    uint32_t height;
+
+    /** \brief Size of a full buffer for the image, in bytes. */
+    uint32_t size;
+
+    /** \brief Last full decoding time, in milliseconds. */
+    uint32_t decode_ms;
+
+    /** \brief Decoding passes made while streamed, over all openings. */
+    uint32_t passes;
+} policy_entry_t;
+
+/** \brief Known images. */
+static policy_entry_t policy_entries[LV_PNGLE_POLICY_SLOTS];
+
+/** \brief Decision counters and measured costs. */
+static lv_pngle_policy_stats_t policy_stats;
+
+
+/** \brief Get the key of an image source.
+ *  \param src: pointer to image source.
+ *  \param is_file: target for key type.
+ *  \returns key (never 0).
+ */
+static uint32_t policy_key(const void * src, bool * is_file) {
+    uint32_t h;
+#if LV_PNGLE_USE_LVGL_V9
+    *is_file = lv_image_src_get_type(src) == LV_IMAGE_SRC_FILE;
+#else
+    *is_file = lv_img_src_get_type(src) == LV_IMG_SRC_FILE;
+#endif
+    if (*is_file) {
+        // file paths are copied by LVGL: hash them (FNV-1a)
+        const char * fn = (const char*)src;
+        h = 2166136261u;
+        while (*fn) h = (h ^ (uint8_t)*fn++)*16777619u;
+    } else {
+        h = (uint32_t)(uintptr_t)src;
+    }
+    return h != 0 ? h : 1;
+}
+
+/** \brief Find the entry of an image source.
+ *  \param src: pointer to image source.
+ *  \param create: if true, an entry is created when none exists, replacing the least recently opened one.
+ *  \returns pointer to entry, or NULL if not found.
+ */
+static policy_entry_t * policy_find(const void * src, bool create) {
+    bool is_file;
+    uint32_t key = policy_key(src, &is_file);
+    policy_entry_t * oldest = NULL;
+    for (uint32_t i = 0; i < LV_PNGLE_POLICY_SLOTS; i++) {
+        policy_entry_t * e = &policy_entries[i];
+        if (e->key == key && e->is_file == is_file) return e;
+        if (oldest == NULL || (oldest->key != 0 && (e->key == 0 || lv_tick_elaps(e->last_open) > lv_tick_elaps(oldest->last_open)))) {
+            oldest = e;
+        }
+    }
+    if (!create) return NULL;
+    memset(oldest, 0, sizeof(policy_entry_t));
+    oldest->key = key;
+    oldest->is_file = is_file;
+    return oldest;
+}
+
+/** \brief Check whether a full buffer can be allocated without starving other allocations.
+ *  \param size: size of buffer, in bytes.
+ *  \returns true if buffer fits, or if free memory isn't known.
+ */
+static bool policy_fits(uint32_t size) {
+    lv_mem_monitor_t mon;
+    lv_mem_monitor(&mon);
+    // custom allocators don't report free memory
+    if (mon.free_biggest_size == 0) return true;
+    return mon.free_biggest_size >= size + LV_PNGLE_POLICY_MEM_RESERVE;
+}
+
+
+bool _lv_pngle_policy_use_stream(const void * src, uint32_t w, uint32_t h) {
+    policy_entry_t * e = policy_find(src, true);
+    uint32_t since = lv_tick_elaps(e->last_open);
+    e->opens++;
+    e->last_open = lv_tick_get();
+    e->height = h;
+    e->size = w*h*PNGLE_PX_SIZE;
+
+    if (w*h < LV_PNGLE_POLICY_SMALL_PX) e->reason = LV_PNGLE_POLICY_FULL_SMALL;
+    else if (!policy_fits(e->size)) e->reason = LV_PNGLE_POLICY_STREAM_MEMORY;
+    else if (e->promoted) e->reason = LV_PNGLE_POLICY_FULL_REDRAWN;
+    else if (e->opens >= LV_PNGLE_POLICY_HOT_OPENS && since <= LV_PNGLE_POLICY_HOT_MS) e->reason = LV_PNGLE_POLICY_FULL_HOT;
+    else e->reason = LV_PNGLE_POLICY_STREAM_COLD;
+    policy_stats.decisions[e->reason]++;
+    // images decoded fully because they're used often are the ones worth keeping cached
+    bool hot = e->reason == LV_PNGLE_POLICY_FULL_HOT || e->reason == LV_PNGLE_POLICY_FULL_REDRAWN;
+    e->priority = hot ? LV_PNGLE_POLICY_HOT_PRIORITY : 0;
+    if (hot) policy_stats.prioritized++;
+
+    bool stream = e->reason == LV_PNGLE_POLICY_STREAM_COLD || e->reason == LV_PNGLE_POLICY_STREAM_MEMORY;
+    if (stream) policy_stats.bytes_saved += e->size;
+    LV_LOG_INFO("decoding policy: %s (reason %d)\n", stream ? "row by row" : "full buffer", e->reason);
+    return stream;
+}
+
+
+uint8_t _lv_pngle_policy_get_priority(const void * src) {
+    const policy_entry_t * e = policy_find(src, false);
+    return e != NULL ? e->priority : 0;
+}
+
+
+void _lv_pngle_policy_record_decode(const void * src, uint32_t elapsed) {
+    policy_stats.full_ms += elapsed;
+    policy_entry_t * e = policy_find(src, false);
+    if (e != NULL) e->decode_ms = elapsed;
+}
+
+
+void _lv_pngle_policy_record_stream(const void * src, uint32_t rows) {
+    policy_stats.stream_rows += rows;
+    policy_entry_t * e = policy_find(src, false);
+    if (e == NULL || e->height == 0) return;
+    if (policy_stats.bytes_saved >= e->size) policy_stats.bytes_saved -= e->size;
+    uint32_t passes = (rows + e->height - 1)/e->height;
+    e->passes += passes;
+    // redrawn so often that decoding it once is cheaper
+    if (passes > LV_PNGLE_POLICY_MAX_PASSES) {
+        LV_LOG_INFO("image decoded %d times while streamed: decoding it fully from now on\n", passes);
+        e->promoted = true;
+    }
+}
+
+
+void lv_pngle_policy_get_stats(lv_pngle_policy_stats_t * stats) {
+    *stats = policy_stats;
+}
+
+
+bool lv_pngle_policy_get_info(const void * src, lv_pngle_policy_info_t * info) {
+    policy_entry_t * e = policy_find(src, false);
+    if (e == NULL) return false;
+    info->reason = e->reason;
+    info->opens = e->opens;
+    info->decode_ms = e->decode_ms;
+    info->stream_passes = e->passes;
+    info->size = e->size;
+    info->priority = e->priority;
+    return true;
+}
+
+
+void lv_pngle_policy_reset(void) {
+    memset(policy_entries, 0, sizeof(policy_entries));
+    memset(&policy_stats, 0, sizeof(policy_stats));
+}
+
+#endif
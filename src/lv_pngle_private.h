@@ -0,0 +1,670 @@
+/** \file lv_pngle_private.h
+ *  \brief Internal definitions shared by lv_pngle modules.
+ *
+ *  Author: Vincent Paeder
+ *  License: MIT
+ */
+#pragma once
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include "lvgl.h"
+#include "lv_pngle.h"
+#include "external/src/pngle.h"
+
+#define PNGLE_BUF_SIZE 1024 ///< Size of buffer used to feed Pngle
+#define PNGLE_FEED_SIZE 64 ///< Size of data slices fed to Pngle when decoding row by row
+#define PNGLE_PALETTE_COLORS 256 ///< Number of colors in palette of indexed images
+
+#if LV_PNGLE_USE_LVGL_V9
+#ifndef LV_RES_OK
+#define LV_RES_OK LV_RESULT_OK ///< LVGL v8 name of successful result
+#define LV_RES_INV LV_RESULT_INVALID ///< LVGL v8 name of failed result
+#define lv_res_t lv_result_t ///< LVGL v8 name of result type
+#endif
+#define PNGLE_MALLOC lv_malloc ///< Memory allocation function
+#define PNGLE_FREE lv_free ///< Memory release function
+#if LV_COLOR_DEPTH == 16
+#define PNGLE_CF LV_COLOR_FORMAT_RGB565A8 ///< Color format of decoded images
+#define PNGLE_COLOR_SIZE 2 ///< Number of bytes per pixel in color data
+#define PNGLE_PLANAR_ALPHA 1 ///< If 1, alpha channel is stored separately from color data
+#else
+#define PNGLE_CF LV_COLOR_FORMAT_ARGB8888 ///< Color format of decoded images
+#define PNGLE_COLOR_SIZE 4 ///< Number of bytes per pixel in color data
+#define PNGLE_PLANAR_ALPHA 0 ///< If 1, alpha channel is stored separately from color data
+#endif
+#else
+#define PNGLE_MALLOC lv_mem_alloc ///< Memory allocation function
+#define PNGLE_FREE lv_mem_free ///< Memory release function
+#define PNGLE_COLOR_SIZE LV_IMG_PX_SIZE_ALPHA_BYTE ///< Number of bytes per pixel in color data
+#define PNGLE_PLANAR_ALPHA 0 ///< If 1, alpha channel is stored separately from color data
+#endif
+#if LV_PNGLE_USE_LVGL_V9
+#define PNGLE_ZOOM_NONE LV_SCALE_NONE ///< Zoom factor for 100%
+#else
+#define PNGLE_ZOOM_NONE LV_IMG_ZOOM_NONE ///< Zoom factor for 100%
+#endif
+#define PNGLE_PX_SIZE (PNGLE_COLOR_SIZE + PNGLE_PLANAR_ALPHA) ///< Number of bytes per pixel, alpha included
+
+#if LV_PNGLE_USE_ARENA
+#undef PNGLE_MALLOC
+#undef PNGLE_FREE
+#define PNGLE_MALLOC _lv_pngle_arena_alloc ///< Memory allocation function
+#define PNGLE_FREE _lv_pngle_arena_free ///< Memory release function
+#define PNGLE_ARENA_STATE_SIZE (45*1024) ///< Upper bound of the memory a Pngle instance takes (inflate window and Huffman tables)
+#define PNGLE_ARENA_OVERHEAD 16 ///< Upper bound of the arena memory an allocation takes besides its data
+
+/** \brief Allocate memory from the arena.
+ *  \param size: number of bytes.
+ *  \returns pointer to memory, or NULL if the arena can't hold it.
+ */
+void * _lv_pngle_arena_alloc(size_t size);
+
+/** \brief Release memory allocated from the arena.
+ *  \param p: pointer to memory (may be NULL).
+ */
+void _lv_pngle_arena_free(void * p);
+
+/** \brief Check that the arena can hold what an image takes, so that decoding fails before it starts otherwise.
+ *  \param need: total number of bytes needed, arena overhead included (see lv_pngle_arena_need).
+ *  \param largest: size of the largest allocation.
+ *  \returns true if the arena has enough free memory, false otherwise.
+ */
+bool _lv_pngle_arena_fits(uint32_t need, uint32_t largest);
+#endif
+
+/** \brief Allocation function of Pngle (calloc in pngle.c): from the arena if enabled, from the C library otherwise.
+ *  \param n: number of elements.
+ *  \param size: size of an element.
+ *  \returns pointer to zeroed memory, or NULL if failed.
+ */
+void * _lv_pngle_calloc(size_t n, size_t size);
+
+/** \brief Release function of Pngle (free in pngle.c).
+ *  \param p: pointer to memory (may be NULL).
+ */
+void _lv_pngle_free(void * p);
+
+#if LV_PNGLE_USE_PALETTE
+#if LV_PNGLE_USE_LVGL_V9 || LV_COLOR_DEPTH != 8
+#error "LV_PNGLE_USE_PALETTE requires LVGL v8 with 8-bit colors"
+#endif
+#define PNGLE_LUT_SHIFT (8 - LV_PNGLE_PALETTE_LUT_BITS) ///< Bits dropped from color channels to index palette lookup table
+
+/** \brief Lookup table from quantized RGB values to palette indices, NULL if no palette is set. */
+extern const uint8_t * _lv_pngle_palette_lut;
+
+/** \brief Palette colors, as RGB values. */
+extern uint8_t _lv_pngle_palette_rgb[PNGLE_PALETTE_COLORS*3];
+
+/** \brief Get the palette index of a color. A palette must be set.
+ *  \param rgba: pointer to pixel value.
+ *  \returns palette index.
+ */
+static inline uint8_t _lv_pngle_palette_index(const uint8_t * rgba) {
+    return _lv_pngle_palette_lut[((rgba[0] >> PNGLE_LUT_SHIFT) << (2*LV_PNGLE_PALETTE_LUT_BITS))
+                                 | ((rgba[1] >> PNGLE_LUT_SHIFT) << LV_PNGLE_PALETTE_LUT_BITS)
+                                 | (rgba[2] >> PNGLE_LUT_SHIFT)];
+}
+#endif
+
+#if !LV_PNGLE_USE_LVGL_V9
+/** \brief Make an LVGL color from a pixel, mapped to the global palette if one is set.
+ *  \param rgba: pointer to pixel value.
+ *  \returns color.
+ */
+static inline lv_color_t _lv_pngle_make_color(const uint8_t * rgba) {
+#if LV_PNGLE_USE_PALETTE
+    if (_lv_pngle_palette_lut != NULL) {
+        lv_color_t col;
+        col.full = _lv_pngle_palette_index(rgba);
+        return col;
+    }
+#endif
+    return lv_color_make(rgba[0], rgba[1], rgba[2]);
+}
+#endif
+
+/** \brief A structure to communicate data and useful flags with Pngle. */
+typedef struct _lv_pngle_data_t {
+    /** \brief If true, header parsing is done. */
+    bool hdr_ready;
+
+    /** \brief If true, data parsing is done. */
+    bool data_ready;
+
+    /** \brief If true, image is interlaced and pixels don't arrive in row order. */
+    bool interlaced;
+
+    /** \brief Image width. */
+    uint32_t width;
+
+    /** \brief First image row stored in data buffer. */
+    int32_t first_row;
+
+    /** \brief Number of rows that fit in data buffer (rows are stored in a ring in streaming mode). */
+    int32_t n_rows;
+
+    /** \brief Last row fully received from Pngle (-1 if none). */
+    int32_t last_row;
+
+    /** \brief Row of the last pixel received from Pngle (-1 if none). */
+    int32_t cur_y;
+
+    /** \brief If true, some received rows didn't fit in data buffer (used in streaming mode only). */
+    bool dropped;
+
+    /** \brief First column converted (used in streaming mode only). */
+    uint32_t col_first;
+
+    /** \brief Column after the last one converted (used in streaming mode only). */
+    uint32_t col_end;
+
+    /** \brief Pointer to current row in data buffer, NULL if current row isn't kept (used in streaming mode only). */
+    uint8_t * row;
+
+    /** \brief Pointer to current row in alpha plane (used in streaming mode only). */
+    uint8_t * row_alpha;
+
+    /** \brief Format of data buffer (lv_pngle_format_t; streaming mode uses default format only). */
+    uint8_t format;
+
+    /** \brief Palette, as BGRA values (indexed format only). */
+    uint8_t * palette;
+
+    /** \brief Number of colors in palette (indexed format only). */
+    uint16_t n_colors;
+
+    /** \brief Palette index of the last pixel (indexed format only). */
+    uint8_t last_index;
+
+    /** \brief If true, image has more colors than palette can hold (indexed format only). */
+    bool overflow;
+
+    /** \brief Tint color baked into pixels, as RGB values. */
+    uint8_t tint[3];
+
+    /** \brief Tint intensity (0: none, 255: pixels take the tint color). */
+    uint8_t tint_mix;
+
+    /** \brief Opacity baked into pixels. */
+    uint8_t opa;
+
+    /** \brief Pointer to data buffer (may be NULL in full decoding mode if px_cb stores pixels itself). */
+    uint8_t * data;
+
+    /** \brief Number of bytes between two rows in data buffer. */
+    uint32_t stride;
+
+    /** \brief Pointer to alpha plane (planar color formats only, NULL otherwise). */
+    uint8_t * alpha;
+
+    /** \brief Number of bytes between two rows in alpha plane. */
+    uint32_t alpha_stride;
+
+    /** \brief Function called with each pixel stored in full decoding mode (optional). */
+    void (*px_cb)(struct _lv_pngle_data_t * ud, uint32_t x, uint32_t y, const uint8_t * rgba);
+
+    /** \brief Data for px_cb. */
+    void * user_data;
+
+} lv_pngle_data_t;
+
+/** \brief Convert a pixel to LVGL color format.
+ *  \param px: pointer to target color data.
+ *  \param a: pointer to target alpha value (planar color formats only).
+ *  \param rgba: pointer to pixel value.
+ */
+static inline void _lv_pngle_convert_pixel(uint8_t * px, uint8_t * a, const uint8_t * rgba) {
+#if LV_PNGLE_USE_LVGL_V9
+#if PNGLE_PLANAR_ALPHA
+    uint16_t col = ((rgba[0] & 0xf8) << 8) | ((rgba[1] & 0xfc) << 3) | ((rgba[2] & 0xf8) >> 3);
+    *px++ = col & 0xff;
+    *px++ = col >> 8;
+    *a = rgba[3];
+#else
+    LV_UNUSED(a);
+    *px++ = rgba[2];
+    *px++ = rgba[1];
+    *px++ = rgba[0];
+    *px++ = rgba[3];
+#endif
+#else
+    LV_UNUSED(a);
+#if LV_COLOR_DEPTH == 32
+    *px++ = rgba[2];
+    *px++ = rgba[1];
+    *px++ = rgba[0];
+    *px++ = rgba[3];
+#elif LV_COLOR_DEPTH == 16
+    uint16_t col = ((rgba[0] & 0xf8) << 8) | ((rgba[1] & 0xfc) << 3) | ((rgba[2] & 0xf8) >> 3);
+    *px++ = col & 0xff;
+    *px++ = col >> 8;
+    *px++ = rgba[3];
+#elif LV_COLOR_DEPTH == 8
+    uint8_t col = (rgba[0] & 0xe0) | ((rgba[1] & 0xe0) >> 3) | ((rgba[2] & 0xc0) >> 6);
+#if LV_PNGLE_USE_PALETTE
+    if (_lv_pngle_palette_lut != NULL) col = _lv_pngle_palette_index(rgba);
+#endif
+    *px++ = col;
+    *px++ = rgba[3];
+#elif LV_COLOR_DEPTH == 1
+    uint8_t col = (rgba[0] | rgba[1] | rgba[2]) & 0x80;
+    *px++ = col >> 7;
+    *px++ = rgba[3];
+#endif
+#endif
+}
+
+/** \brief Convert a pixel from LVGL color format back to RGBA.
+ *  \param px: pointer to color data.
+ *  \param a: pointer to alpha value (planar color formats only).
+ *  \param rgba: target for pixel value.
+ */
+static inline void _lv_pngle_unpack_pixel(const uint8_t * px, const uint8_t * a, uint8_t * rgba) {
+#if LV_PNGLE_USE_LVGL_V9
+#if PNGLE_PLANAR_ALPHA
+    uint16_t col = px[0] | (px[1] << 8);
+    rgba[0] = ((col >> 8) & 0xf8) | (col >> 13);
+    rgba[1] = ((col >> 3) & 0xfc) | ((col >> 9) & 0x03);
+    rgba[2] = ((col << 3) & 0xf8) | ((col >> 2) & 0x07);
+    rgba[3] = *a;
+#else
+    LV_UNUSED(a);
+    rgba[0] = px[2];
+    rgba[1] = px[1];
+    rgba[2] = px[0];
+    rgba[3] = px[3];
+#endif
+#else
+    LV_UNUSED(a);
+#if LV_COLOR_DEPTH == 32
+    rgba[0] = px[2];
+    rgba[1] = px[1];
+    rgba[2] = px[0];
+    rgba[3] = px[3];
+#elif LV_COLOR_DEPTH == 16
+    uint16_t col = px[0] | (px[1] << 8);
+    rgba[0] = ((col >> 8) & 0xf8) | (col >> 13);
+    rgba[1] = ((col >> 3) & 0xfc) | ((col >> 9) & 0x03);
+    rgba[2] = ((col << 3) & 0xf8) | ((col >> 2) & 0x07);
+    rgba[3] = px[2];
+#elif LV_COLOR_DEPTH == 8
+#if LV_PNGLE_USE_PALETTE
+    if (_lv_pngle_palette_lut != NULL) {
+        memcpy(rgba, _lv_pngle_palette_rgb + px[0]*3, 3);
+        rgba[3] = px[1];
+        return;
+    }
+#endif
+    rgba[0] = (px[0] & 0xe0) | ((px[0] & 0xe0) >> 3) | (px[0] >> 6);
+    rgba[1] = ((px[0] & 0x1c) << 3) | (px[0] & 0x1c) | ((px[0] & 0x1c) >> 3);
+    rgba[2] = (px[0] & 0x03) * 0x55;
+    rgba[3] = px[1];
+#elif LV_COLOR_DEPTH == 1
+    rgba[0] = rgba[1] = rgba[2] = px[0] ? 0xff : 0x00;
+    rgba[3] = px[1];
+#endif
+#endif
+}
+
+/** \brief Initialize a data structure to interact with Pngle.
+ *  \param ud: pointer to the data structure to initialize.
+ *  \param w: image width.
+ *  \param h: image height.
+ */
+void _lv_pngle_data_init(lv_pngle_data_t * ud, uint32_t w, uint32_t h);
+
+/** \brief Get output format requested for an image source.
+ *  \param src: pointer to image source.
+ *  \returns requested format, LV_PNGLE_FORMAT_AUTO if source isn't wrapped with lv_pngle_src_init.
+ */
+lv_pngle_format_t _lv_pngle_get_format(const void * src);
+
+/** \brief Decoding options of an image, from its lvGL chunk and its wrapper. */
+typedef struct _lv_pngle_hints_t {
+    /** \brief Requested output format. */
+    lv_pngle_format_t format;
+
+    /** \brief Decoding mode (lv_pngle_hint_mode_t; always 0 if hints are disabled). */
+    uint8_t mode;
+
+    /** \brief Cache priority: decoding time is weighted priority+1 times. */
+    uint8_t priority;
+} lv_pngle_hints_t;
+
+/** \brief Get tint and opacity requested for an image source.
+ *  \param src: pointer to image source.
+ *  \param ud: target data structure (left unchanged if source isn't wrapped with lv_pngle_src_init).
+ */
+void _lv_pngle_get_tint(const void * src, lv_pngle_data_t * ud);
+
+/** \brief Where PNG data is read from. */
+typedef struct _lv_pngle_input_t {
+    /** \brief File path (file sources only), NULL otherwise. */
+    const char * fn;
+
+    /** \brief Pointer to image data (memory sources only, e.g. descriptor data or memory-mapped flash), NULL otherwise. */
+    const uint8_t * data;
+
+    /** \brief Size of image data (memory sources, and callback sources if known), 0 if unknown. */
+    uint32_t size;
+
+    /** \brief Read function (callback sources only), NULL otherwise. */
+    lv_pngle_read_cb_t read_cb;
+
+    /** \brief User data passed to read function. */
+    void * user_data;
+
+    /** \brief Image width, if known without reading image data (0 otherwise). */
+    uint32_t w;
+
+    /** \brief Image height, if known without reading image data. */
+    uint32_t h;
+} lv_pngle_input_t;
+
+/** \brief Reader over PNG data. Memory is read in place, files and read callbacks through a buffer. */
+typedef struct _lv_pngle_reader_t {
+    /** \brief Input read. */
+    lv_pngle_input_t in;
+
+    /** \brief Image file (file sources only). */
+    lv_fs_file_t f;
+
+    /** \brief If true, file is open. */
+    bool f_open;
+
+    /** \brief Position of file (file sources only). */
+    uint32_t f_pos;
+
+    /** \brief Position of next byte to read. */
+    uint32_t pos;
+
+    /** \brief Position in input of the first byte of buffer. */
+    uint32_t buf_pos;
+
+    /** \brief Number of valid bytes in buffer. */
+    uint32_t buf_len;
+
+    /** \brief If true, input ends at the end of valid bytes in buffer. */
+    bool eof;
+
+    /** \brief Buffer (file and callback sources only). */
+    uint8_t buf[PNGLE_BUF_SIZE];
+} lv_pngle_reader_t;
+
+/** \brief Resolve an LVGL image source into an input to read PNG data from.
+ *  Sources wrapped with lv_pngle_src_init are resolved to the wrapped source.
+ *  \param src: pointer to image source (image descriptor or file path).
+ *  \param in: target for input.
+ *  \returns LV_RES_OK if source may hold a PNG image, LV_RES_INV otherwise.
+ */
+lv_res_t _lv_pngle_get_src(const void * src, lv_pngle_input_t * in);
+
+/** \brief Read PNG image size.
+ *  \param in: input to read from.
+ *  \param w: target for image width.
+ *  \param h: target for image height.
+ *  \returns LV_RES_OK if successful, LV_RES_INV if failed.
+ */
+lv_res_t _lv_pngle_read_header(const lv_pngle_input_t * in, uint32_t * w, uint32_t * h);
+
+/** \brief Open a reader.
+ *  \param r: pointer to reader.
+ *  \param in: input to read from.
+ *  \returns LV_RES_OK if successful, LV_RES_INV if input can't be read.
+ */
+lv_res_t _lv_pngle_reader_open(lv_pngle_reader_t * r, const lv_pngle_input_t * in);
+
+/** \brief Close a reader.
+ *  \param r: pointer to reader.
+ */
+void _lv_pngle_reader_close(lv_pngle_reader_t * r);
+
+/** \brief Get a pointer to the next bytes without consuming them. Memory is returned in place,
+ *  other inputs from the buffer, which is topped up when it holds fewer bytes than requested.
+ *  \param r: pointer to reader.
+ *  \param data: target for pointer to data, valid until the next reader call.
+ *  \param len: number of bytes wanted (at most PNGLE_BUF_SIZE).
+ *  \returns number of bytes available, fewer than len only at end of data (0 if failed).
+ */
+uint32_t _lv_pngle_reader_peek(lv_pngle_reader_t * r, const uint8_t ** data, uint32_t len);
+
+/** \brief Read bytes.
+ *  \param r: pointer to reader.
+ *  \param buf: target buffer.
+ *  \param len: number of bytes to read.
+ *  \returns LV_RES_OK if successful, LV_RES_INV if data ended.
+ */
+lv_res_t _lv_pngle_reader_read(lv_pngle_reader_t * r, void * buf, uint32_t len);
+
+/** \brief Feed next bytes to Pngle, and consume what it took.
+ *  \param r: pointer to reader.
+ *  \param pngle: pointer to a Pngle instance.
+ *  \param len: maximum number of bytes fed (at most PNGLE_BUF_SIZE).
+ *  \returns LV_RES_OK if successful, LV_RES_INV if Pngle failed or if data ended.
+ */
+lv_res_t _lv_pngle_reader_feed(lv_pngle_reader_t * r, pngle_t * pngle, uint32_t len);
+
+/** \brief Get input size.
+ *  \param r: pointer to reader.
+ *  \param size: target for size.
+ *  \returns LV_RES_OK if successful, LV_RES_INV if size is unknown.
+ */
+lv_res_t _lv_pngle_reader_get_size(lv_pngle_reader_t * r, uint32_t * size);
+
+/** \brief Get position of next byte to read.
+ *  \param r: pointer to reader.
+ *  \returns position.
+ */
+static inline uint32_t _lv_pngle_reader_tell(const lv_pngle_reader_t * r) {
+    return r->pos;
+}
+
+/** \brief Move to another position; data is read from there on next read.
+ *  \param r: pointer to reader.
+ *  \param pos: position of next byte to read.
+ */
+static inline void _lv_pngle_reader_seek(lv_pngle_reader_t * r, uint32_t pos) {
+    r->pos = pos;
+}
+
+/** \brief Function storing a decoded pixel.
+ *  \param ud: data structure describing the target buffer.
+ *  \param x: horizontal coordinate of pixel.
+ *  \param y: vertical coordinate of pixel.
+ *  \param rgba: pointer to pixel value (may be modified).
+ */
+typedef void (*lv_pngle_put_cb_t)(lv_pngle_data_t * ud, uint32_t x, uint32_t y, uint8_t * rgba);
+
+/** \brief Store a decoded pixel in the buffer described by a data structure, in its output format,
+ *  with tint and opacity applied, and pass it to px_cb.
+ *  \param ud: data structure describing the target buffer.
+ *  \param x: horizontal coordinate of pixel.
+ *  \param y: vertical coordinate of pixel.
+ *  \param rgba: pointer to pixel value (tint and opacity are applied in place).
+ */
+void _lv_pngle_put_pixel(lv_pngle_data_t * ud, uint32_t x, uint32_t y, uint8_t * rgba);
+
+/** \brief Set up a Pngle instance to decode a whole image to the buffer described by a data structure.
+ *  \param pngle: pointer to a Pngle instance.
+ *  \param ud: data structure describing the target buffer.
+ */
+void _lv_pngle_setup(pngle_t * pngle, lv_pngle_data_t * ud);
+
+/** \brief Decode a whole PNG (or QOI) image.
+ *  \param in: input to read from.
+ *  \param ud: data structure describing the target buffer.
+ *  \returns LV_RES_OK if successful, LV_RES_INV if failed.
+ */
+lv_res_t _lv_pngle_decode(const lv_pngle_input_t * in, lv_pngle_data_t * ud);
+
+#if LV_PNGLE_USE_COST
+/** \brief Record a measured decoding time to calibrate cost estimates.
+ *  \param ihdr: pointer to image header.
+ *  \param data_size: number of bytes of PNG data read.
+ *  \param elapsed: decoding time, in milliseconds.
+ */
+void _lv_pngle_cost_record(const pngle_ihdr_t * ihdr, uint32_t data_size, uint32_t elapsed);
+#endif
+
+#if LV_PNGLE_USE_QUEUE
+/** \brief Take an image decoded in advance by the decode queue.
+ *  \param src: pointer to image source.
+ *  \param elapsed: target for the time spent decoding it, in milliseconds.
+ *  \returns decoded image (lv_draw_buf_t with LVGL v9, data buffer with LVGL v8) now owned
+ *  by the caller, or NULL if none is ready.
+ */
+void * _lv_pngle_queue_take(const void * src, uint32_t * elapsed);
+#endif
+
+#if LV_PNGLE_USE_MANIFEST
+/** \brief Get the size of an image from the asset manifest.
+ *  The file size is checked against the entry the first time the entry is used.
+ *  \param fn: file path, with LVGL drive letter.
+ *  \param w: target for image width.
+ *  \param h: target for image height.
+ *  \returns LV_RES_OK if successful, LV_RES_INV if file isn't in the manifest or changed.
+ */
+lv_res_t _lv_pngle_manifest_get_size(const char * fn, uint32_t * w, uint32_t * h);
+
+/** \brief Get chunk offsets of an image from the asset manifest, after checking that its file didn't change.
+ *  \param fn: file path, with LVGL drive letter.
+ *  \param file_size: current file size (entries with another size are dropped).
+ *  \param hdr_end: target for offset after the last chunk needed before image data.
+ *  \param idat_offset: target for offset of the first IDAT chunk.
+ *  \returns LV_RES_OK if successful, LV_RES_INV if file isn't in the manifest or changed.
+ */
+lv_res_t _lv_pngle_manifest_get_offsets(const char * fn, uint32_t file_size, uint32_t * hdr_end, uint32_t * idat_offset);
+
+/** \brief Ignore the manifest entry of a file from now on, after the file changed.
+ *  \param fn: file path, with LVGL drive letter.
+ */
+void _lv_pngle_manifest_forget(const char * fn);
+#endif
+
+#if LV_PNGLE_USE_BUNDLE
+/** \brief Get the input of a bundled image.
+ *  \param fn: image path, with bundle drive letter.
+ *  \param in: target for input (size filled as well).
+ *  \returns LV_RES_OK if successful, LV_RES_INV if image isn't in the open bundle.
+ */
+lv_res_t _lv_pngle_bundle_get_src(const char * fn, lv_pngle_input_t * in);
+#endif
+
+#if LV_PNGLE_USE_QOI
+/** \brief State of a QOI decoding, kept between slices of data. */
+typedef struct _lv_pngle_qoi_t {
+    /** \brief Previously seen pixels, as RGBA values, indexed by color hash. */
+    uint8_t index[64*4];
+
+    /** \brief Last decoded pixel, as RGBA values. */
+    uint8_t px[4];
+
+    /** \brief Number of repetitions of last pixel still to be output. */
+    uint8_t run;
+
+    /** \brief Image width. */
+    uint32_t w;
+
+    /** \brief Image height. */
+    uint32_t h;
+
+    /** \brief Horizontal coordinate of next pixel. */
+    uint32_t x;
+
+    /** \brief Vertical coordinate of next pixel. */
+    uint32_t y;
+} lv_pngle_qoi_t;
+
+/** \brief Check whether data read next holds a QOI image.
+ *  \param r: pointer to reader.
+ *  \returns true if data starts with QOI magic number.
+ */
+bool _lv_pngle_qoi_detect(lv_pngle_reader_t * r);
+
+/** \brief Read QOI image size, without consuming data.
+ *  \param r: pointer to reader, at start of image.
+ *  \param w: target for image width.
+ *  \param h: target for image height.
+ *  \returns LV_RES_OK if successful, LV_RES_INV if data isn't a QOI image.
+ */
+lv_res_t _lv_pngle_qoi_read_size(lv_pngle_reader_t * r, uint32_t * w, uint32_t * h);
+
+/** \brief (Re)start decoding a QOI image from its beginning: read its header and reset state.
+ *  \param q: pointer to decoding state.
+ *  \param r: pointer to reader.
+ *  \param ud: data structure describing the target buffer (hdr_ready is set).
+ *  \returns LV_RES_OK if successful, LV_RES_INV if header is invalid.
+ */
+lv_res_t _lv_pngle_qoi_start(lv_pngle_qoi_t * q, lv_pngle_reader_t * r, lv_pngle_data_t * ud);
+
+/** \brief Decode the pixels held by next bytes of a QOI image, and consume these bytes.
+ *  Sets data_ready once the last pixel is decoded.
+ *  \param q: pointer to decoding state.
+ *  \param r: pointer to reader.
+ *  \param ud: data structure describing the target buffer.
+ *  \param put: function storing decoded pixels.
+ *  \param len: maximum number of bytes decoded (at most PNGLE_BUF_SIZE).
+ *  \returns LV_RES_OK if successful, LV_RES_INV if data ended.
+ */
+lv_res_t _lv_pngle_qoi_feed(lv_pngle_qoi_t * q, lv_pngle_reader_t * r, lv_pngle_data_t * ud, lv_pngle_put_cb_t put, uint32_t len);
+
+/** \brief Decode a whole QOI image.
+ *  \param r: pointer to reader, at start of image.
+ *  \param ud: data structure describing the target buffer.
+ *  \returns LV_RES_OK if successful, LV_RES_INV if failed.
+ */
+lv_res_t _lv_pngle_qoi_decode(lv_pngle_reader_t * r, lv_pngle_data_t * ud);
+#endif
+
+#if LV_PNGLE_USE_ROW_HASH
+/** \brief Record row hashes of an image decoded to a full buffer, noting the rows that changed since its previous decoding.
+ *  \param src: pointer to image source.
+ *  \param ud: data structure describing the decoded buffer.
+ *  \param row_bytes: number of bytes of a row in data (alpha values of planar formats excluded).
+ */
+void _lv_pngle_rowhash_record(const void * src, const lv_pngle_data_t * ud, uint32_t row_bytes);
+#endif
+
+#if LV_PNGLE_USE_POLICY
+/** \brief Decide whether an image is decoded row by row, and count it as opened.
+ *  \param src: pointer to image source.
+ *  \param w: image width.
+ *  \param h: image height.
+ *  \returns true if image is to be decoded row by row.
+ */
+bool _lv_pngle_policy_use_stream(const void * src, uint32_t w, uint32_t h);
+
+/** \brief Get the cache priority given to an image by the decoding policy, after its last decision.
+ *  \param src: pointer to image source.
+ *  \returns priority added to the one of decoding hints.
+ */
+uint8_t _lv_pngle_policy_get_priority(const void * src);
+
+/** \brief Record the time taken to decode an image to a full buffer.
+ *  \param src: pointer to image source.
+ *  \param elapsed: decoding time, in milliseconds.
+ */
+void _lv_pngle_policy_record_decode(const void * src, uint32_t elapsed);
+
+/** \brief Record the number of rows decoded while an image was streamed, when it's closed.
+ *  \param src: pointer to image source.
+ *  \param rows: number of rows decoded, redraws included.
+ */
+void _lv_pngle_policy_record_stream(const void * src, uint32_t rows);
+#endif
+
+#if LV_PNGLE_USE_WATCH
+/** \brief Watch a PNG file, so that cached copies of it are dropped when it changes.
+ *  Does nothing if the file is already watched or if watching isn't started.
+ *  \param fn: file path, with LVGL drive letter.
+ */
+void _lv_pngle_watch_add(const char * fn);
+#endif
+
+#ifdef __cplusplus
+} /* extern "C" */
+#endif
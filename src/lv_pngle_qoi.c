@@ -0,0 +1,160 @@
+/** \file lv_pngle_qoi.c
+ *  \brief Decoding of QOI images ("Quite OK Image" format), with the same output
+ *  as PNG images: pixels go through the same conversion, fully or row by row.
+ *
+ *  QOI file layout: magic "qoif" | width (4 bytes, big-endian) | height (4 bytes,
+ *  big-endian) | channels (1 byte) | colorspace (1 byte) | pixel operations |
+ *  end marker (7 zero bytes and a 1).
+ *
+ *  Author: Vincent Paeder
+ *  License: MIT
+ */
+#include "lv_pngle_private.h"
+
+#if LV_PNGLE_USE_QOI
+
+#define QOI_MAGIC "qoif" ///< Magic number of QOI images
+#define QOI_HDR_SIZE 14 ///< Size of QOI header
+#define QOI_OP_INDEX 0x00 ///< Pixel taken from index (2-bit tag)
+#define QOI_OP_DIFF 0x40 ///< Small difference to last pixel (2-bit tag)
+#define QOI_OP_LUMA 0x80 ///< Difference to last pixel driven by green channel (2-bit tag)
+#define QOI_OP_RUN 0xc0 ///< Repetition of last pixel (2-bit tag)
+#define QOI_OP_RGB 0xfe ///< New color, same alpha (8-bit tag)
+#define QOI_OP_RGBA 0xff ///< New color and alpha (8-bit tag)
+#define QOI_TAG_MASK 0xc0 ///< Mask of 2-bit tags
+
+
+/** \brief Read a big-endian 32-bit integer.
+ *  \param buf: pointer to data.
+ *  \returns integer value.
+ */
+static uint32_t qoi_be32(const uint8_t * buf) {
+    return ((uint32_t)buf[0] << 24) | ((uint32_t)buf[1] << 16) | ((uint32_t)buf[2] << 8) | buf[3];
+}
+
+/** \brief Get the length of a pixel operation.
+ *  \param op: first byte of operation.
+ *  \returns number of bytes.
+ */
+static uint8_t qoi_op_len(uint8_t op) {
+    if (op == QOI_OP_RGBA) return 5;
+    if (op == QOI_OP_RGB) return 4;
+    return (op & QOI_TAG_MASK) == QOI_OP_LUMA ? 2 : 1;
+}
+
+/** \brief Apply a pixel operation to last pixel.
+ *  \param q: pointer to decoding state.
+ *  \param op: pointer to operation bytes.
+ */
+static void qoi_apply(lv_pngle_qoi_t * q, const uint8_t * op) {
+    uint8_t * px = q->px;
+    if (op[0] == QOI_OP_RGBA) {
+        memcpy(px, op + 1, 4);
+    } else if (op[0] == QOI_OP_RGB) {
+        memcpy(px, op + 1, 3);
+    } else {
+        switch (op[0] & QOI_TAG_MASK) {
+        case QOI_OP_INDEX:
+            memcpy(px, q->index + (op[0] & 0x3f)*4, 4);
+            break;
+        case QOI_OP_DIFF:
+            px[0] += ((op[0] >> 4) & 0x03) - 2;
+            px[1] += ((op[0] >> 2) & 0x03) - 2;
+            px[2] += (op[0] & 0x03) - 2;
+            break;
+        case QOI_OP_LUMA: {
+            int dg = (op[0] & 0x3f) - 32;
+            px[0] += dg - 8 + ((op[1] >> 4) & 0x0f);
+            px[1] += dg;
+            px[2] += dg - 8 + (op[1] & 0x0f);
+            break;
+        }
+        case QOI_OP_RUN:
+            // this pixel, then as many repetitions as given
+            q->run = op[0] & 0x3f;
+            break;
+        }
+    }
+    uint8_t slot = (px[0]*3 + px[1]*5 + px[2]*7 + px[3]*11) % 64;
+    memcpy(q->index + slot*4, px, 4);
+}
+
+
+bool _lv_pngle_qoi_detect(lv_pngle_reader_t * r) {
+    const uint8_t * data;
+    return _lv_pngle_reader_peek(r, &data, 4) == 4 && !memcmp(data, QOI_MAGIC, 4);
+}
+
+
+lv_res_t _lv_pngle_qoi_read_size(lv_pngle_reader_t * r, uint32_t * w, uint32_t * h) {
+    const uint8_t * data;
+    if (_lv_pngle_reader_peek(r, &data, QOI_HDR_SIZE) != QOI_HDR_SIZE || memcmp(data, QOI_MAGIC, 4)) return LV_RES_INV;
+    *w = qoi_be32(data + 4);
+    *h = qoi_be32(data + 8);
+    return LV_RES_OK;
+}
+
+
+lv_res_t _lv_pngle_qoi_start(lv_pngle_qoi_t * q, lv_pngle_reader_t * r, lv_pngle_data_t * ud) {
+    uint8_t hdr[QOI_HDR_SIZE];
+    _lv_pngle_reader_seek(r, 0);
+    if (_lv_pngle_reader_read(r, hdr, QOI_HDR_SIZE) != LV_RES_OK || memcmp(hdr, QOI_MAGIC, 4) ||
+        qoi_be32(hdr + 4) == 0 || qoi_be32(hdr + 8) == 0) {
+        LV_LOG_ERROR("couldn't read QOI header.\n");
+        return LV_RES_INV;
+    }
+    memset(q, 0, sizeof(lv_pngle_qoi_t));
+    q->w = qoi_be32(hdr + 4);
+    q->h = qoi_be32(hdr + 8);
+    q->px[3] = 0xff;
+    LV_LOG_INFO("QOI image header read succesfully. Size: %d x %d\n", q->w, q->h);
+    ud->hdr_ready = true;
+    return LV_RES_OK;
+}
+
+
+lv_res_t _lv_pngle_qoi_feed(lv_pngle_qoi_t * q, lv_pngle_reader_t * r, lv_pngle_data_t * ud, lv_pngle_put_cb_t put, uint32_t len) {
+    const uint8_t * buf;
+    uint32_t n = _lv_pngle_reader_peek(r, &buf, len);
+    uint32_t i = 0;
+    bool progress = false;
+    while (q->y < q->h) {
+        if (q->run > 0) {
+            q->run--;
+        } else {
+            // operations are only decoded whole; the rest is left for next call
+            if (i >= n || i + qoi_op_len(buf[i]) > n) break;
+            qoi_apply(q, buf + i);
+            i += qoi_op_len(buf[i]);
+        }
+        // pixel is passed by copy, as it may be modified
+        uint8_t rgba[4];
+        memcpy(rgba, q->px, 4);
+        put(ud, q->x, q->y, rgba);
+        progress = true;
+        if (++q->x == q->w) {
+            q->x = 0;
+            q->y++;
+        }
+    }
+    _lv_pngle_reader_seek(r, _lv_pngle_reader_tell(r) + i);
+    if (q->y == q->h) {
+        ud->data_ready = true;
+    } else if (!progress) {
+        LV_LOG_ERROR("QOI data ended prematurely.\n");
+        return LV_RES_INV;
+    }
+    return LV_RES_OK;
+}
+
+
+lv_res_t _lv_pngle_qoi_decode(lv_pngle_reader_t * r, lv_pngle_data_t * ud) {
+    lv_pngle_qoi_t q;
+    if (_lv_pngle_qoi_start(&q, r, ud) != LV_RES_OK) return LV_RES_INV;
+    while (!ud->data_ready) {
+        if (_lv_pngle_qoi_feed(&q, r, ud, _lv_pngle_put_pixel, PNGLE_BUF_SIZE) != LV_RES_OK) return LV_RES_INV;
+    }
+    return LV_RES_OK;
+}
+
+#endif
@@ -0,0 +1,475 @@
+/** \file lv_pngle_queue.c
+ *  \brief Prioritized decode queue with coalescing and cancellation.
+ *
+ *  Author: Vincent Paeder
+ *  License: MIT
+ */
+#include "lv_pngle_private.h"
+
+#if LV_PNGLE_USE_QUEUE
+
+/** \brief Decoding of an image, shared by all requests for its source. */
+typedef struct _queue_job_t {
+    /** \brief Next job in list. */
+    struct _queue_job_t * next;
+
+    /** \brief Image source (copy of path for file sources). */
+    const void * src;
+
+    /** \brief Copy of file path (file sources only). */
+    char * path;
+
+    /** \brief Queuing order, to serve jobs of same priority first come, first served. */
+    uint32_t seq;
+
+    /** \brief Requests served by this job. */
+    lv_pngle_request_t * requests;
+
+    /** \brief If true, decoding has started. */
+    bool started;
+
+    /** \brief Pngle instance (while decoding). */
+    pngle_t * pngle;
+
+#if LV_PNGLE_USE_QOI
+    /** \brief QOI decoding state (while decoding QOI images, pngle is then NULL). */
+    lv_pngle_qoi_t * qoi;
+#endif
+
+    /** \brief Data shared with Pngle. */
+    lv_pngle_data_t ud;
+
+    /** \brief Image width. */
+    uint32_t width;
+
+    /** \brief Image height. */
+    uint32_t height;
+
+    /** \brief Size of PNG data (0 if unknown). */
+    uint32_t data_size;
+
+    /** \brief Reader over image data. */
+    lv_pngle_reader_t r;
+
+    /** \brief Number of pixels decoded. */
+    uint32_t n_px;
+
+    /** \brief Time spent decoding, in milliseconds. */
+    uint32_t elapsed;
+
+    /** \brief Decoded image (lv_draw_buf_t with LVGL v9, data buffer with LVGL v8). */
+    void * result;
+} queue_job_t;
+
+/** \brief A decode request. */
+struct _lv_pngle_request_t {
+    /** \brief Next request of the same job. */
+    lv_pngle_request_t * next;
+
+    /** \brief Job serving the request. */
+    queue_job_t * job;
+
+    /** \brief Request priority. */
+    uint8_t prio;
+
+    /** \brief Function called when image is decoded. */
+    lv_pngle_ready_cb_t cb;
+
+    /** \brief Data for cb. */
+    void * user_data;
+};
+
+/** \brief Queue state. */
+static struct {
+    /** \brief Jobs waiting or running. */
+    queue_job_t * jobs;
+
+    /** \brief Decoded images waiting to be opened, most recent first. */
+    queue_job_t * ready;
+
+    /** \brief Timer running the queue. */
+    lv_timer_t * timer;
+
+    /** \brief Next queuing order. */
+    uint32_t seq;
+
+    /** \brief Counters. */
+    lv_pngle_queue_stats_t stats;
+} queue;
+
+
+/** \brief Check if two image sources are the same.
+ *  \param a: pointer to first image source.
+ *  \param b: pointer to second image source.
+ *  \returns true if sources are the same file or the same descriptor.
+ */
+static bool queue_same_src(const void * a, const void * b) {
+    if (a == b) return true;
+#if LV_PNGLE_USE_LVGL_V9
+    return lv_image_src_get_type(a) == LV_IMAGE_SRC_FILE && lv_image_src_get_type(b) == LV_IMAGE_SRC_FILE &&
+           !strcmp((const char*)a, (const char*)b);
+#else
+    return lv_img_src_get_type(a) == LV_IMG_SRC_FILE && lv_img_src_get_type(b) == LV_IMG_SRC_FILE &&
+           !strcmp((const char*)a, (const char*)b);
+#endif
+}
+
+/** \brief Find the job of an image source in a list.
+ *  \param list: first job of list.
+ *  \param src: pointer to image source.
+ *  \returns pointer to job, or NULL if not found.
+ */
+static queue_job_t * queue_find(queue_job_t * list, const void * src) {
+    for (queue_job_t * job = list; job != NULL; job = job->next) {
+        if (queue_same_src(job->src, src)) return job;
+    }
+    return NULL;
+}
+
+/** \brief Remove a job from a list.
+ *  \param list: pointer to first job of list.
+ *  \param job: job to remove.
+ */
+static void queue_unlink(queue_job_t ** list, queue_job_t * job) {
+    for (queue_job_t ** p = list; *p != NULL; p = &(*p)->next) {
+        if (*p == job) {
+            *p = job->next;
+            job->next = NULL;
+            return;
+        }
+    }
+}
+
+/** \brief Get the priority of a job.
+ *  \param job: pointer to job.
+ *  \returns highest priority of its requests.
+ */
+static uint8_t queue_prio(const queue_job_t * job) {
+    uint8_t prio = 0;
+    for (const lv_pngle_request_t * req = job->requests; req != NULL; req = req->next) {
+        if (req->prio > prio) prio = req->prio;
+    }
+    return prio;
+}
+
+/** \brief Release decoding resources of a job.
+ *  \param job: pointer to job.
+ */
+static void queue_stop(queue_job_t * job) {
+    _lv_pngle_reader_close(&job->r);
+    if (job->pngle != NULL) pngle_destroy(job->pngle);
+    job->pngle = NULL;
+#if LV_PNGLE_USE_QOI
+    if (job->qoi != NULL) PNGLE_FREE(job->qoi);
+    job->qoi = NULL;
+#endif
+}
+
+/** \brief Free a job and its decoded image.
+ *  \param job: pointer to job.
+ */
+static void queue_free(queue_job_t * job) {
+    queue_stop(job);
+    if (job->result != NULL) {
+#if LV_PNGLE_USE_LVGL_V9
+        lv_draw_buf_destroy((lv_draw_buf_t*)job->result);
+#else
+        PNGLE_FREE(job->result);
+#endif
+    }
+    if (job->path != NULL) PNGLE_FREE(job->path);
+    PNGLE_FREE(job);
+}
+
+/** \brief Function called with each decoded pixel.
+ *  \param ud: pointer to the data structure shared with Pngle.
+ *  \param x: horizontal coordinate of pixel.
+ *  \param y: vertical coordinate of pixel.
+ *  \param rgba: pointer to pixel value.
+ */
+static void queue_px_cb(lv_pngle_data_t * ud, uint32_t x, uint32_t y, const uint8_t * rgba) {
+    LV_UNUSED(x);
+    LV_UNUSED(y);
+    LV_UNUSED(rgba);
+    ((queue_job_t*)ud->user_data)->n_px++;
+}
+
+/** \brief Allocate image buffer and start decoding.
+ *  \param job: pointer to job.
+ *  \returns LV_RES_OK if successful, LV_RES_INV if failed.
+ */
+static lv_res_t queue_begin(queue_job_t * job) {
+    lv_pngle_input_t in;
+    job->started = true;
+    if (_lv_pngle_get_src(job->src, &in) != LV_RES_OK) return LV_RES_INV;
+    if (_lv_pngle_read_header(&in, &job->width, &job->height) != LV_RES_OK) return LV_RES_INV;
+
+    _lv_pngle_data_init(&job->ud, job->width, job->height);
+    _lv_pngle_get_tint(job->src, &job->ud);
+#if LV_PNGLE_USE_LVGL_V9
+    lv_draw_buf_t * buf = lv_draw_buf_create(job->width, job->height, PNGLE_CF, LV_STRIDE_AUTO);
+    if (buf == NULL) return LV_RES_INV;
+    job->result = buf;
+    job->ud.data = buf->data;
+    job->ud.stride = buf->header.stride;
+#if PNGLE_PLANAR_ALPHA
+    // alpha plane follows color plane, with half its stride
+    job->ud.alpha = buf->data + job->ud.stride*job->height;
+    job->ud.alpha_stride = job->ud.stride/2;
+#endif
+#else
+    uint32_t size = job->width*job->height*PNGLE_PX_SIZE;
+    job->result = PNGLE_MALLOC(size);
+    if (job->result == NULL) return LV_RES_INV;
+    memset(job->result, 0, size);
+    job->ud.data = (uint8_t*)job->result;
+    job->ud.stride = job->width*PNGLE_PX_SIZE;
+#endif
+    job->ud.px_cb = queue_px_cb;
+    job->ud.user_data = job;
+
+    if (_lv_pngle_reader_open(&job->r, &in) != LV_RES_OK) return LV_RES_INV;
+    // data size is only used for counters
+    _lv_pngle_reader_get_size(&job->r, &job->data_size);
+#if LV_PNGLE_USE_QOI
+    if (_lv_pngle_qoi_detect(&job->r)) {
+        job->qoi = (lv_pngle_qoi_t*)PNGLE_MALLOC(sizeof(lv_pngle_qoi_t));
+        if (job->qoi == NULL) return LV_RES_INV;
+        return _lv_pngle_qoi_start(job->qoi, &job->r, &job->ud);
+    }
+#endif
+
+    job->pngle = pngle_new();
+    if (job->pngle == NULL) return LV_RES_INV;
+    _lv_pngle_setup(job->pngle, &job->ud);
+    return LV_RES_OK;
+}
+
+/** \brief Decode next slice of image data.
+ *  \param job: pointer to job.
+ *  \returns LV_RES_OK if successful, LV_RES_INV if decoding failed or if data ended.
+ */
+static lv_res_t queue_feed(queue_job_t * job) {
+#if LV_PNGLE_USE_QOI
+    if (job->qoi != NULL) return _lv_pngle_qoi_feed(job->qoi, &job->r, &job->ud, _lv_pngle_put_pixel, PNGLE_BUF_SIZE);
+#endif
+    return _lv_pngle_reader_feed(&job->r, job->pngle, PNGLE_BUF_SIZE);
+}
+
+/** \brief Finish a job and notify its requests.
+ *  \param job: pointer to job.
+ *  \param ok: true if image was decoded.
+ */
+static void queue_complete(queue_job_t * job, bool ok) {
+    queue_unlink(&queue.jobs, job);
+    queue_stop(job);
+    lv_pngle_request_t * req = job->requests;
+    job->requests = NULL;
+
+    if (ok) {
+        queue.stats.completed++;
+        job->next = queue.ready;
+        queue.ready = job;
+        // drop the oldest decoded images nobody opened
+        uint8_t n = 0;
+        for (queue_job_t ** p = &queue.ready; *p != NULL;) {
+            if (++n > LV_PNGLE_QUEUE_MAX_READY) {
+                queue_job_t * old = *p;
+                *p = old->next;
+                queue_free(old);
+                queue.stats.dropped++;
+            } else {
+                p = &(*p)->next;
+            }
+        }
+    } else {
+        LV_LOG_WARN("queued PNG decoding failed.\n");
+        queue.stats.failed++;
+    }
+
+    // callbacks may queue or cancel other requests: job state is settled first
+    const void * src = job->src;
+    while (req != NULL) {
+        lv_pngle_request_t * next = req->next;
+        if (req->cb != NULL) req->cb(src, ok, req->user_data);
+        PNGLE_FREE(req);
+        req = next;
+    }
+    if (!ok) queue_free(job);
+}
+
+/** \brief Get the next job to run.
+ *  \returns pointer to job with highest priority, first queued first, or NULL if queue is empty.
+ */
+static queue_job_t * queue_next(void) {
+    queue_job_t * best = NULL;
+    uint8_t best_prio = 0;
+    for (queue_job_t * job = queue.jobs; job != NULL; job = job->next) {
+        uint8_t prio = queue_prio(job);
+        if (best == NULL || prio > best_prio || (prio == best_prio && job->seq < best->seq)) {
+            best = job;
+            best_prio = prio;
+        }
+    }
+    return best;
+}
+
+/** \brief Stop the timer running the queue.
+ */
+static void queue_stop_timer(void) {
+    if (queue.timer == NULL) return;
+#if LV_PNGLE_USE_LVGL_V9
+    lv_timer_delete(queue.timer);
+#else
+    lv_timer_del(queue.timer);
+#endif
+    queue.timer = NULL;
+}
+
+/** \brief Timer callback decoding queued images for a time slice.
+ *  \param t: pointer to timer.
+ */
+static void queue_timer_cb(lv_timer_t * t) {
+    LV_UNUSED(t);
+    uint32_t t0 = lv_tick_get();
+    while (lv_tick_elaps(t0) < LV_PNGLE_QUEUE_SLICE_MS) {
+        queue_job_t * job = queue_next();
+        if (job == NULL) {
+            queue_stop_timer();
+            return;
+        }
+        if (!job->started && queue_begin(job) != LV_RES_OK) {
+            queue_complete(job, false);
+            continue;
+        }
+        // a job preempted by a higher priority one keeps its state and resumes later
+        lv_res_t res = LV_RES_OK;
+        uint32_t t1 = lv_tick_get();
+        while (!job->ud.data_ready && res == LV_RES_OK && lv_tick_elaps(t0) < LV_PNGLE_QUEUE_SLICE_MS)
+            res = queue_feed(job);
+        job->elapsed += lv_tick_elaps(t1);
+        if (res != LV_RES_OK) queue_complete(job, false);
+        else if (job->ud.data_ready) queue_complete(job, true);
+    }
+}
+
+
+void * _lv_pngle_queue_take(const void * src, uint32_t * elapsed) {
+    queue_job_t * job = queue_find(queue.ready, src);
+    if (job == NULL) return NULL;
+    queue_unlink(&queue.ready, job);
+    void * result = job->result;
+    *elapsed = job->elapsed;
+    job->result = NULL;
+    queue_free(job);
+    return result;
+}
+
+
+lv_pngle_request_t * lv_pngle_queue_add(const void * src, lv_pngle_prio_t prio, lv_pngle_ready_cb_t cb, void * user_data) {
+    lv_pngle_format_t format = _lv_pngle_get_format(src);
+    if (format != LV_PNGLE_FORMAT_AUTO && format != LV_PNGLE_FORMAT_TRUE_COLOR_ALPHA) {
+        LV_LOG_WARN("only images decoded to default format can be queued.\n");
+        return NULL;
+    }
+    lv_pngle_request_t * req = (lv_pngle_request_t*)PNGLE_MALLOC(sizeof(lv_pngle_request_t));
+    if (req == NULL) return NULL;
+    memset(req, 0, sizeof(lv_pngle_request_t));
+    req->prio = prio;
+    req->cb = cb;
+    req->user_data = user_data;
+    queue.stats.requested++;
+
+    queue_job_t * job = queue_find(queue.jobs, src);
+    if (job != NULL) {
+        queue.stats.coalesced++;
+    } else {
+        job = (queue_job_t*)PNGLE_MALLOC(sizeof(queue_job_t));
+        if (job == NULL) {
+            PNGLE_FREE(req);
+            return NULL;
+        }
+        memset(job, 0, sizeof(queue_job_t));
+        job->src = src;
+#if LV_PNGLE_USE_LVGL_V9
+        bool is_file = lv_image_src_get_type(src) == LV_IMAGE_SRC_FILE;
+#else
+        bool is_file = lv_img_src_get_type(src) == LV_IMG_SRC_FILE;
+#endif
+        if (is_file) {
+            // path may not outlive the request
+            size_t len = strlen((const char*)src);
+            job->path = (char*)PNGLE_MALLOC(len + 1);
+            if (job->path == NULL) {
+                PNGLE_FREE(job);
+                PNGLE_FREE(req);
+                return NULL;
+            }
+            memcpy(job->path, src, len + 1);
+            job->src = job->path;
+        }
+        job->seq = queue.seq++;
+        job->next = queue.jobs;
+        queue.jobs = job;
+    }
+    req->job = job;
+    req->next = job->requests;
+    job->requests = req;
+
+    if (queue.timer == NULL) queue.timer = lv_timer_create(queue_timer_cb, LV_PNGLE_QUEUE_PERIOD, NULL);
+    return req;
+}
+
+
+void lv_pngle_queue_set_prio(lv_pngle_request_t * req, lv_pngle_prio_t prio) {
+    req->prio = prio;
+}
+
+
+void lv_pngle_queue_cancel(lv_pngle_request_t * req) {
+    queue_job_t * job = req->job;
+    for (lv_pngle_request_t ** p = &job->requests; *p != NULL; p = &(*p)->next) {
+        if (*p == req) {
+            *p = req->next;
+            break;
+        }
+    }
+    PNGLE_FREE(req);
+    if (job->requests != NULL) return;
+
+    // nobody needs this image anymore
+    if (job->started) {
+        queue.stats.cancelled_running++;
+        queue.stats.px_wasted += job->n_px;
+        queue.stats.px_avoided += job->width*job->height - job->n_px;
+        uint32_t pos = _lv_pngle_reader_tell(&job->r);
+        if (job->data_size > pos) queue.stats.bytes_avoided += job->data_size - pos;
+    } else {
+        queue.stats.cancelled_queued++;
+    }
+    queue_unlink(&queue.jobs, job);
+    queue_free(job);
+}
+
+
+void lv_pngle_queue_cancel_all(void) {
+    while (queue.jobs != NULL) {
+        queue_job_t * job = queue.jobs;
+        while (job->requests->next != NULL) lv_pngle_queue_cancel(job->requests);
+        lv_pngle_queue_cancel(job->requests);
+    }
+    while (queue.ready != NULL) {
+        queue_job_t * job = queue.ready;
+        queue.ready = job->next;
+        queue_free(job);
+        queue.stats.dropped++;
+    }
+    queue_stop_timer();
+}
+
+
+void lv_pngle_queue_get_stats(lv_pngle_queue_stats_t * stats) {
+    *stats = queue.stats;
+}
+
+#endif
@@ -0,0 +1,128 @@
+/** \file lv_pngle_reader.c
+ *  \brief Reader over PNG data from any kind of input: memory is read in place,
+ *  files and read callbacks through a buffer.
+ *
+ *  Author: Vincent Paeder
+ *  License: MIT
+ */
+#include "lv_pngle_private.h"
+
+
+/** \brief Read bytes from a buffered input (file or read callback).
+ *  \param r: pointer to reader.
+ *  \param pos: position of first byte to read.
+ *  \param buf: target buffer.
+ *  \param len: number of bytes to read.
+ *  \returns number of bytes read, less than len at end of data or if reading failed.
+ */
+static uint32_t reader_fill(lv_pngle_reader_t * r, uint32_t pos, uint8_t * buf, uint32_t len) {
+    if (r->in.read_cb != NULL) return r->in.read_cb(r->in.user_data, pos, buf, len);
+    if (r->f_pos != pos) {
+        if (lv_fs_seek(&r->f, pos, LV_FS_SEEK_SET) != LV_FS_RES_OK) return 0;
+        r->f_pos = pos;
+    }
+    uint32_t rb = 0;
+    if (lv_fs_read(&r->f, buf, len, &rb) != LV_FS_RES_OK) return 0;
+    r->f_pos += rb;
+    return rb;
+}
+
+
+lv_res_t _lv_pngle_reader_open(lv_pngle_reader_t * r, const lv_pngle_input_t * in) {
+    r->in = *in;
+    r->f_open = false;
+    r->f_pos = 0;
+    r->pos = 0;
+    r->buf_pos = 0;
+    r->buf_len = 0;
+    r->eof = false;
+    if (in->fn != NULL) {
+        if (lv_fs_open(&r->f, in->fn, LV_FS_MODE_RD) != LV_FS_RES_OK) {
+            LV_LOG_ERROR("couldn't access PNG file: %s\n", in->fn);
+            return LV_RES_INV;
+        }
+        r->f_open = true;
+    } else if (in->data == NULL && in->read_cb == NULL) {
+        return LV_RES_INV;
+    }
+    return LV_RES_OK;
+}
+
+
+void _lv_pngle_reader_close(lv_pngle_reader_t * r) {
+    if (r->f_open) lv_fs_close(&r->f);
+    r->f_open = false;
+}
+
+
+uint32_t _lv_pngle_reader_peek(lv_pngle_reader_t * r, const uint8_t ** data, uint32_t len) {
+    if (len > PNGLE_BUF_SIZE) len = PNGLE_BUF_SIZE;
+    if (r->in.data != NULL) {
+        // memory: no copy
+        if (r->pos >= r->in.size) return 0;
+        *data = r->in.data + r->pos;
+        return r->in.size - r->pos < len ? r->in.size - r->pos : len;
+    }
+
+    if (r->pos < r->buf_pos || r->pos > r->buf_pos + r->buf_len) {
+        // position moved away from buffer: drop it
+        r->buf_pos = r->pos;
+        r->buf_len = 0;
+        r->eof = false;
+    }
+    uint32_t ofs = r->pos - r->buf_pos;
+    uint32_t avail = r->buf_len - ofs;
+    if (avail < len && !r->eof) {
+        // move unread data to the front and top up buffer
+        memmove(r->buf, r->buf + ofs, avail);
+        r->buf_pos = r->pos;
+        uint32_t n = reader_fill(r, r->buf_pos + avail, r->buf + avail, PNGLE_BUF_SIZE - avail);
+        r->eof = n < PNGLE_BUF_SIZE - avail;
+        r->buf_len = avail + n;
+        ofs = 0;
+        avail = r->buf_len;
+    }
+    *data = r->buf + ofs;
+    return avail < len ? avail : len;
+}
+
+
+lv_res_t _lv_pngle_reader_read(lv_pngle_reader_t * r, void * buf, uint32_t len) {
+    uint8_t * dst = (uint8_t*)buf;
+    while (len > 0) {
+        const uint8_t * data;
+        uint32_t n = _lv_pngle_reader_peek(r, &data, len);
+        if (n == 0) return LV_RES_INV;
+        memcpy(dst, data, n);
+        r->pos += n;
+        dst += n;
+        len -= n;
+    }
+    return LV_RES_OK;
+}
+
+
+lv_res_t _lv_pngle_reader_feed(lv_pngle_reader_t * r, pngle_t * pngle, uint32_t len) {
+    const uint8_t * data;
+    uint32_t n = _lv_pngle_reader_peek(r, &data, len);
+    int fed = n > 0 ? pngle_feed(pngle, data, n) : 0;
+    if (fed <= 0) {
+        LV_LOG_ERROR("Pngle returned an error or data ended prematurely.\n");
+        return LV_RES_INV;
+    }
+    r->pos += fed;
+    return LV_RES_OK;
+}
+
+
+lv_res_t _lv_pngle_reader_get_size(lv_pngle_reader_t * r, uint32_t * size) {
+    if (r->in.size == 0 && r->f_open) {
+        // the file is sought again on next read
+        if (lv_fs_seek(&r->f, 0, LV_FS_SEEK_END) != LV_FS_RES_OK || lv_fs_tell(&r->f, &r->in.size) != LV_FS_RES_OK) {
+            r->in.size = 0;
+        }
+        r->f_pos = r->in.size;
+    }
+    *size = r->in.size;
+    return r->in.size > 0 ? LV_RES_OK : LV_RES_INV;
+}
@@ -0,0 +1,352 @@
+/** \file lv_pngle_rowhash.c
+ *  \brief Row hashes of decoded images, so that reloading an image whose source
+ *  changed only invalidates the rows whose converted output changed.
+ *
+ *  Author: Vincent Paeder
+ *  License: MIT
+ */
+#include "lv_pngle_private.h"
+
+#if LV_PNGLE_USE_ROW_HASH
+
+#include "external/src/miniz.h"
+
+/** \brief Row hashes of a decoded image. */
+typedef struct _rowhash_entry_t {
+    /** \brief Image source (copy of path for file sources), or NULL if slot is free. */
+    const void * src;
+
+    /** \brief Copy of file path (file sources only). */
+    char * path;
+
+    /** \brief Image width. */
+    uint32_t w;
+
+    /** \brief Image height. */
+    uint32_t h;
+
+    /** \brief CRC-32 of each row of converted output. */
+    uint32_t * crcs;
+
+    /** \brief Bit mask of rows changed by last decoding (follows crcs). */
+    uint32_t * changed;
+
+    /** \brief First row changed by last decoding. */
+    int32_t first;
+
+    /** \brief Last row changed by last decoding (before first if none changed). */
+    int32_t last;
+
+    /** \brief Order of last decoding, to replace the least recently decoded image. */
+    uint32_t stamp;
+} rowhash_entry_t;
+
+/** \brief Row hash state. */
+static struct {
+    /** \brief Images with row hashes. */
+    rowhash_entry_t entries[LV_PNGLE_ROW_HASH_MAX_IMAGES];
+
+    /** \brief Next decoding order. */
+    uint32_t stamp;
+} rowhash;
+
+/** \brief State of row by row hashing. */
+typedef struct _rowhash_scan_t {
+    /** \brief Row hashes of image. */
+    rowhash_entry_t * e;
+
+    /** \brief If true, rows are compared with previous hashes. */
+    bool known;
+
+    /** \brief Converted output of current row (alpha plane follows, if any). */
+    uint8_t * row;
+
+    /** \brief If true, rows couldn't be hashed. */
+    bool failed;
+} rowhash_scan_t;
+
+/** \brief Rows to invalidate on objects showing an image. */
+typedef struct _rowhash_walk_t {
+    /** \brief Image source. */
+    const void * src;
+
+    /** \brief Row hashes of image, or NULL if rows that changed are unknown. */
+    const rowhash_entry_t * e;
+} rowhash_walk_t;
+
+
+/** \brief Check if two image sources are the same.
+ *  \param a: pointer to first image source.
+ *  \param b: pointer to second image source.
+ *  \returns true if sources are the same file or the same descriptor.
+ */
+static bool rowhash_same_src(const void * a, const void * b) {
+    if (a == b) return true;
+    if (a == NULL || b == NULL) return false;
+#if LV_PNGLE_USE_LVGL_V9
+    return lv_image_src_get_type(a) == LV_IMAGE_SRC_FILE && lv_image_src_get_type(b) == LV_IMAGE_SRC_FILE &&
+           !strcmp((const char*)a, (const char*)b);
+#else
+    return lv_img_src_get_type(a) == LV_IMG_SRC_FILE && lv_img_src_get_type(b) == LV_IMG_SRC_FILE &&
+           !strcmp((const char*)a, (const char*)b);
+#endif
+}
+
+/** \brief Find the row hashes of an image.
+ *  \param src: pointer to image source.
+ *  \returns pointer to entry, or NULL if image has none.
+ */
+static rowhash_entry_t * rowhash_find(const void * src) {
+    for (uint8_t i = 0; i < LV_PNGLE_ROW_HASH_MAX_IMAGES; i++) {
+        if (rowhash.entries[i].src != NULL && rowhash_same_src(rowhash.entries[i].src, src)) return &rowhash.entries[i];
+    }
+    return NULL;
+}
+
+/** \brief Free the row hashes of an image.
+ *  \param e: pointer to entry.
+ */
+static void rowhash_free(rowhash_entry_t * e) {
+    if (e->crcs != NULL) PNGLE_FREE(e->crcs);
+    if (e->path != NULL) PNGLE_FREE(e->path);
+    memset(e, 0, sizeof(rowhash_entry_t));
+}
+
+/** \brief Set up an entry for the row hashes of an image, replacing the least recently decoded one if needed.
+ *  \param src: pointer to image source.
+ *  \param w: image width.
+ *  \param h: image height.
+ *  \returns pointer to entry, or NULL if memory is lacking.
+ */
+static rowhash_entry_t * rowhash_add(const void * src, uint32_t w, uint32_t h) {
+    rowhash_entry_t * e = &rowhash.entries[0];
+    for (uint8_t i = 0; i < LV_PNGLE_ROW_HASH_MAX_IMAGES; i++) {
+        rowhash_entry_t * c = &rowhash.entries[i];
+        if (c->src == NULL) {
+            e = c;
+            break;
+        }
+        if (c->stamp < e->stamp) e = c;
+    }
+    rowhash_free(e);
+
+    e->crcs = (uint32_t*)PNGLE_MALLOC((h + (h + 31)/32)*sizeof(uint32_t));
+    if (e->crcs == NULL) return NULL;
+    e->changed = e->crcs + h;
+#if LV_PNGLE_USE_LVGL_V9
+    bool is_file = lv_image_src_get_type(src) == LV_IMAGE_SRC_FILE;
+#else
+    bool is_file = lv_img_src_get_type(src) == LV_IMG_SRC_FILE;
+#endif
+    if (is_file) {
+        // path may not outlive the image
+        size_t len = strlen((const char*)src);
+        e->path = (char*)PNGLE_MALLOC(len + 1);
+        if (e->path == NULL) {
+            rowhash_free(e);
+            return NULL;
+        }
+        memcpy(e->path, src, len + 1);
+        src = e->path;
+    }
+    e->src = src;
+    e->w = w;
+    e->h = h;
+    return e;
+}
+
+/** \brief Check whether a row changed in last decoding.
+ *  \param e: pointer to entry.
+ *  \param y: row index.
+ *  \returns true if row changed.
+ */
+static bool rowhash_is_changed(const rowhash_entry_t * e, int32_t y) {
+    return (e->changed[y/32] >> (y % 32)) & 1;
+}
+
+/** \brief Tree walk callback invalidating the rows that changed on image objects showing an image.
+ *  \param obj: pointer to object.
+ *  \param user_data: pointer to rows to invalidate.
+ *  \returns LV_OBJ_TREE_WALK_NEXT, to visit all objects.
+ */
+static lv_obj_tree_walk_res_t rowhash_walk_cb(lv_obj_t * obj, void * user_data) {
+    const rowhash_walk_t * walk = (const rowhash_walk_t*)user_data;
+#if LV_PNGLE_USE_LVGL_V9
+    if (!lv_obj_check_type(obj, &lv_image_class) || !rowhash_same_src(lv_image_get_src(obj), walk->src)) return LV_OBJ_TREE_WALK_NEXT;
+    bool plain = lv_image_get_scale(obj) == LV_SCALE_NONE && lv_image_get_rotation(obj) == 0;
+#else
+    if (!lv_obj_check_type(obj, &lv_img_class) || !rowhash_same_src(lv_img_get_src(obj), walk->src)) return LV_OBJ_TREE_WALK_NEXT;
+    bool plain = lv_img_get_zoom(obj) == LV_IMG_ZOOM_NONE && lv_img_get_angle(obj) == 0;
+#endif
+    const rowhash_entry_t * e = walk->e;
+    if (e != NULL && e->first > e->last) return LV_OBJ_TREE_WALK_NEXT;
+
+    lv_area_t coords;
+    lv_obj_get_content_coords(obj, &coords);
+    // rows map to object rows only if the image is drawn as is, filling the object
+    if (e == NULL || !plain || (uint32_t)lv_area_get_width(&coords) != e->w || (uint32_t)lv_area_get_height(&coords) != e->h) {
+        lv_obj_invalidate(obj);
+        return LV_OBJ_TREE_WALK_NEXT;
+    }
+    // one area per run of changed rows
+    for (int32_t y = e->first; y <= e->last;) {
+        if (!rowhash_is_changed(e, y)) {
+            y++;
+            continue;
+        }
+        int32_t y0 = y;
+        while (y <= e->last && rowhash_is_changed(e, y)) y++;
+        lv_area_t area = coords;
+        area.y1 = coords.y1 + y0;
+        area.y2 = coords.y1 + y - 1;
+        lv_obj_invalidate_area(obj, &area);
+    }
+    return LV_OBJ_TREE_WALK_NEXT;
+}
+
+
+/** \brief Get the entry for the row hashes of an image about to be hashed again.
+ *  \param src: pointer to image source.
+ *  \param w: image width.
+ *  \param h: image height.
+ *  \param known: target, set to true if rows can be compared with previous hashes.
+ *  \returns pointer to entry, or NULL if memory is lacking.
+ */
+static rowhash_entry_t * rowhash_begin(const void * src, uint32_t w, uint32_t h, bool * known) {
+    rowhash_entry_t * e = rowhash_find(src);
+    // all rows change with image size
+    *known = e != NULL && e->w == w && e->h == h;
+    if (!*known) {
+        if (e != NULL) rowhash_free(e);
+        e = rowhash_add(src, w, h);
+        if (e == NULL) return NULL;
+    }
+    e->first = *known ? (int32_t)h : 0;
+    e->last = *known ? -1 : (int32_t)h - 1;
+    memset(e->changed, *known ? 0 : 0xff, (h + 31)/32*sizeof(uint32_t));
+    return e;
+}
+
+/** \brief Store the hash of a row, and mark the row if it changed.
+ *  \param e: pointer to entry.
+ *  \param known: true if rows can be compared with previous hashes.
+ *  \param y: row index.
+ *  \param crc: CRC-32 of row.
+ */
+static void rowhash_put(rowhash_entry_t * e, bool known, uint32_t y, uint32_t crc) {
+    if (known && crc != e->crcs[y]) {
+        if ((int32_t)y < e->first) e->first = y;
+        e->last = y;
+        e->changed[y/32] |= (uint32_t)1 << (y % 32);
+    }
+    e->crcs[y] = crc;
+}
+
+/** \brief Mark the row hashes of an image as complete.
+ *  \param e: pointer to entry.
+ */
+static void rowhash_end(rowhash_entry_t * e) {
+    e->stamp = ++rowhash.stamp;
+    LV_LOG_INFO("rows %d to %d changed since previous decoding.\n", e->first, e->last);
+}
+
+
+void _lv_pngle_rowhash_record(const void * src, const lv_pngle_data_t * ud, uint32_t row_bytes) {
+    uint32_t w = ud->width;
+    uint32_t h = (uint32_t)ud->n_rows;
+    bool known;
+    rowhash_entry_t * e = rowhash_begin(src, w, h, &known);
+    if (e == NULL) return;
+    for (uint32_t y = 0; y < h; y++) {
+        uint32_t crc = (uint32_t)mz_crc32(MZ_CRC32_INIT, ud->data + y*ud->stride, row_bytes);
+        if (ud->alpha != NULL) crc = (uint32_t)mz_crc32(crc, ud->alpha + y*ud->alpha_stride, w);
+        rowhash_put(e, known, y, crc);
+    }
+    rowhash_end(e);
+}
+
+/** \brief Function called with each decoded pixel while hashing an image row by row.
+ *  \param ud: pointer to the data structure shared with Pngle.
+ *  \param x: horizontal coordinate of pixel.
+ *  \param y: vertical coordinate of pixel.
+ *  \param rgba: pointer to pixel value.
+ */
+static void rowhash_px_cb(lv_pngle_data_t * ud, uint32_t x, uint32_t y, const uint8_t * rgba) {
+    rowhash_scan_t * sc = (rowhash_scan_t*)ud->user_data;
+    // rows of interlaced images are only complete once the last pass is decoded
+    if (ud->interlaced) {
+        sc->failed = true;
+        return;
+    }
+    uint32_t w = ud->width;
+    _lv_pngle_convert_pixel(sc->row + x*PNGLE_COLOR_SIZE, PNGLE_PLANAR_ALPHA ? sc->row + w*PNGLE_COLOR_SIZE + x : NULL, rgba);
+    if (x + 1 < w) return;
+    uint32_t crc = (uint32_t)mz_crc32(MZ_CRC32_INIT, sc->row, w*PNGLE_PX_SIZE);
+    rowhash_put(sc->e, sc->known, y, crc);
+}
+
+/** \brief Hash the rows of an image decoded row by row, or not decoded when opened,
+ *  through a single row buffer.
+ *  \param src: pointer to image source.
+ */
+static void rowhash_scan(const void * src) {
+    lv_pngle_input_t in;
+    uint32_t w, h;
+    if (_lv_pngle_get_src(src, &in) != LV_RES_OK || _lv_pngle_read_header(&in, &w, &h) != LV_RES_OK) return;
+
+    rowhash_scan_t sc;
+    memset(&sc, 0, sizeof(sc));
+    sc.row = (uint8_t*)PNGLE_MALLOC(w*PNGLE_PX_SIZE);
+    if (sc.row == NULL) return;
+    sc.e = rowhash_begin(src, w, h, &sc.known);
+    if (sc.e != NULL) {
+        lv_pngle_data_t ud;
+        _lv_pngle_data_init(&ud, w, h);
+        _lv_pngle_get_tint(src, &ud);
+        ud.px_cb = rowhash_px_cb;
+        ud.user_data = &sc;
+        if (_lv_pngle_decode(&in, &ud) != LV_RES_OK || sc.failed) {
+            // rows that changed are unknown: the whole image is invalidated
+            rowhash_free(sc.e);
+        } else {
+            rowhash_end(sc.e);
+        }
+    }
+    PNGLE_FREE(sc.row);
+}
+
+
+bool lv_pngle_reload(const void * src) {
+#if LV_PNGLE_USE_LVGL_V9
+    lv_image_cache_drop(src);
+    lv_image_header_cache_drop(src);
+#else
+    lv_img_cache_invalidate_src(src);
+#endif
+    // rows that changed are unknown unless decoding records them
+    uint32_t stamp = rowhash.stamp;
+
+    // decode into LVGL's image cache, so that drawing the changed rows doesn't decode it again
+#if LV_PNGLE_USE_LVGL_V9
+    lv_image_decoder_dsc_t dsc;
+    bool ok = lv_image_decoder_open(&dsc, src, NULL) == LV_RES_OK;
+    if (ok) lv_image_decoder_close(&dsc);
+#else
+    bool ok = _lv_img_cache_open(src, lv_color_white(), 0) != NULL;
+#endif
+    // images decoded row by row (or lazily) aren't hashed when opened
+    if (ok && rowhash.stamp == stamp) rowhash_scan(src);
+
+    rowhash_walk_t walk;
+    walk.src = src;
+    walk.e = rowhash_find(src);
+    if (walk.e != NULL && walk.e->stamp <= stamp) walk.e = NULL;
+#if LV_PNGLE_USE_LVGL_V9
+    lv_obj_tree_walk(lv_screen_active(), rowhash_walk_cb, &walk);
+#else
+    lv_obj_tree_walk(lv_scr_act(), rowhash_walk_cb, &walk);
+#endif
+    return ok;
+}
+
+#endif
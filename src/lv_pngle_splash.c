@@ -0,0 +1,205 @@
+/** \file lv_pngle_splash.c
+ *  \brief Decoding of PNG images band by band straight to a display flush function,
+ *  for boot splashes shown before LVGL draw buffers exist.
+ *
+ *  Author: Vincent Paeder
+ *  License: MIT
+ */
+#include "lv_pngle_private.h"
+
+#if LV_PNGLE_USE_SPLASH
+
+#if LV_PNGLE_USE_LVGL_V9
+#define SPLASH_PX_SIZE (lv_color_format_get_bpp(PNGLE_CF)/8) ///< Number of bytes per pixel in bands (color plane of decoded images)
+#else
+#define SPLASH_PX_SIZE sizeof(lv_color_t) ///< Number of bytes per pixel in bands (lv_color_t)
+#endif
+
+/** \brief State of a splash decoding. */
+typedef struct _splash_t {
+    /** \brief Function pushing a band to the display. */
+    lv_pngle_flush_cb_t flush_cb;
+
+    /** \brief Function waiting for the last band pushed to be transferred, or NULL. */
+    lv_pngle_wait_cb_t wait_cb;
+
+    /** \brief User data passed to callbacks. */
+    void * user_data;
+
+    /** \brief Screen position of the top left corner of the image. */
+    int32_t x;
+
+    /** \brief Screen position of the top left corner of the image. */
+    int32_t y;
+
+    /** \brief Background color, as RGB values. */
+    uint8_t bg[3];
+
+    /** \brief Image width. */
+    uint32_t w;
+
+    /** \brief Image height. */
+    uint32_t h;
+
+    /** \brief Number of rows per band. */
+    uint32_t band_rows;
+
+    /** \brief Two band buffers, one filled while the other one is transferred. */
+    uint8_t * bufs[2];
+
+    /** \brief Index of buffer being filled. */
+    uint8_t cur;
+
+    /** \brief Band being filled. */
+    uint32_t band;
+
+    /** \brief If true, a band transfer may still be running. */
+    bool pending;
+
+    /** \brief If true, decoding failed. */
+    bool failed;
+} splash_t;
+
+
+/** \brief Push a filled band to the display, then switch to the other buffer.
+ *  \param sp: pointer to splash state.
+ *  \param rows: number of rows in band.
+ */
+static void splash_flush(splash_t * sp, uint32_t rows) {
+    lv_area_t a;
+    a.x1 = sp->x;
+    a.x2 = sp->x + (int32_t)sp->w - 1;
+    a.y1 = sp->y + (int32_t)(sp->band*sp->band_rows);
+    a.y2 = a.y1 + (int32_t)rows - 1;
+    // the other buffer is reused next: its transfer must be over
+    if (sp->pending && sp->wait_cb != NULL) sp->wait_cb(sp->user_data);
+    sp->flush_cb(&a, sp->bufs[sp->cur], sp->user_data);
+    sp->pending = true;
+    sp->cur ^= 1;
+    sp->band++;
+}
+
+/** \brief Function called with each pixel while the image is decoded.
+ *  \param ud: pointer to the data structure shared with Pngle.
+ *  \param x: horizontal coordinate of pixel.
+ *  \param y: vertical coordinate of pixel.
+ *  \param rgba: pointer to pixel value.
+ */
+static void splash_px_cb(lv_pngle_data_t * ud, uint32_t x, uint32_t y, const uint8_t * rgba) {
+    splash_t * sp = (splash_t*)ud->user_data;
+    if (sp->failed) return;
+    if (ud->interlaced) {
+        LV_LOG_ERROR("interlaced images can't be decoded band by band.\n");
+        sp->failed = true;
+        return;
+    }
+    if (y/sp->band_rows != sp->band) splash_flush(sp, sp->band_rows);
+
+    // blend over background, as the display has no alpha channel
+    uint8_t c[3];
+    for (uint8_t i = 0; i < 3; i++) c[i] = (uint8_t)((rgba[i]*rgba[3] + sp->bg[i]*(255 - rgba[3]))/255);
+    uint8_t * px = sp->bufs[sp->cur] + ((y % sp->band_rows)*sp->w + x)*SPLASH_PX_SIZE;
+#if LV_PNGLE_USE_LVGL_V9
+#if PNGLE_PLANAR_ALPHA
+    uint16_t col = ((c[0] & 0xf8) << 8) | ((c[1] & 0xfc) << 3) | ((c[2] & 0xf8) >> 3);
+    px[0] = col & 0xff;
+    px[1] = col >> 8;
+#else
+    px[0] = c[2];
+    px[1] = c[1];
+    px[2] = c[0];
+    px[3] = 0xff;
+#endif
+#else
+    lv_color_t col = _lv_pngle_make_color(c);
+    memcpy(px, &col, sizeof(lv_color_t));
+#endif
+}
+
+
+bool lv_pngle_splash(const void * src, int32_t x, int32_t y, lv_color_t bg,
+                     lv_pngle_flush_cb_t flush_cb, lv_pngle_wait_cb_t wait_cb, void * user_data) {
+    lv_pngle_input_t in;
+    if (_lv_pngle_get_src(src, &in) != LV_RES_OK) return false;
+
+    splash_t sp;
+    memset(&sp, 0, sizeof(sp));
+    if (_lv_pngle_read_header(&in, &sp.w, &sp.h) != LV_RES_OK) return false;
+    sp.flush_cb = flush_cb;
+    sp.wait_cb = wait_cb;
+    sp.user_data = user_data;
+    sp.x = x;
+    sp.y = y;
+#if LV_PNGLE_USE_LVGL_V9
+    sp.bg[0] = bg.red;
+    sp.bg[1] = bg.green;
+    sp.bg[2] = bg.blue;
+#else
+    uint32_t c = lv_color_to32(bg);
+    sp.bg[0] = (c >> 16) & 0xff;
+    sp.bg[1] = (c >> 8) & 0xff;
+    sp.bg[2] = c & 0xff;
+#endif
+    sp.band_rows = sp.h < LV_PNGLE_SPLASH_BAND_ROWS ? sp.h : LV_PNGLE_SPLASH_BAND_ROWS;
+
+    uint32_t band_size = sp.w*sp.band_rows*SPLASH_PX_SIZE;
+    LV_LOG_INFO("allocating memory for splash bands: %d bytes\n", 2*band_size);
+    sp.bufs[0] = (uint8_t*)PNGLE_MALLOC(2*band_size);
+    if (sp.bufs[0] == NULL) return false;
+    sp.bufs[1] = sp.bufs[0] + band_size;
+
+    lv_pngle_data_t ud;
+    _lv_pngle_data_init(&ud, sp.w, sp.h);
+    ud.px_cb = splash_px_cb;
+    ud.user_data = &sp;
+    if (_lv_pngle_decode(&in, &ud) != LV_RES_OK) sp.failed = true;
+    if (!sp.failed) splash_flush(&sp, sp.h - sp.band*sp.band_rows);
+    // buffers are freed: the last transfer must be over
+    if (sp.pending && sp.wait_cb != NULL) sp.wait_cb(sp.user_data);
+    PNGLE_FREE(sp.bufs[0]);
+    return !sp.failed;
+}
+
+
+#if !LV_PNGLE_USE_LVGL_V9
+/** \brief Push a band through a display driver.
+ *  \param area: screen area of band.
+ *  \param px: band pixels.
+ *  \param user_data: pointer to display driver.
+ */
+static void splash_drv_flush(const lv_area_t * area, const uint8_t * px, void * user_data) {
+    lv_disp_drv_t * drv = (lv_disp_drv_t*)user_data;
+    // the driver calls lv_disp_flush_ready when done
+    drv->flushing = 1;
+    drv->flush_cb(drv, area, (lv_color_t*)px);
+}
+
+/** \brief Wait until a display driver is done with the last band.
+ *  \param user_data: pointer to display driver.
+ */
+static void splash_drv_wait(void * user_data) {
+    lv_disp_drv_t * drv = (lv_disp_drv_t*)user_data;
+    while (drv->flushing) {
+        if (drv->wait_cb != NULL) drv->wait_cb(drv);
+    }
+}
+
+
+bool lv_pngle_splash_drv(const void * src, lv_disp_drv_t * drv, lv_color_t bg) {
+    lv_coord_t w = drv->hor_res;
+    lv_coord_t h = drv->ver_res;
+    lv_pngle_input_t in;
+    uint32_t iw, ih;
+    if (_lv_pngle_get_src(src, &in) != LV_RES_OK) return false;
+    if (_lv_pngle_read_header(&in, &iw, &ih) != LV_RES_OK) return false;
+    // drivers expect areas clipped to the screen, as LVGL gives them
+    if (iw > (uint32_t)w || ih > (uint32_t)h) {
+        LV_LOG_ERROR("splash image is larger than the display.\n");
+        return false;
+    }
+    // centered on screen
+    return lv_pngle_splash(src, (w - (int32_t)iw)/2, (h - (int32_t)ih)/2, bg, splash_drv_flush, splash_drv_wait, drv);
+}
+#endif
+
+#endif
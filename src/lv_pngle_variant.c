@@ -0,0 +1,95 @@
+/** \file lv_pngle_variant.c
+ *  \brief Table of tinted image variants, shared by (source, tint, opacity).
+ *
+ *  Author: Vincent Paeder
+ *  License: MIT
+ */
+#include "lv_pngle_private.h"
+
+#if LV_PNGLE_USE_VARIANTS
+
+/** \brief A tinted variant of an image. */
+typedef struct _variant_t {
+    /** \brief Wrapper used as image source (first member, so that the variant is its own source). */
+    lv_pngle_src_t s;
+
+    /** \brief Copy of wrapped file path (file sources only). */
+    char * fn;
+
+    /** \brief Next variant. */
+    struct _variant_t * next;
+} variant_t;
+
+/** \brief List of variants. */
+static variant_t * variants = NULL;
+
+
+/** \brief Get a color as a 32-bit RGB value.
+ *  \param c: color.
+ *  \returns RGB value.
+ */
+static uint32_t variant_rgb(lv_color_t c) {
+#if LV_PNGLE_USE_LVGL_V9
+    return ((uint32_t)c.red << 16) | ((uint32_t)c.green << 8) | c.blue;
+#else
+    return lv_color_to32(c) & 0xffffff;
+#endif
+}
+
+/** \brief Check whether a source is a file path.
+ *  \param src: pointer to image source.
+ *  \returns true if source is a file path.
+ */
+static bool variant_is_file(const void * src) {
+#if LV_PNGLE_USE_LVGL_V9
+    return lv_image_src_get_type(src) == LV_IMAGE_SRC_FILE;
+#else
+    return lv_img_src_get_type(src) == LV_IMG_SRC_FILE;
+#endif
+}
+
+
+const void * lv_pngle_variant_get(const void * src, lv_color_t color, lv_opa_t mix, lv_opa_t opa) {
+    bool is_file = variant_is_file(src);
+    uint32_t rgb = variant_rgb(color);
+    for (variant_t * v = variants; v != NULL; v = v->next) {
+        if (v->s.tint_mix != mix || v->s.opa != opa || variant_rgb(v->s.tint) != rgb) continue;
+        if (is_file ? (v->fn != NULL && !strcmp(v->fn, (const char*)src)) : v->s.src == src) return v;
+    }
+
+    variant_t * v = (variant_t*)PNGLE_MALLOC(sizeof(variant_t));
+    if (v == NULL) return NULL;
+    v->fn = NULL;
+    if (is_file) {
+        // the path given may be a temporary buffer
+        size_t len = strlen((const char*)src);
+        v->fn = (char*)PNGLE_MALLOC(len + 1);
+        if (v->fn == NULL) {
+            PNGLE_FREE(v);
+            return NULL;
+        }
+        memcpy(v->fn, src, len + 1);
+    }
+    lv_pngle_src_init(&v->s, is_file ? v->fn : src, LV_PNGLE_FORMAT_AUTO);
+    lv_pngle_src_set_tint(&v->s, color, mix, opa);
+    v->next = variants;
+    variants = v;
+    return v;
+}
+
+
+void lv_pngle_variant_clear(void) {
+    while (variants != NULL) {
+        variant_t * v = variants;
+        variants = v->next;
+#if LV_PNGLE_USE_LVGL_V9
+        lv_image_cache_drop(v);
+#else
+        lv_img_cache_invalidate_src(v);
+#endif
+        if (v->fn != NULL) PNGLE_FREE(v->fn);
+        PNGLE_FREE(v);
+    }
+}
+
+#endif
@@ -0,0 +1,276 @@
+/** \file lv_pngle_watch.c
+ *  \brief Invalidation of cached PNG images when their file changes, using inotify (Linux only).
+ *
+ *  Author: Vincent Paeder
+ *  License: MIT
+ */
+#include "lv_pngle_private.h"
+
+#if LV_PNGLE_USE_WATCH
+
+#ifndef __linux__
+#error "LV_PNGLE_USE_WATCH requires Linux (inotify)"
+#endif
+
+#include <stdio.h>
+#include <unistd.h>
+#include <sys/inotify.h>
+
+/** \brief Events of a watched directory that may change one of its files. */
+#define WATCH_MASK (IN_CLOSE_WRITE | IN_MOVED_TO | IN_MOVED_FROM | IN_DELETE | IN_ATTRIB | IN_ONLYDIR)
+
+/** \brief A watched directory. */
+typedef struct _watch_dir_t {
+    /** \brief Watch descriptor, or -1 if slot is free. */
+    int wd;
+
+    /** \brief Directory path on host filesystem. */
+    char * path;
+} watch_dir_t;
+
+/** \brief A watched file. */
+typedef struct _watch_file_t {
+    /** \brief File path, with LVGL drive letter (as used for image sources). */
+    char * fn;
+
+    /** \brief File name (points into fn). */
+    const char * name;
+
+    /** \brief Index of directory holding the file. */
+    uint8_t dir;
+} watch_file_t;
+
+/** \brief Watch state. */
+static struct {
+    /** \brief inotify file descriptor, or -1 if not started. */
+    int fd;
+
+    /** \brief Timer processing events. */
+    lv_timer_t * timer;
+
+    /** \brief User function called when a file changed. */
+    lv_pngle_watch_cb_t cb;
+
+    /** \brief Watched directories. */
+    watch_dir_t dirs[LV_PNGLE_WATCH_MAX_DIRS];
+
+    /** \brief Number of used directory slots. */
+    uint8_t n_dirs;
+
+    /** \brief Watched files. */
+    watch_file_t files[LV_PNGLE_WATCH_MAX_FILES];
+
+    /** \brief Number of watched files. */
+    uint16_t n_files;
+} watch = { .fd = -1 };
+
+
+/** \brief Stop watching a file.
+ *  \param i: file index.
+ */
+static void watch_remove_file(uint16_t i) {
+    PNGLE_FREE(watch.files[i].fn);
+    watch.files[i] = watch.files[--watch.n_files];
+}
+
+/** \brief Get the directory slot for a path, adding a watch if needed.
+ *  \param path: directory path, without drive letter.
+ *  \param len: length of directory path.
+ *  \returns directory index, or -1 if failed.
+ */
+static int watch_get_dir(const char * path, size_t len) {
+    char host[256];
+    int n = len ? snprintf(host, sizeof(host), "%s%.*s", LV_PNGLE_WATCH_ROOT, (int)len, path)
+                : snprintf(host, sizeof(host), "%s", LV_PNGLE_WATCH_ROOT[0] ? LV_PNGLE_WATCH_ROOT : ".");
+    if (n < 0 || (size_t)n >= sizeof(host)) return -1;
+
+    int free_slot = -1;
+    for (uint8_t i = 0; i < watch.n_dirs; i++) {
+        if (watch.dirs[i].wd < 0) {
+            if (free_slot < 0) free_slot = i;
+        } else if (!strcmp(watch.dirs[i].path, host)) {
+            return i;
+        }
+    }
+    if (free_slot < 0) {
+        if (watch.n_dirs == LV_PNGLE_WATCH_MAX_DIRS) {
+            LV_LOG_WARN("too many watched directories, %s isn't watched.\n", host);
+            return -1;
+        }
+        // only counted once the watch is set
+        free_slot = watch.n_dirs;
+    }
+
+    int wd = inotify_add_watch(watch.fd, host, WATCH_MASK);
+    if (wd < 0) {
+        LV_LOG_WARN("can't watch %s.\n", host);
+        return -1;
+    }
+    // same directory reached through another path: share its slot
+    for (uint8_t i = 0; i < watch.n_dirs; i++) {
+        if (watch.dirs[i].wd == wd) return i;
+    }
+    char * copy = (char*)PNGLE_MALLOC(n + 1);
+    if (copy == NULL) {
+        inotify_rm_watch(watch.fd, wd);
+        return -1;
+    }
+    memcpy(copy, host, n + 1);
+    watch.dirs[free_slot].wd = wd;
+    watch.dirs[free_slot].path = copy;
+    if (free_slot == watch.n_dirs) watch.n_dirs++;
+    return free_slot;
+}
+
+/** \brief Drop cached copies of a file.
+ *  \param fn: file path, with LVGL drive letter.
+ */
+static void watch_drop(const char * fn) {
+#if LV_PNGLE_USE_MANIFEST
+    // header is parsed from the file from now on
+    _lv_pngle_manifest_forget(fn);
+#endif
+#if LV_PNGLE_USE_ROW_HASH
+    LV_LOG_INFO("%s changed, reloading it.\n", fn);
+    lv_pngle_reload(fn);
+#elif LV_PNGLE_USE_LVGL_V9
+    LV_LOG_INFO("%s changed, dropping cached copies.\n", fn);
+    lv_image_cache_drop(fn);
+    lv_image_header_cache_drop(fn);
+#else
+    LV_LOG_INFO("%s changed, dropping cached copies.\n", fn);
+    lv_img_cache_invalidate_src(fn);
+#endif
+    if (watch.cb != NULL) watch.cb(fn);
+}
+
+/** \brief Process an inotify event.
+ *  \param ev: pointer to event.
+ *  \returns true if a watched file changed.
+ */
+static bool watch_process_event(const struct inotify_event * ev) {
+    int dir = -1;
+    for (uint8_t i = 0; i < watch.n_dirs; i++) {
+        if (watch.dirs[i].wd == ev->wd) dir = i;
+    }
+    if (dir < 0) return false;
+
+    bool changed = false;
+    // watched files are forgotten once changed: they are watched again when decoded next
+    for (uint16_t i = watch.n_files; i-- > 0;) {
+        watch_file_t * f = &watch.files[i];
+        if (f->dir != dir) continue;
+        if ((ev->mask & IN_IGNORED) || (ev->len && !strcmp(f->name, ev->name))) {
+            // removed first, as reloading the file watches it again
+            char * fn = f->fn;
+            watch.files[i] = watch.files[--watch.n_files];
+            watch_drop(fn);
+            PNGLE_FREE(fn);
+            changed = true;
+        }
+    }
+    if (ev->mask & IN_IGNORED) {
+        // directory was deleted or unmounted
+        PNGLE_FREE(watch.dirs[dir].path);
+        watch.dirs[dir].path = NULL;
+        watch.dirs[dir].wd = -1;
+    }
+    return changed;
+}
+
+/** \brief Timer callback reading pending inotify events.
+ *  \param t: pointer to timer.
+ */
+static void watch_timer_cb(lv_timer_t * t) {
+    LV_UNUSED(t);
+    union {
+        struct inotify_event ev;
+        char buf[4096];
+    } u;
+    bool changed = false;
+    ssize_t len;
+    while ((len = read(watch.fd, u.buf, sizeof(u.buf))) > 0) {
+        for (const char * p = u.buf; p < u.buf + len;) {
+            const struct inotify_event * ev = (const struct inotify_event*)p;
+            if (watch_process_event(ev)) changed = true;
+            p += sizeof(struct inotify_event) + ev->len;
+        }
+    }
+#if LV_PNGLE_USE_ROW_HASH
+    // reloading invalidated what changed
+    LV_UNUSED(changed);
+#elif LV_PNGLE_USE_LVGL_V9
+    if (changed) lv_obj_invalidate(lv_screen_active());
+#else
+    if (changed) lv_obj_invalidate(lv_scr_act());
+#endif
+}
+
+
+void _lv_pngle_watch_add(const char * fn) {
+    if (watch.fd < 0) return;
+    for (uint16_t i = 0; i < watch.n_files; i++) {
+        if (!strcmp(watch.files[i].fn, fn)) return;
+    }
+    if (watch.n_files == LV_PNGLE_WATCH_MAX_FILES) {
+        LV_LOG_WARN("too many watched files, %s isn't watched.\n", fn);
+        return;
+    }
+
+    // drop drive letter, then split directory and file name
+    const char * path = (fn[0] != '\0' && fn[1] == ':') ? fn + 2 : fn;
+    const char * name = strrchr(path, '/');
+    name = name != NULL ? name + 1 : path;
+    int dir = watch_get_dir(path, name - path);
+    if (dir < 0) return;
+
+    size_t len = strlen(fn);
+    char * copy = (char*)PNGLE_MALLOC(len + 1);
+    if (copy == NULL) return;
+    memcpy(copy, fn, len + 1);
+    watch_file_t * f = &watch.files[watch.n_files++];
+    f->fn = copy;
+    f->name = copy + (name - fn);
+    f->dir = dir;
+}
+
+
+bool lv_pngle_watch_start(lv_pngle_watch_cb_t cb) {
+    watch.cb = cb;
+    if (watch.fd >= 0) return true;
+    watch.fd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+    if (watch.fd < 0) {
+        LV_LOG_ERROR("inotify initialization failed.\n");
+        return false;
+    }
+    watch.timer = lv_timer_create(watch_timer_cb, LV_PNGLE_WATCH_PERIOD, NULL);
+    if (watch.timer == NULL) {
+        lv_pngle_watch_stop();
+        return false;
+    }
+    return true;
+}
+
+
+void lv_pngle_watch_stop(void) {
+    if (watch.timer != NULL) {
+#if LV_PNGLE_USE_LVGL_V9
+        lv_timer_delete(watch.timer);
+#else
+        lv_timer_del(watch.timer);
+#endif
+        watch.timer = NULL;
+    }
+    // closing the descriptor removes all watches
+    if (watch.fd >= 0) close(watch.fd);
+    watch.fd = -1;
+    while (watch.n_files) watch_remove_file(watch.n_files - 1);
+    for (uint8_t i = 0; i < watch.n_dirs; i++) {
+        if (watch.dirs[i].path != NULL) PNGLE_FREE(watch.dirs[i].path);
+        watch.dirs[i].path = NULL;
+        watch.dirs[i].wd = -1;
+    }
+    watch.n_dirs = 0;
+}
+
+#endif
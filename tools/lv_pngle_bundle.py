@@ -0,0 +1,105 @@
+#!/usr/bin/env python3
+"""Pack PNG images into a bundle file read by lv_pngle (LV_PNGLE_USE_BUNDLE).
+
+Bundle file layout (little-endian): magic "LVPB" | version (2 bytes) |
+reserved (2 bytes) | number of entries (4 bytes) | size of names (4 bytes) |
+entries sorted by name | names | PNG images, stored contiguously.
+
+Entry layout: name offset in names (4 bytes) | name length (2 bytes) |
+reserved (2 bytes) | image offset in file (4 bytes) | image size (4 bytes) |
+width (4 bytes) | height (4 bytes).
+
+Images are named after their path relative to the directory given, with '/'
+separators: "icons/home.png" in the bundle is then given to LVGL as
+"B:icons/home.png" (see LV_PNGLE_BUNDLE_LETTER).
+
+Usage: lv_pngle_bundle.py -o assets.bin DIR [DIR ...]
+
+Author: Vincent Paeder
+License: MIT
+"""
+import argparse
+import os
+import struct
+import sys
+
+VERSION = 1
+HDR_SIZE = 16
+ENTRY_SIZE = 24
+ALIGN = 4
+PNG_MAGIC = b"\x89PNG\r\n\x1a\n"
+
+
+def read_png(path):
+    """Read a PNG file and return its data, width and height, or None if it isn't a PNG image."""
+    with open(path, "rb") as f:
+        data = f.read()
+    # signature (8 bytes) | IHDR length (4 bytes) | "IHDR" | width (4 bytes) | height (4 bytes)
+    if len(data) < 24 or data[:8] != PNG_MAGIC or data[12:16] != b"IHDR":
+        return None
+    w, h = struct.unpack(">II", data[16:24])
+    return data, w, h
+
+
+def collect(dirs):
+    """Collect PNG images of given directories, as a dict from name to (data, width, height)."""
+    images = {}
+    for top in dirs:
+        for root, _, files in os.walk(top):
+            for fn in files:
+                if not fn.lower().endswith(".png"):
+                    continue
+                path = os.path.join(root, fn)
+                name = os.path.relpath(path, top).replace(os.sep, "/")
+                png = read_png(path)
+                if png is None:
+                    print("%s isn't a valid PNG file, skipped." % path, file=sys.stderr)
+                    continue
+                if name in images:
+                    print("%s is given twice, last one kept." % name, file=sys.stderr)
+                images[name] = png
+    return images
+
+
+def pack(images):
+    """Build bundle file contents."""
+    # sorted by name bytes, as searched by the decoder
+    names = sorted(images, key=lambda n: n.encode("utf-8"))
+    blob = b""
+    name_ofs = []
+    for name in names:
+        enc = name.encode("utf-8")
+        if len(enc) > 0xffff:
+            raise ValueError("name too long: %s" % name)
+        name_ofs.append((len(blob), len(enc)))
+        blob += enc
+
+    offset = HDR_SIZE + len(names)*ENTRY_SIZE + len(blob)
+    entries = b""
+    data = b""
+    for name, (nofs, nlen) in zip(names, name_ofs):
+        png, w, h = images[name]
+        pad = -(offset + len(data)) % ALIGN
+        data += b"\0"*pad
+        entries += struct.pack("<IHHIIII", nofs, nlen, 0, offset + len(data), len(png), w, h)
+        data += png
+
+    hdr = b"LVPB" + struct.pack("<HHII", VERSION, 0, len(names), len(blob))
+    return hdr + entries + blob + data
+
+
+def main():
+    parser = argparse.ArgumentParser(description="Pack PNG images into an lv_pngle bundle file.")
+    parser.add_argument("-o", "--output", required=True, help="bundle file to write")
+    parser.add_argument("dirs", nargs="+", help="directories holding PNG images")
+    args = parser.parse_args()
+
+    images = collect(args.dirs)
+    out = pack(images)
+    with open(args.output, "wb") as f:
+        f.write(out)
+    print("packed %d images into %s (%d bytes)" % (len(images), args.output, len(out)))
+
+
+if __name__ == "__main__":
+    main()
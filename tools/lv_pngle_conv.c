@@ -0,0 +1,279 @@
+/** \file lv_pngle_conv.c
+ *  \brief Host tool converting PNG images to LVGL image descriptors (C arrays) or
+ *  LVGL binary images, with pixels exactly as lv_pngle decodes them at run time.
+ *
+ *  The tool doesn't reimplement any conversion: it is built from lv_pngle and
+ *  LVGL sources with the lv_conf.h of the target (color depth, chroma key,
+ *  LV_PNGLE_* options), and writes out the buffer lv_pngle decoded. Memory must
+ *  come from the C library (LV_MEM_CUSTOM 1 with LVGL v8, LV_USE_STDLIB_MALLOC
+ *  LV_STDLIB_CLIB with LVGL v9), and images must be decoded to a full buffer
+ *  (LV_PNGLE_STREAM_MIN_PX 0, LV_PNGLE_USE_LAZY 0).
+ *
+ *  Build (with lv_conf.h in conf/):
+ *      cc -O2 -DLV_CONF_INCLUDE_SIMPLE -Iconf -Ilvgl -Ilv_pngle/src -o lv_pngle_conv \
+ *         lv_pngle/tools/lv_pngle_conv.c lv_pngle/src/lv_pngle*.c \
+ *         lv_pngle/src/external/src/pngle.c lv_pngle/src/external/src/miniz.c \
+ *         $(find lvgl/src -name '*.c') -lm
+ *
+ *  Usage: lv_pngle_conv [-f format] [-t RRGGBB] [-m mix] [-a opa] [-n name] [-b] -o out in.png
+ *      -f: output format (auto, true_color, true_color_alpha, chroma_keyed, alpha, argb8888)
+ *      -t: tint color, -m: tint intensity (0-255), -a: opacity (0-255), as with lv_pngle_src_set_tint
+ *      -n: name of image descriptor (defaults to input file name)
+ *      -b: write an LVGL binary image (header and pixels) instead of a C file
+ *
+ *  Author: Vincent Paeder
+ *  License: MIT
+ */
+#include <ctype.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include "lv_pngle.h"
+
+#define CONV_BYTES_PER_LINE 16 ///< Number of bytes per line in C arrays
+
+/** \brief Output format names, in lv_pngle_format_t order. */
+static const char * conv_formats[] = {
+    "auto", "true_color", "true_color_alpha", "chroma_keyed", "indexed", "alpha", "argb8888"
+};
+
+
+/** \brief Read function of input file.
+ *  \param user_data: input file.
+ *  \param pos: position of first byte to read.
+ *  \param buf: target buffer.
+ *  \param len: number of bytes to read.
+ *  \returns number of bytes read.
+ */
+static uint32_t conv_read_cb(void * user_data, uint32_t pos, uint8_t * buf, uint32_t len) {
+    FILE * f = (FILE*)user_data;
+    if (fseek(f, pos, SEEK_SET) != 0) return 0;
+    return (uint32_t)fread(buf, 1, len, f);
+}
+
+/** \brief Make a C identifier from a file path (file name without extension).
+ *  \param path: file path.
+ *  \param name: target buffer.
+ *  \param size: size of target buffer.
+ */
+static void conv_make_name(const char * path, char * name, size_t size) {
+    const char * base = strrchr(path, '/');
+    base = base != NULL ? base + 1 : path;
+    size_t n = 0;
+    if (isdigit((unsigned char)*base) && n + 1 < size) name[n++] = '_';
+    for (; *base && *base != '.' && n + 1 < size; base++) {
+        name[n++] = isalnum((unsigned char)*base) ? *base : '_';
+    }
+    name[n] = '\0';
+}
+
+#if LV_PNGLE_USE_LVGL_V9
+/** \brief Get the name of a color format produced by lv_pngle.
+ *  \param cf: color format.
+ *  \returns name of color format constant, or NULL if unknown.
+ */
+static const char * conv_cf_name(lv_color_format_t cf) {
+    switch (cf) {
+    case LV_COLOR_FORMAT_RGB565: return "LV_COLOR_FORMAT_RGB565";
+    case LV_COLOR_FORMAT_RGB565A8: return "LV_COLOR_FORMAT_RGB565A8";
+    case LV_COLOR_FORMAT_RGB888: return "LV_COLOR_FORMAT_RGB888";
+    case LV_COLOR_FORMAT_XRGB8888: return "LV_COLOR_FORMAT_XRGB8888";
+    case LV_COLOR_FORMAT_ARGB8888: return "LV_COLOR_FORMAT_ARGB8888";
+    case LV_COLOR_FORMAT_A8: return "LV_COLOR_FORMAT_A8";
+    default: return NULL;
+    }
+}
+#else
+/** \brief Get the color format of pixels decoded by lv_pngle.
+ *  \param cf: color format reported by lv_pngle (raw formats).
+ *  \returns color format of pixels.
+ */
+static lv_img_cf_t conv_cf(lv_img_cf_t cf) {
+    switch (cf) {
+    case LV_IMG_CF_RAW: return LV_IMG_CF_TRUE_COLOR;
+    case LV_IMG_CF_RAW_CHROMA_KEYED: return LV_IMG_CF_TRUE_COLOR_CHROMA_KEYED;
+    case LV_IMG_CF_ALPHA_8BIT: return LV_IMG_CF_ALPHA_8BIT;
+    default: return LV_IMG_CF_TRUE_COLOR_ALPHA;
+    }
+}
+
+/** \brief Get the name of a color format produced by lv_pngle.
+ *  \param cf: color format.
+ *  \returns name of color format constant.
+ */
+static const char * conv_cf_name(lv_img_cf_t cf) {
+    switch (cf) {
+    case LV_IMG_CF_TRUE_COLOR: return "LV_IMG_CF_TRUE_COLOR";
+    case LV_IMG_CF_TRUE_COLOR_CHROMA_KEYED: return "LV_IMG_CF_TRUE_COLOR_CHROMA_KEYED";
+    case LV_IMG_CF_ALPHA_8BIT: return "LV_IMG_CF_ALPHA_8BIT";
+    default: return "LV_IMG_CF_TRUE_COLOR_ALPHA";
+    }
+}
+#endif
+
+/** \brief Write image data as a C file.
+ *  \param f: output file.
+ *  \param name: name of image descriptor.
+ *  \param header: image header.
+ *  \param data: image data.
+ *  \param size: size of image data, in bytes.
+ *  \returns 0 if successful, 1 if failed.
+ */
+#if LV_PNGLE_USE_LVGL_V9
+static int conv_write_c(FILE * f, const char * name, const lv_image_header_t * header, const uint8_t * data, uint32_t size) {
+#else
+static int conv_write_c(FILE * f, const char * name, const lv_img_header_t * header, const uint8_t * data, uint32_t size) {
+#endif
+    fprintf(f, "/* Generated by lv_pngle_conv for LV_COLOR_DEPTH %d: don't edit. */\n", LV_COLOR_DEPTH);
+    fprintf(f, "#include \"lvgl.h\"\n\n");
+    fprintf(f, "#if LV_COLOR_DEPTH != %d\n#error \"%s was converted for another color depth\"\n#endif\n\n",
+            LV_COLOR_DEPTH, name);
+    fprintf(f, "static const LV_ATTRIBUTE_LARGE_CONST uint8_t %s_map[] = {", name);
+    for (uint32_t i = 0; i < size; i++) {
+        if (i % CONV_BYTES_PER_LINE == 0) fprintf(f, "\n   ");
+        fprintf(f, " 0x%02x,", data[i]);
+    }
+    fprintf(f, "\n};\n\n");
+#if LV_PNGLE_USE_LVGL_V9
+    const char * cf = conv_cf_name(header->cf);
+    fprintf(f, "const lv_image_dsc_t %s = {\n", name);
+    fprintf(f, "    .header.magic = LV_IMAGE_HEADER_MAGIC,\n");
+    if (cf != NULL) fprintf(f, "    .header.cf = %s,\n", cf);
+    else fprintf(f, "    .header.cf = %d,\n", header->cf);
+    // allocation flags only apply to the buffer decoded by lv_pngle
+    fprintf(f, "    .header.flags = 0x%04x,\n", header->flags & LV_IMAGE_FLAGS_PREMULTIPLIED);
+    fprintf(f, "    .header.w = %d,\n    .header.h = %d,\n    .header.stride = %d,\n",
+            (int)header->w, (int)header->h, (int)header->stride);
+#else
+    fprintf(f, "const lv_img_dsc_t %s = {\n", name);
+    fprintf(f, "    .header.cf = %s,\n    .header.always_zero = 0,\n    .header.reserved = 0,\n", conv_cf_name(header->cf));
+    fprintf(f, "    .header.w = %d,\n    .header.h = %d,\n", (int)header->w, (int)header->h);
+#endif
+    fprintf(f, "    .data_size = %u,\n    .data = %s_map,\n};\n", (unsigned)size, name);
+    return ferror(f) ? 1 : 0;
+}
+
+/** \brief Write image data as an LVGL binary image.
+ *  \param f: output file.
+ *  \param header: image header.
+ *  \param data: image data.
+ *  \param size: size of image data, in bytes.
+ *  \returns 0 if successful, 1 if failed.
+ */
+#if LV_PNGLE_USE_LVGL_V9
+static int conv_write_bin(FILE * f, const lv_image_header_t * header, const uint8_t * data, uint32_t size) {
+    lv_image_header_t h = *header;
+    h.magic = LV_IMAGE_HEADER_MAGIC;
+    h.flags &= LV_IMAGE_FLAGS_PREMULTIPLIED;
+#else
+static int conv_write_bin(FILE * f, const lv_img_header_t * header, const uint8_t * data, uint32_t size) {
+    lv_img_header_t h = *header;
+    h.always_zero = 0;
+#endif
+    if (fwrite(&h, sizeof(h), 1, f) != 1 || fwrite(data, 1, size, f) != size) return 1;
+    return 0;
+}
+
+/** \brief Print usage and exit.
+ *  \param prog: program name.
+ */
+static void conv_usage(const char * prog) {
+    fprintf(stderr, "usage: %s [-f format] [-t RRGGBB] [-m mix] [-a opa] [-n name] [-b] -o out in.png\n", prog);
+    fprintf(stderr, "formats: auto, true_color, true_color_alpha, chroma_keyed, alpha, argb8888\n");
+    exit(2);
+}
+
+
+int main(int argc, char ** argv) {
+    lv_pngle_format_t format = LV_PNGLE_FORMAT_AUTO;
+    uint32_t tint = 0;
+    int mix = 0, opa = LV_OPA_COVER;
+    const char * out = NULL;
+    char name[64] = "";
+    bool bin = false;
+    int c;
+    while ((c = getopt(argc, argv, "f:t:m:a:n:bo:")) != -1) {
+        switch (c) {
+        case 'f': {
+            uint32_t i;
+            for (i = 0; i < sizeof(conv_formats)/sizeof(conv_formats[0]); i++) {
+                if (strcmp(optarg, conv_formats[i]) == 0) break;
+            }
+            // indexed images are expanded row by row when drawn: no buffer to write out
+            if (i == sizeof(conv_formats)/sizeof(conv_formats[0]) || i == LV_PNGLE_FORMAT_INDEXED) conv_usage(argv[0]);
+            format = (lv_pngle_format_t)i;
+            break;
+        }
+        case 't': tint = (uint32_t)strtoul(optarg, NULL, 16); break;
+        case 'm': mix = atoi(optarg); break;
+        case 'a': opa = atoi(optarg); break;
+        case 'n': snprintf(name, sizeof(name), "%s", optarg); break;
+        case 'b': bin = true; break;
+        case 'o': out = optarg; break;
+        default: conv_usage(argv[0]);
+        }
+    }
+    if (optind != argc - 1 || out == NULL || mix < 0 || mix > 255 || opa < 0 || opa > 255) conv_usage(argv[0]);
+    const char * in = argv[optind];
+    if (name[0] == '\0') conv_make_name(in, name, sizeof(name));
+
+    FILE * f = fopen(in, "rb");
+    if (f == NULL) {
+        fprintf(stderr, "couldn't open %s\n", in);
+        return 1;
+    }
+    fseek(f, 0, SEEK_END);
+    long size = ftell(f);
+
+    lv_init();
+    lv_pngle_init();
+    lv_pngle_src_t src;
+    lv_pngle_src_init_cb(&src, conv_read_cb, f, size > 0 ? (uint32_t)size : 0, format);
+    lv_pngle_src_set_tint(&src, lv_color_hex(tint), (lv_opa_t)mix, (lv_opa_t)opa);
+
+    // decoded by lv_pngle, as it would be on target
+    int rc = 1;
+#if LV_PNGLE_USE_LVGL_V9
+    lv_image_decoder_dsc_t dsc;
+    if (lv_image_decoder_open(&dsc, &src, NULL) != LV_RESULT_OK) {
+        fprintf(stderr, "couldn't decode %s\n", in);
+        fclose(f);
+        return 1;
+    }
+    const lv_draw_buf_t * decoded = dsc.decoded;
+    if (decoded != NULL) {
+        const lv_image_header_t * header = &decoded->header;
+        const uint8_t * data = decoded->data;
+        uint32_t data_size = decoded->data_size;
+#else
+    lv_img_decoder_dsc_t dsc;
+    if (lv_img_decoder_open(&dsc, &src, lv_color_black(), 0) != LV_RES_OK) {
+        fprintf(stderr, "couldn't decode %s\n", in);
+        fclose(f);
+        return 1;
+    }
+    if (dsc.img_data != NULL) {
+        lv_img_header_t hdr = dsc.header;
+        hdr.cf = conv_cf(dsc.header.cf);
+        const lv_img_header_t * header = &hdr;
+        const uint8_t * data = dsc.img_data;
+        uint32_t data_size = lv_img_buf_get_img_size(hdr.w, hdr.h, hdr.cf);
+#endif
+        FILE * o = fopen(out, bin ? "wb" : "w");
+        if (o != NULL) {
+            rc = bin ? conv_write_bin(o, header, data, data_size) : conv_write_c(o, name, header, data, data_size);
+            if (fclose(o) != 0) rc = 1;
+        }
+        if (rc != 0) fprintf(stderr, "couldn't write %s\n", out);
+    } else {
+        fprintf(stderr, "%s isn't decoded to a full buffer: disable row by row decoding and lazy opening\n", in);
+    }
+#if LV_PNGLE_USE_LVGL_V9
+    lv_image_decoder_close(&dsc);
+#else
+    lv_img_decoder_close(&dsc);
+#endif
+    fclose(f);
+    return rc;
+}
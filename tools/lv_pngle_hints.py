@@ -0,0 +1,85 @@
+#!/usr/bin/env python3
+"""Write decoding hints read by lv_pngle (LV_PNGLE_USE_HINTS) into PNG images.
+
+Hints are stored in a private ancillary chunk "lvGL" placed right after the
+image header, replacing any such chunk already present. Chunk data: version (1) |
+output format | decoding mode | cache priority, 1 byte each.
+
+Usage: lv_pngle_hints.py [-f format] [-m mode] [-p priority] FILE [FILE ...]
+       lv_pngle_hints.py -r FILE [FILE ...]   (remove hints)
+
+Author: Vincent Paeder
+License: MIT
+"""
+import argparse
+import struct
+import sys
+import zlib
+
+VERSION = 1
+PNG_MAGIC = b"\x89PNG\r\n\x1a\n"
+CHUNK_TYPE = b"lvGL"
+# in lv_pngle_format_t order
+FORMATS = ["auto", "true_color", "true_color_alpha", "chroma_keyed", "indexed", "alpha", "argb8888"]
+# in lv_pngle_hint_mode_t order
+MODES = ["auto", "full", "stream"]
+
+
+def split_chunks(data):
+    """Split PNG data after its signature into a list of (type, data), or None if it isn't a PNG image."""
+    if data[:8] != PNG_MAGIC:
+        return None
+    chunks = []
+    pos = 8
+    # chunk structure: length (4 bytes) | chunk type (4 bytes) | chunk data (length) | CRC (4 bytes)
+    while pos + 12 <= len(data):
+        length, = struct.unpack(">I", data[pos:pos + 4])
+        chunks.append((data[pos + 4:pos + 8], data[pos + 8:pos + 8 + length]))
+        pos += length + 12
+    if not chunks or chunks[0][0] != b"IHDR":
+        return None
+    return chunks
+
+
+def make_chunk(ctype, cdata):
+    """Build a PNG chunk."""
+    return struct.pack(">I", len(cdata)) + ctype + cdata + struct.pack(">I", zlib.crc32(ctype + cdata))
+
+
+def set_hints(path, hints):
+    """Write hints into a PNG file (remove them if hints is None). Returns False if file isn't a PNG image."""
+    with open(path, "rb") as f:
+        chunks = split_chunks(f.read())
+    if chunks is None:
+        return False
+    chunks = [c for c in chunks if c[0] != CHUNK_TYPE]
+    if hints is not None:
+        chunks.insert(1, (CHUNK_TYPE, hints))
+    with open(path, "wb") as f:
+        f.write(PNG_MAGIC + b"".join(make_chunk(t, d) for t, d in chunks))
+    return True
+
+
+def main():
+    parser = argparse.ArgumentParser(description="Write lv_pngle decoding hints into PNG images.")
+    parser.add_argument("-f", "--format", choices=FORMATS, default="auto", help="output format")
+    parser.add_argument("-m", "--mode", choices=MODES, default="auto", help="decoding mode")
+    parser.add_argument("-p", "--priority", type=int, default=0, choices=range(256), metavar="0-255",
+                        help="cache priority (decoding time weighted priority+1 times)")
+    parser.add_argument("-r", "--remove", action="store_true", help="remove hints")
+    parser.add_argument("files", nargs="+", help="PNG images")
+    args = parser.parse_args()
+
+    hints = None
+    if not args.remove:
+        hints = bytes([VERSION, FORMATS.index(args.format), MODES.index(args.mode), args.priority])
+    rc = 0
+    for path in args.files:
+        if not set_hints(path, hints):
+            print("%s isn't a valid PNG file, skipped." % path, file=sys.stderr)
+            rc = 1
+    sys.exit(rc)
+
+
+if __name__ == "__main__":
+    main()